@@ -40,7 +40,7 @@ typedef enum {
     LLAISYS_DTYPE_U16 = 8,
     LLAISYS_DTYPE_U32 = 9,
     LLAISYS_DTYPE_U64 = 10,
-    LLAISYS_DTYPE_F8 = 11,
+    LLAISYS_DTYPE_F8 = 11, // E4M3: 4 exponent and 3 mantissa bits, no infinities
     LLAISYS_DTYPE_F16 = 12,
     LLAISYS_DTYPE_F32 = 13,
     LLAISYS_DTYPE_F64 = 14,
@@ -49,8 +49,17 @@ typedef enum {
     LLAISYS_DTYPE_C64 = 17,
     LLAISYS_DTYPE_C128 = 18,
     LLAISYS_DTYPE_BF16 = 19,
+    LLAISYS_DTYPE_F8_E5M2 = 20,
 } llaisysDataType_t;
 
+// Activation Functions
+typedef enum {
+    LLAISYS_ACTIVATION_NONE = 0,
+    LLAISYS_ACTIVATION_RELU = 1,
+    LLAISYS_ACTIVATION_SILU = 2,
+    LLAISYS_ACTIVATION_GELU = 3,
+} llaisysActivation_t;
+
 // Runtime Types
 // Stream
 typedef void *llaisysStream_t;
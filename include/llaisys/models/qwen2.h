@@ -29,14 +29,129 @@ __C {
         llaisysTensor_t *mlp_down_w;
     };
 
+    // Prefix cache counters, since the cache was last rebuilt.
+    struct LlaisysQwen2CacheStats {
+        size_t query_tokens;   // input positions not already in the model's sequence
+        size_t hit_tokens;     // of those, positions taken from cached blocks
+        size_t cached_blocks;  // blocks kept only for their prefix
+        size_t free_blocks;    // blocks holding nothing
+        size_t evicted_blocks; // cached blocks reclaimed for new positions
+    };
+
+    // How the projections are stored for the passes, from the loaded weights.
+    typedef enum {
+        LLAISYS_QWEN2_WEIGHTS_DENSE = 0,  // as loaded, never copied: row-major, in meta.dtype
+        LLAISYS_QWEN2_WEIGHTS_PACKED = 1, // in meta.dtype, repacked for the CPU kernels
+        LLAISYS_QWEN2_WEIGHTS_INT8 = 2,   // int8 with a scale per output feature
+        LLAISYS_QWEN2_WEIGHTS_INT4 = 3,   // 4-bit, a scale and zero point per group of inputs
+    } llaisysQwen2WeightFormat_t;
+
     struct LlaisysQwen2Model;
 
     __export struct LlaisysQwen2Model *llaisysQwen2ModelCreate(const LlaisysQwen2Meta *meta, llaisysDeviceType_t device, int *device_ids, int ndevice);
 
     __export void llaisysQwen2ModelDestroy(struct LlaisysQwen2Model * model);
 
+    // Handles of the weights, for the caller to fill; weights not loaded are allocated
+    // by this call, so a model read with llaisysQwen2ModelLoad allocates none. The Q, K
+    // and V weights (and biases) of a layer are allocated as rows of one tensor, which
+    // the DENSE format runs as a single projection. Weights written through the handles
+    // are read by the next Infer, Generate or Step after this call.
     __export struct LlaisysQwen2Weights *llaisysQwen2ModelWeights(struct LlaisysQwen2Model * model);
 
+    // Load the weights from the .safetensors files of directory `path`, or from the file
+    // `path`. The files are mapped, and on a CPU model weights stored in meta->dtype
+    // point into the mapping instead of being copied, which the DENSE format runs in
+    // place; others are converted. The handles of llaisysQwen2ModelWeights then refer
+    // to the loaded tensors. A checkpoint without lm_head.weight ties it to the input
+    // embedding.
+    __export void llaisysQwen2ModelLoad(struct LlaisysQwen2Model * model, const char *path);
+
+    // Returns the next token after token_ids. Keys and values of previous calls are
+    // cached: positions whose ids match a prefix of token_ids are not recomputed.
     __export int64_t llaisysQwen2ModelInfer(struct LlaisysQwen2Model * model, int64_t * token_ids, size_t ntoken);
+
+    // A new handle, to free with tensorDestroy, on the logits [m, voc] of the last Infer,
+    // Generate or Step: the row of Infer, the one Generate drew its last token from, or
+    // one per sequence reported by Step, in the order of its seq_ids. The logits are
+    // overwritten by the next call.
+    __export llaisysTensor_t llaisysQwen2ModelLogits(struct LlaisysQwen2Model * model);
+
+    // Called by Generate with each token as soon as it is drawn, before the next one is
+    // computed, with the nanoseconds elapsed since the call began and `user`. A nonzero
+    // return stops the generation after this token.
+    typedef int (*LlaisysQwen2TokenCallback)(int64_t token, uint64_t elapsed_ns, void *user);
+
+    // Continue token_ids with up to max_new_tokens tokens, written to new_tokens, and
+    // return how many: tokens are drawn as by llaisysSample, the i-th with the i-th
+    // value of a splitmix64 sequence from `seed`, until end_token is drawn, the callback
+    // (if not null) or Cancel stops it, or, without streaming, the sequence reaches the
+    // KV cache capacity. The whole loop runs in the library; the cache is reused across
+    // calls as by Infer.
+    __export size_t llaisysQwen2ModelGenerate(struct LlaisysQwen2Model * model, int64_t * token_ids, size_t ntoken, int64_t * new_tokens, size_t max_new_tokens, float temperature, size_t top_k, float top_p, uint64_t seed, LlaisysQwen2TokenCallback callback, void *user);
+
+    // Stop the Generate call in progress after its current token; safe from any thread.
+    // The request lasts until a Generate call returns: issued with no call in progress,
+    // it stops the next one after its first token.
+    __export void llaisysQwen2ModelCancel(struct LlaisysQwen2Model * model);
+
+    // Keep only the first `length` positions of the KV cache.
+    __export void llaisysQwen2ModelTruncateCache(struct LlaisysQwen2Model * model, size_t length);
+
+    // Empty the KV cache, e.g. before an unrelated sequence.
+    __export void llaisysQwen2ModelResetCache(struct LlaisysQwen2Model * model);
+
+    // Store the KV cache in `dtype`: the model's dtype (the default), or LLAISYS_DTYPE_I8,
+    // LLAISYS_DTYPE_F8 or LLAISYS_DTYPE_F8_E5M2 with a scale per head of each position,
+    // which halves its memory against 16-bit weights. Empties the cache.
+    __export void llaisysQwen2ModelSetKVCacheType(struct LlaisysQwen2Model * model, llaisysDataType_t dtype);
+
+    // Size the KV cache for `ntoken` positions, at least maxseq. Full blocks of earlier
+    // sequences stay cached in the excess, least recently used evicted first, and are
+    // reused by sequences starting with the same tokens. Empties the cache.
+    __export void llaisysQwen2ModelSetKVCacheCapacity(struct LlaisysQwen2Model * model, size_t ntoken);
+
+    // Store the projections (Q/K/V, O, gate/up, down and the output embedding) in
+    // `format`, LLAISYS_QWEN2_WEIGHTS_DENSE by default. They are rebuilt from the
+    // weights at the next Infer, Generate or Step, so the format may be set before or
+    // after Load. Formats other than DENSE build a copy of each projection, with Q, K and
+    // V stacked and gate and up interleaved, next to the loaded weights. Packing speeds
+    // up every pass; it only applies to CPU models. Quantizing cuts the weight bytes read by a decode step to
+    // about half of bf16 for int8 and a quarter for int4, at some cost in accuracy. Int4
+    // groups are 128 inputs wide, or the widest multiple of 32 dividing the input
+    // features, which must be a multiple of 32.
+    __export void llaisysQwen2ModelSetWeightFormat(struct LlaisysQwen2Model * model, llaisysQwen2WeightFormat_t format);
+
+    // Streaming mode: keep only the first `sink_tokens` positions (at most maxseq, rounded
+    // up to a block of 16) and a window of the latest ones in the KV cache, so that the
+    // sequence passed to Infer can grow past maxseq. `window` is 0, which turns it off, or
+    // at least 32. Positions leave the window a whole block of 16 at a time, so it keeps
+    // between window - 15 and window of the latest ones. Empties the cache.
+    __export void llaisysQwen2ModelSetStreaming(struct LlaisysQwen2Model * model, size_t sink_tokens, size_t window);
+
+    __export void llaisysQwen2ModelCacheStats(struct LlaisysQwen2Model * model, struct LlaisysQwen2CacheStats * stats);
+
+    // Sequences served together by Step, sharing the KV cache with the one of Infer.
+    // Returns the id of a new empty sequence.
+    __export int64_t llaisysQwen2ModelCreateSequence(struct LlaisysQwen2Model * model);
+
+    // Drop a sequence; its full blocks stay cached for later prefixes.
+    __export void llaisysQwen2ModelDestroySequence(struct LlaisysQwen2Model * model, int64_t seq);
+
+    // Queue tokens to append to a sequence: its prompt, or the token chosen after a step.
+    __export void llaisysQwen2ModelAppendTokens(struct LlaisysQwen2Model * model, int64_t seq, int64_t * token_ids, size_t ntoken);
+
+    // Prompt tokens computed per step over all sequences (512 by default). A long prompt
+    // is spread over several steps, each also computing the next token of every decoding
+    // sequence, so their latency stays bounded.
+    __export void llaisysQwen2ModelSetPrefillChunk(struct LlaisysQwen2Model * model, size_t ntoken);
+
+    // Tokens queued and not yet computed, over all sequences.
+    __export size_t llaisysQwen2ModelQueuedTokens(struct LlaisysQwen2Model * model);
+
+    // Compute one step of the queued tokens. Returns the number of sequences whose queued
+    // tokens are all computed, and writes the id and most likely next token of each to
+    // seq_ids and next_tokens, arrays of `capacity` entries.
+    __export size_t llaisysQwen2ModelStep(struct LlaisysQwen2Model * model, int64_t * seq_ids, int64_t * next_tokens, size_t capacity);
 }
 #endif // LLAISYS_MODELS_QWEN2_H
@@ -6,12 +6,34 @@
 __C {
     __export void llaisysAdd(llaisysTensor_t c, llaisysTensor_t a, llaisysTensor_t b);
     __export void llaisysArgmax(llaisysTensor_t max_idx, llaisysTensor_t max_val, llaisysTensor_t vals);
+    __export void llaisysCast(llaisysTensor_t out, llaisysTensor_t in);
     __export void llaisysEmbedding(llaisysTensor_t out, llaisysTensor_t index, llaisysTensor_t weight);
+    __export void llaisysEmbeddingQuantized(llaisysTensor_t out, llaisysTensor_t index, llaisysTensor_t weight, llaisysTensor_t scales);
     __export void llaisysLinear(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t weight, llaisysTensor_t bias);
+    __export llaisysTensor_t llaisysLinearPackWeight(llaisysTensor_t weight);
+    // Quantized weights of the linear ops are I8, F8 or F8_E5M2 [out_features,
+    // in_features], or U8 [out_features, in_features / 2]: a U8 weight always holds 4-bit
+    // values, two per byte, and is rejected if its width is not in_features / 2. Scales
+    // are [out_features, groups], or [1] for the whole tensor except with 4 bits, whose
+    // groups are a multiple of 32 wide; zeros are U8 [out_features, groups] zero points
+    // of a 4-bit weight, or null for a fixed zero point of 8.
+    __export void llaisysLinearQuantized(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t weight, llaisysTensor_t scales, llaisysTensor_t zeros, llaisysTensor_t bias);
+    __export void llaisysLinearFused(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t weight, llaisysTensor_t scales, llaisysTensor_t zeros, llaisysTensor_t bias, llaisysTensor_t residual, llaisysActivation_t activation);
+    __export void llaisysLinearQKV(llaisysTensor_t q, llaisysTensor_t k, llaisysTensor_t v, llaisysTensor_t in, llaisysTensor_t weight, llaisysTensor_t scales, llaisysTensor_t zeros, llaisysTensor_t bias);
+    __export llaisysTensor_t llaisysLinearConcat(llaisysTensor_t *parts, size_t nparts);
+    __export void llaisysLinearSwiGLU(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t weight, llaisysTensor_t scales, llaisysTensor_t zeros, llaisysTensor_t bias);
+    __export llaisysTensor_t llaisysLinearSwiGLUInterleave(llaisysTensor_t gate, llaisysTensor_t up);
+    __export void llaisysLinearQuantize(llaisysTensor_t qweight, llaisysTensor_t scales, llaisysTensor_t zeros, llaisysTensor_t weight);
     __export void llaisysRearrange(llaisysTensor_t out, llaisysTensor_t in);
     __export void llaisysRmsNorm(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t weight, float eps);
     __export void llaisysROPE(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t pos_ids, float theta);
+    __export void llaisysROPETable(llaisysTensor_t table, float theta);
+    __export void llaisysROPEPaged(llaisysTensor_t q_out, llaisysTensor_t k_cache, llaisysTensor_t v_cache, llaisysTensor_t k_scales, llaisysTensor_t v_scales, llaisysTensor_t q, llaisysTensor_t k, llaisysTensor_t v, llaisysTensor_t pos_ids, llaisysTensor_t slots, llaisysTensor_t table, float theta);
+    __export void llaisysSample(llaisysTensor_t out_idx, llaisysTensor_t logits, float temperature, size_t top_k, float top_p, uint64_t seed);
     __export void llaisysSelfAttention(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k, llaisysTensor_t v, float scale);
+    __export void llaisysSelfAttentionPaged(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k_cache, llaisysTensor_t v_cache, llaisysTensor_t block_table, size_t total_len, float scale);
+    __export void llaisysSelfAttentionPagedQuantized(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k_cache, llaisysTensor_t v_cache, llaisysTensor_t k_scales, llaisysTensor_t v_scales, llaisysTensor_t block_table, size_t total_len, float scale);
+    __export void llaisysSelfAttentionBatched(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k_cache, llaisysTensor_t v_cache, llaisysTensor_t k_scales, llaisysTensor_t v_scales, llaisysTensor_t block_tables, llaisysTensor_t q_offsets, llaisysTensor_t kv_lens, float scale);
     __export void llaisysSwiGLU(llaisysTensor_t out, llaisysTensor_t gate, llaisysTensor_t up);
 }
 
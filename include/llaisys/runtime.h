@@ -42,6 +42,14 @@ __C {
 
     // Llaisys API for switching device context
     __export void llaisysSetContextRuntime(llaisysDeviceType_t, int);
+
+    // Llaisys API for the CPU thread pool used by all kernels.
+    // Defaults to LLAISYS_NUM_THREADS, or the number of logical cores if unset; setting
+    // a count of 0 or less restores that default.
+    __export void llaisysSetNumThreads(int);
+    __export int llaisysGetNumThreads();
+    // Pin worker threads to cores. Defaults to LLAISYS_PIN_THREADS=1.
+    __export void llaisysSetThreadPinning(int);
 }
 
 #endif // LLAISYS_RUNTIME_H
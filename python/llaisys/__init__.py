@@ -1,7 +1,10 @@
 from .runtime import RuntimeAPI
+from .runtime import set_num_threads, get_num_threads, set_thread_pinning
 from .libllaisys import DeviceType
 from .libllaisys import DataType
 from .libllaisys import MemcpyKind
+from .libllaisys import Activation
+from .libllaisys import Qwen2WeightFormat
 from .libllaisys import llaisysStream_t as Stream
 from .tensor import Tensor
 from .ops import Ops
@@ -10,9 +13,14 @@ from .models import *
 
 __all__ = [
     "RuntimeAPI",
+    "set_num_threads",
+    "get_num_threads",
+    "set_thread_pinning",
     "DeviceType",
     "DataType",
     "MemcpyKind",
+    "Activation",
+    "Qwen2WeightFormat",
     "Stream",
     "Tensor",
     "Ops",
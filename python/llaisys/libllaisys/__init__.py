@@ -7,11 +7,16 @@ from .runtime import load_runtime
 from .runtime import LlaisysRuntimeAPI
 from .llaisys_types import llaisysDeviceType_t, DeviceType
 from .llaisys_types import llaisysDataType_t, DataType
+from .llaisys_types import llaisysActivation_t, Activation
 from .llaisys_types import llaisysMemcpyKind_t, MemcpyKind
 from .llaisys_types import llaisysStream_t
 from .tensor import llaisysTensor_t
 from .tensor import load_tensor
 from .ops import load_ops
+from .qwen2 import load_qwen2
+from .qwen2 import LlaisysQwen2Meta, LlaisysQwen2Weights, LlaisysQwen2CacheStats, llaisysQwen2Model_t
+from .qwen2 import LlaisysQwen2TokenCallback
+from .qwen2 import Qwen2WeightFormat, llaisysQwen2WeightFormat_t
 
 
 def load_shared_library():
@@ -38,6 +43,7 @@ LIB_LLAISYS = load_shared_library()
 load_runtime(LIB_LLAISYS)
 load_tensor(LIB_LLAISYS)
 load_ops(LIB_LLAISYS)
+load_qwen2(LIB_LLAISYS)
 
 
 __all__ = [
@@ -49,7 +55,16 @@ __all__ = [
     "DataType",
     "llaisysDeviceType_t",
     "DeviceType",
+    "llaisysActivation_t",
+    "Activation",
     "llaisysMemcpyKind_t",
     "MemcpyKind",
     "llaisysStream_t",
+    "LlaisysQwen2Meta",
+    "LlaisysQwen2Weights",
+    "LlaisysQwen2CacheStats",
+    "llaisysQwen2Model_t",
+    "LlaisysQwen2TokenCallback",
+    "Qwen2WeightFormat",
+    "llaisysQwen2WeightFormat_t",
 ]
@@ -34,11 +34,23 @@ class DataType(IntEnum):
     C64 = 17
     C128 = 18
     BF16 = 19
+    F8_E5M2 = 20
 
 
 llaisysDataType_t = ctypes.c_int
 
 
+# Activation enum
+class Activation(IntEnum):
+    NONE = 0
+    RELU = 1
+    SILU = 2
+    GELU = 3
+
+
+llaisysActivation_t = ctypes.c_int
+
+
 # Memory Copy Kind enum
 class MemcpyKind(IntEnum):
     H2H = 0
@@ -57,6 +69,8 @@ __all__ = [
     "DeviceType",
     "llaisysDataType_t",
     "DataType",
+    "llaisysActivation_t",
+    "Activation",
     "llaisysMemcpyKind_t",
     "MemcpyKind",
     "llaisysStream_t",
@@ -1,5 +1,6 @@
 from .tensor import llaisysTensor_t
-from ctypes import c_float
+from .llaisys_types import llaisysActivation_t
+from ctypes import POINTER, c_float, c_size_t, c_uint64
 
 def load_ops(lib):
     lib.llaisysAdd.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t]
@@ -8,12 +9,74 @@ def load_ops(lib):
     lib.llaisysArgmax.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t]
     lib.llaisysArgmax.restype = None
 
+    lib.llaisysCast.argtypes = [llaisysTensor_t, llaisysTensor_t]
+    lib.llaisysCast.restype = None
+
     lib.llaisysEmbedding.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t]
     lib.llaisysEmbedding.restype = None
 
+    lib.llaisysEmbeddingQuantized.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t, llaisysTensor_t]
+    lib.llaisysEmbeddingQuantized.restype = None
+
     lib.llaisysLinear.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t, llaisysTensor_t]
     lib.llaisysLinear.restype = None
 
+    lib.llaisysLinearPackWeight.argtypes = [llaisysTensor_t]
+    lib.llaisysLinearPackWeight.restype = llaisysTensor_t
+
+    lib.llaisysLinearQuantized.argtypes = [
+        llaisysTensor_t,  # out
+        llaisysTensor_t,  # in
+        llaisysTensor_t,  # weight
+        llaisysTensor_t,  # scales
+        llaisysTensor_t,  # zeros
+        llaisysTensor_t,  # bias
+    ]
+    lib.llaisysLinearQuantized.restype = None
+
+    lib.llaisysLinearFused.argtypes = [
+        llaisysTensor_t,  # out
+        llaisysTensor_t,  # in
+        llaisysTensor_t,  # weight
+        llaisysTensor_t,  # scales
+        llaisysTensor_t,  # zeros
+        llaisysTensor_t,  # bias
+        llaisysTensor_t,  # residual
+        llaisysActivation_t,  # activation
+    ]
+    lib.llaisysLinearFused.restype = None
+
+    lib.llaisysLinearQKV.argtypes = [
+        llaisysTensor_t,  # q
+        llaisysTensor_t,  # k
+        llaisysTensor_t,  # v
+        llaisysTensor_t,  # in
+        llaisysTensor_t,  # weight
+        llaisysTensor_t,  # scales
+        llaisysTensor_t,  # zeros
+        llaisysTensor_t,  # bias
+    ]
+    lib.llaisysLinearQKV.restype = None
+
+    lib.llaisysLinearConcat.argtypes = [POINTER(llaisysTensor_t), c_size_t]
+    lib.llaisysLinearConcat.restype = llaisysTensor_t
+
+    lib.llaisysLinearSwiGLU.argtypes = [
+        llaisysTensor_t,  # out
+        llaisysTensor_t,  # in
+        llaisysTensor_t,  # weight
+        llaisysTensor_t,  # scales
+        llaisysTensor_t,  # zeros
+        llaisysTensor_t,  # bias
+    ]
+    lib.llaisysLinearSwiGLU.restype = None
+
+    lib.llaisysLinearSwiGLUInterleave.argtypes = [llaisysTensor_t, llaisysTensor_t]
+    lib.llaisysLinearSwiGLUInterleave.restype = llaisysTensor_t
+
+    lib.llaisysLinearQuantize.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t, llaisysTensor_t]
+    lib.llaisysLinearQuantize.restype = None
+
     lib.llaisysRearrange.argtypes = [llaisysTensor_t, llaisysTensor_t]
     lib.llaisysRearrange.restype = None
 
@@ -23,6 +86,35 @@ def load_ops(lib):
     lib.llaisysROPE.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t, c_float]
     lib.llaisysROPE.restype = None
 
+    lib.llaisysROPETable.argtypes = [llaisysTensor_t, c_float]
+    lib.llaisysROPETable.restype = None
+
+    lib.llaisysROPEPaged.argtypes = [
+        llaisysTensor_t,  # q_out
+        llaisysTensor_t,  # k_cache
+        llaisysTensor_t,  # v_cache
+        llaisysTensor_t,  # k_scales
+        llaisysTensor_t,  # v_scales
+        llaisysTensor_t,  # q
+        llaisysTensor_t,  # k
+        llaisysTensor_t,  # v
+        llaisysTensor_t,  # pos_ids
+        llaisysTensor_t,  # slots
+        llaisysTensor_t,  # table
+        c_float,  # theta
+    ]
+    lib.llaisysROPEPaged.restype = None
+
+    lib.llaisysSample.argtypes = [
+        llaisysTensor_t,  # out_idx
+        llaisysTensor_t,  # logits
+        c_float,  # temperature
+        c_size_t,  # top_k
+        c_float,  # top_p
+        c_uint64,  # seed
+    ]
+    lib.llaisysSample.restype = None
+
     lib.llaisysSelfAttention.argtypes = [
         llaisysTensor_t,  # attn_val
         llaisysTensor_t,  # q
@@ -32,5 +124,43 @@ def load_ops(lib):
     ]
     lib.llaisysSelfAttention.restype = None
 
+    lib.llaisysSelfAttentionPaged.argtypes = [
+        llaisysTensor_t,  # attn_val
+        llaisysTensor_t,  # q
+        llaisysTensor_t,  # k_cache
+        llaisysTensor_t,  # v_cache
+        llaisysTensor_t,  # block_table
+        c_size_t,  # total_len
+        c_float,  # scale
+    ]
+    lib.llaisysSelfAttentionPaged.restype = None
+
+    lib.llaisysSelfAttentionPagedQuantized.argtypes = [
+        llaisysTensor_t,  # attn_val
+        llaisysTensor_t,  # q
+        llaisysTensor_t,  # k_cache
+        llaisysTensor_t,  # v_cache
+        llaisysTensor_t,  # k_scales
+        llaisysTensor_t,  # v_scales
+        llaisysTensor_t,  # block_table
+        c_size_t,  # total_len
+        c_float,  # scale
+    ]
+    lib.llaisysSelfAttentionPagedQuantized.restype = None
+
+    lib.llaisysSelfAttentionBatched.argtypes = [
+        llaisysTensor_t,  # attn_val
+        llaisysTensor_t,  # q
+        llaisysTensor_t,  # k_cache
+        llaisysTensor_t,  # v_cache
+        llaisysTensor_t,  # k_scales
+        llaisysTensor_t,  # v_scales
+        llaisysTensor_t,  # block_tables
+        llaisysTensor_t,  # q_offsets
+        llaisysTensor_t,  # kv_lens
+        c_float,  # scale
+    ]
+    lib.llaisysSelfAttentionBatched.restype = None
+
     lib.llaisysSwiGLU.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t]
     lib.llaisysSwiGLU.restype = None
@@ -0,0 +1,175 @@
+from ctypes import (
+    CFUNCTYPE,
+    POINTER,
+    Structure,
+    c_char_p,
+    c_float,
+    c_int,
+    c_int64,
+    c_size_t,
+    c_uint64,
+    c_void_p,
+)
+from enum import IntEnum
+from .llaisys_types import llaisysDataType_t, llaisysDeviceType_t
+from .tensor import llaisysTensor_t
+
+
+class LlaisysQwen2Meta(Structure):
+    _fields_ = [
+        ("dtype", llaisysDataType_t),
+        ("nlayer", c_size_t),
+        ("hs", c_size_t),
+        ("nh", c_size_t),
+        ("nkvh", c_size_t),
+        ("dh", c_size_t),
+        ("di", c_size_t),
+        ("maxseq", c_size_t),
+        ("voc", c_size_t),
+        ("epsilon", c_float),
+        ("theta", c_float),
+        ("end_token", c_int64),
+    ]
+
+
+class LlaisysQwen2Weights(Structure):
+    _fields_ = [
+        ("in_embed", llaisysTensor_t),
+        ("out_embed", llaisysTensor_t),
+        ("out_norm_w", llaisysTensor_t),
+        ("attn_norm_w", POINTER(llaisysTensor_t)),
+        ("attn_q_w", POINTER(llaisysTensor_t)),
+        ("attn_q_b", POINTER(llaisysTensor_t)),
+        ("attn_k_w", POINTER(llaisysTensor_t)),
+        ("attn_k_b", POINTER(llaisysTensor_t)),
+        ("attn_v_w", POINTER(llaisysTensor_t)),
+        ("attn_v_b", POINTER(llaisysTensor_t)),
+        ("attn_o_w", POINTER(llaisysTensor_t)),
+        ("mlp_norm_w", POINTER(llaisysTensor_t)),
+        ("mlp_gate_w", POINTER(llaisysTensor_t)),
+        ("mlp_up_w", POINTER(llaisysTensor_t)),
+        ("mlp_down_w", POINTER(llaisysTensor_t)),
+    ]
+
+
+class LlaisysQwen2CacheStats(Structure):
+    _fields_ = [
+        ("query_tokens", c_size_t),
+        ("hit_tokens", c_size_t),
+        ("cached_blocks", c_size_t),
+        ("free_blocks", c_size_t),
+        ("evicted_blocks", c_size_t),
+    ]
+
+
+# Weight Format enum
+class Qwen2WeightFormat(IntEnum):
+    DENSE = 0
+    PACKED = 1
+    INT8 = 2
+    INT4 = 3
+
+
+llaisysQwen2WeightFormat_t = c_int
+
+# Handle type
+llaisysQwen2Model_t = c_void_p
+
+# int (*)(int64_t token, uint64_t elapsed_ns, void *user)
+LlaisysQwen2TokenCallback = CFUNCTYPE(c_int, c_int64, c_uint64, c_void_p)
+
+
+def load_qwen2(lib):
+    lib.llaisysQwen2ModelCreate.argtypes = [
+        POINTER(LlaisysQwen2Meta),  # meta
+        llaisysDeviceType_t,  # device
+        POINTER(c_int),  # device_ids
+        c_int,  # ndevice
+    ]
+    lib.llaisysQwen2ModelCreate.restype = llaisysQwen2Model_t
+
+    lib.llaisysQwen2ModelDestroy.argtypes = [llaisysQwen2Model_t]
+    lib.llaisysQwen2ModelDestroy.restype = None
+
+    lib.llaisysQwen2ModelWeights.argtypes = [llaisysQwen2Model_t]
+    lib.llaisysQwen2ModelWeights.restype = POINTER(LlaisysQwen2Weights)
+
+    lib.llaisysQwen2ModelLoad.argtypes = [llaisysQwen2Model_t, c_char_p]
+    lib.llaisysQwen2ModelLoad.restype = None
+
+    lib.llaisysQwen2ModelInfer.argtypes = [
+        llaisysQwen2Model_t,  # model
+        POINTER(c_int64),  # token_ids
+        c_size_t,  # ntoken
+    ]
+    lib.llaisysQwen2ModelInfer.restype = c_int64
+
+    lib.llaisysQwen2ModelLogits.argtypes = [llaisysQwen2Model_t]
+    lib.llaisysQwen2ModelLogits.restype = llaisysTensor_t
+
+    lib.llaisysQwen2ModelGenerate.argtypes = [
+        llaisysQwen2Model_t,  # model
+        POINTER(c_int64),  # token_ids
+        c_size_t,  # ntoken
+        POINTER(c_int64),  # new_tokens
+        c_size_t,  # max_new_tokens
+        c_float,  # temperature
+        c_size_t,  # top_k
+        c_float,  # top_p
+        c_uint64,  # seed
+        LlaisysQwen2TokenCallback,  # callback
+        c_void_p,  # user
+    ]
+    lib.llaisysQwen2ModelGenerate.restype = c_size_t
+
+    lib.llaisysQwen2ModelCancel.argtypes = [llaisysQwen2Model_t]
+    lib.llaisysQwen2ModelCancel.restype = None
+
+    lib.llaisysQwen2ModelTruncateCache.argtypes = [llaisysQwen2Model_t, c_size_t]
+    lib.llaisysQwen2ModelTruncateCache.restype = None
+
+    lib.llaisysQwen2ModelResetCache.argtypes = [llaisysQwen2Model_t]
+    lib.llaisysQwen2ModelResetCache.restype = None
+
+    lib.llaisysQwen2ModelSetKVCacheType.argtypes = [llaisysQwen2Model_t, llaisysDataType_t]
+    lib.llaisysQwen2ModelSetKVCacheType.restype = None
+
+    lib.llaisysQwen2ModelSetKVCacheCapacity.argtypes = [llaisysQwen2Model_t, c_size_t]
+    lib.llaisysQwen2ModelSetKVCacheCapacity.restype = None
+
+    lib.llaisysQwen2ModelSetWeightFormat.argtypes = [llaisysQwen2Model_t, llaisysQwen2WeightFormat_t]
+    lib.llaisysQwen2ModelSetWeightFormat.restype = None
+
+    lib.llaisysQwen2ModelSetStreaming.argtypes = [llaisysQwen2Model_t, c_size_t, c_size_t]
+    lib.llaisysQwen2ModelSetStreaming.restype = None
+
+    lib.llaisysQwen2ModelCacheStats.argtypes = [llaisysQwen2Model_t, POINTER(LlaisysQwen2CacheStats)]
+    lib.llaisysQwen2ModelCacheStats.restype = None
+
+    lib.llaisysQwen2ModelCreateSequence.argtypes = [llaisysQwen2Model_t]
+    lib.llaisysQwen2ModelCreateSequence.restype = c_int64
+
+    lib.llaisysQwen2ModelDestroySequence.argtypes = [llaisysQwen2Model_t, c_int64]
+    lib.llaisysQwen2ModelDestroySequence.restype = None
+
+    lib.llaisysQwen2ModelAppendTokens.argtypes = [
+        llaisysQwen2Model_t,  # model
+        c_int64,  # seq
+        POINTER(c_int64),  # token_ids
+        c_size_t,  # ntoken
+    ]
+    lib.llaisysQwen2ModelAppendTokens.restype = None
+
+    lib.llaisysQwen2ModelSetPrefillChunk.argtypes = [llaisysQwen2Model_t, c_size_t]
+    lib.llaisysQwen2ModelSetPrefillChunk.restype = None
+
+    lib.llaisysQwen2ModelQueuedTokens.argtypes = [llaisysQwen2Model_t]
+    lib.llaisysQwen2ModelQueuedTokens.restype = c_size_t
+
+    lib.llaisysQwen2ModelStep.argtypes = [
+        llaisysQwen2Model_t,  # model
+        POINTER(c_int64),  # seq_ids
+        POINTER(c_int64),  # next_tokens
+        c_size_t,  # capacity
+    ]
+    lib.llaisysQwen2ModelStep.restype = c_size_t
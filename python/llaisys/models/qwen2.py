@@ -1,23 +1,66 @@
-from typing import Sequence
+from typing import Callable, Sequence
 from ..libllaisys import LIB_LLAISYS
-from ..libllaisys import DeviceType
+from ..libllaisys import DeviceType, DataType
+from ..libllaisys import LlaisysQwen2Meta, LlaisysQwen2TokenCallback, Qwen2WeightFormat
+from ..tensor import Tensor
 
 from pathlib import Path
-import safetensors
+from ctypes import c_int, c_int64
+import json
+import os
 
 
-class Qwen2:
+_DTYPES = {
+    "bfloat16": DataType.BF16,
+    "float16": DataType.F16,
+    "float32": DataType.F32,
+}
+
 
-    def __init__(self, model_path, device: DeviceType = DeviceType.CPU):
-        # TODO: Implement model constructor
+class Qwen2:
 
+    def __init__(
+        self,
+        model_path,
+        device: DeviceType = DeviceType.CPU,
+        max_seq_len: int = 4096,
+        weight_format: Qwen2WeightFormat = Qwen2WeightFormat.DENSE,
+    ):
         model_path = Path(model_path)
+        with open(model_path / "config.json") as f:
+            config = json.load(f)
 
-        for file in sorted(model_path.glob("*.safetensors")):
-            data_ = safetensors.safe_open(file, framework="numpy", device="cpu")
-            for name_ in data_.keys():
-                ## TODO: load the model weights
-                pass
+        end_token = config["eos_token_id"]
+        if isinstance(end_token, list):
+            end_token = end_token[0]
+        self.meta = LlaisysQwen2Meta(
+            dtype=_DTYPES[config.get("torch_dtype", "float32")],
+            nlayer=config["num_hidden_layers"],
+            hs=config["hidden_size"],
+            nh=config["num_attention_heads"],
+            nkvh=config["num_key_value_heads"],
+            dh=config["hidden_size"] // config["num_attention_heads"],
+            di=config["intermediate_size"],
+            # The KV cache and rotation table are sized for maxseq positions, so a long
+            # context is opt-in rather than taken from max_position_embeddings.
+            maxseq=min(max_seq_len, config["max_position_embeddings"]),
+            voc=config["vocab_size"],
+            epsilon=config["rms_norm_eps"],
+            theta=config.get("rope_theta", 10000.0),
+            end_token=end_token,
+        )
+        device_ids = (c_int * 1)(0)
+        self._model = LIB_LLAISYS.llaisysQwen2ModelCreate(self.meta, device, device_ids, 1)
+        # Set before loading, so that the projections are only built once, in this format.
+        LIB_LLAISYS.llaisysQwen2ModelSetWeightFormat(self._model, weight_format)
+        # The checkpoint is mapped by the library, and weights already in the model's
+        # dtype are used in place rather than copied.
+        LIB_LLAISYS.llaisysQwen2ModelLoad(self._model, os.fsencode(model_path))
+
+    def __del__(self):
+        if getattr(self, "_model", None) is not None:
+            LIB_LLAISYS.llaisysQwen2ModelDestroy(self._model)
+            self._model = None
 
     def generate(
         self,
@@ -26,8 +69,53 @@ class Qwen2:
         top_k: int = 1,
         top_p: float = 0.8,
         temperature: float = 0.8,
+        seed: int = 0,
+        streamer: Callable[[int, float], bool] = None,
     ):
+        # The whole prefill and decode loop runs in the library, which ctypes calls
+        # without the GIL; the KV cache is reused from the previous call as by Infer.
+        # streamer, if given, is called with each token as soon as it is drawn and the
+        # seconds since the call began; returning True stops the generation, as does
+        # cancel() from another thread.
+        if max_new_tokens is None:
+            max_new_tokens = self.meta.maxseq
+        max_new_tokens = max(max_new_tokens, 0)
+        token_ids = (c_int64 * len(inputs))(*inputs)
+        new_tokens = (c_int64 * max_new_tokens)()
+
+        callback = LlaisysQwen2TokenCallback()  # null
+        error = []
+        if streamer is not None:
+
+            def on_token(token, elapsed_ns, _):
+                try:
+                    return 1 if streamer(token, elapsed_ns * 1e-9) else 0
+                except BaseException as e:
+                    error.append(e)
+                    return 1
+
+            callback = LlaisysQwen2TokenCallback(on_token)
+        n = LIB_LLAISYS.llaisysQwen2ModelGenerate(
+            self._model,
+            token_ids,
+            len(inputs),
+            new_tokens,
+            max_new_tokens,
+            temperature,
+            top_k,
+            top_p,
+            seed,
+            callback,
+            None,
+        )
+        if error:
+            raise error[0]
+        return list(inputs) + new_tokens[:n]
 
-        # TODO: Implement generate function
+    def cancel(self):
+        LIB_LLAISYS.llaisysQwen2ModelCancel(self._model)
 
-        return []
+    def logits(self) -> Tensor:
+        # Logits [m, voc] of the last pass, see llaisysQwen2ModelLogits; they are
+        # overwritten by the next one.
+        return Tensor(tensor=LIB_LLAISYS.llaisysQwen2ModelLogits(self._model))
@@ -1,6 +1,6 @@
-from .libllaisys import LIB_LLAISYS
+from .libllaisys import LIB_LLAISYS, llaisysTensor_t, Activation
 from .tensor import Tensor
-from ctypes import c_float, c_int
+from ctypes import c_float, c_int, c_size_t, c_uint64
 
 
 class Ops:
@@ -13,7 +13,15 @@ class Ops:
         LIB_LLAISYS.llaisysArgmax(max_idx.lib_tensor(), max_val.lib_tensor(), vals.lib_tensor())
 
     @staticmethod
-    def embedding(out: Tensor, index: Tensor, weight: Tensor):
+    def cast(out: Tensor, inp: Tensor):
+        LIB_LLAISYS.llaisysCast(out.lib_tensor(), inp.lib_tensor())
+
+    @staticmethod
+    def embedding(out: Tensor, index: Tensor, weight: Tensor, scales: Tensor = None):
+        if scales is not None:
+            return LIB_LLAISYS.llaisysEmbeddingQuantized(
+                out.lib_tensor(), index.lib_tensor(), weight.lib_tensor(), scales.lib_tensor()
+            )
         LIB_LLAISYS.llaisysEmbedding(
             out.lib_tensor(), index.lib_tensor(), weight.lib_tensor()
         )
@@ -21,7 +29,96 @@ class Ops:
     @staticmethod
     def linear(out: Tensor, inp: Tensor, weight: Tensor, bias: Tensor):
         LIB_LLAISYS.llaisysLinear(
-            out.lib_tensor(), inp.lib_tensor(), weight.lib_tensor(), bias.lib_tensor()
+            out.lib_tensor(),
+            inp.lib_tensor(),
+            weight.lib_tensor(),
+            bias.lib_tensor() if bias is not None else None,
+        )
+
+    @staticmethod
+    def linear_pack_weight(weight: Tensor) -> Tensor:
+        return Tensor(tensor=LIB_LLAISYS.llaisysLinearPackWeight(weight.lib_tensor()))
+
+    @staticmethod
+    def linear_quantized(
+        out: Tensor, inp: Tensor, weight: Tensor, scales: Tensor, bias: Tensor, zeros: Tensor = None
+    ):
+        LIB_LLAISYS.llaisysLinearQuantized(
+            out.lib_tensor(),
+            inp.lib_tensor(),
+            weight.lib_tensor(),
+            scales.lib_tensor(),
+            zeros.lib_tensor() if zeros is not None else None,
+            bias.lib_tensor() if bias is not None else None,
+        )
+
+    @staticmethod
+    def linear_fused(
+        out: Tensor,
+        inp: Tensor,
+        weight: Tensor,
+        bias: Tensor = None,
+        residual: Tensor = None,
+        activation: Activation = Activation.NONE,
+        scales: Tensor = None,
+        zeros: Tensor = None,
+    ):
+        LIB_LLAISYS.llaisysLinearFused(
+            out.lib_tensor(),
+            inp.lib_tensor(),
+            weight.lib_tensor(),
+            scales.lib_tensor() if scales is not None else None,
+            zeros.lib_tensor() if zeros is not None else None,
+            bias.lib_tensor() if bias is not None else None,
+            residual.lib_tensor() if residual is not None else None,
+            activation,
+        )
+
+    @staticmethod
+    def linear_qkv(
+        q: Tensor, k: Tensor, v: Tensor, inp: Tensor, weight: Tensor, bias: Tensor,
+        scales: Tensor = None, zeros: Tensor = None,
+    ):
+        LIB_LLAISYS.llaisysLinearQKV(
+            q.lib_tensor(),
+            k.lib_tensor(),
+            v.lib_tensor(),
+            inp.lib_tensor(),
+            weight.lib_tensor(),
+            scales.lib_tensor() if scales is not None else None,
+            zeros.lib_tensor() if zeros is not None else None,
+            bias.lib_tensor() if bias is not None else None,
+        )
+
+    @staticmethod
+    def linear_concat(parts) -> Tensor:
+        lib_parts = (llaisysTensor_t * len(parts))(*[p.lib_tensor() for p in parts])
+        return Tensor(tensor=LIB_LLAISYS.llaisysLinearConcat(lib_parts, len(parts)))
+
+    @staticmethod
+    def linear_swiglu(
+        out: Tensor, inp: Tensor, weight: Tensor, bias: Tensor = None, scales: Tensor = None, zeros: Tensor = None
+    ):
+        LIB_LLAISYS.llaisysLinearSwiGLU(
+            out.lib_tensor(),
+            inp.lib_tensor(),
+            weight.lib_tensor(),
+            scales.lib_tensor() if scales is not None else None,
+            zeros.lib_tensor() if zeros is not None else None,
+            bias.lib_tensor() if bias is not None else None,
+        )
+
+    @staticmethod
+    def linear_swiglu_interleave(gate: Tensor, up: Tensor) -> Tensor:
+        return Tensor(tensor=LIB_LLAISYS.llaisysLinearSwiGLUInterleave(gate.lib_tensor(), up.lib_tensor()))
+
+    @staticmethod
+    def linear_quantize(qweight: Tensor, scales: Tensor, weight: Tensor, zeros: Tensor = None):
+        LIB_LLAISYS.llaisysLinearQuantize(
+            qweight.lib_tensor(),
+            scales.lib_tensor(),
+            zeros.lib_tensor() if zeros is not None else None,
+            weight.lib_tensor(),
         )
 
     @staticmethod
@@ -40,6 +137,51 @@ class Ops:
             out.lib_tensor(), inp.lib_tensor(), pos_ids.lib_tensor(), c_float(theta)
         )
 
+    @staticmethod
+    def rope_table(table: Tensor, theta: float):
+        LIB_LLAISYS.llaisysROPETable(table.lib_tensor(), c_float(theta))
+
+    @staticmethod
+    def rope_paged(
+        q_out: Tensor,
+        k_cache: Tensor,
+        v_cache: Tensor,
+        q: Tensor,
+        k: Tensor,
+        v: Tensor,
+        pos_ids: Tensor,
+        slots: Tensor,
+        table: Tensor,
+        theta: float,
+        k_scales: Tensor = None,
+        v_scales: Tensor = None,
+    ):
+        LIB_LLAISYS.llaisysROPEPaged(
+            q_out.lib_tensor(),
+            k_cache.lib_tensor(),
+            v_cache.lib_tensor(),
+            k_scales.lib_tensor() if k_scales is not None else None,
+            v_scales.lib_tensor() if v_scales is not None else None,
+            q.lib_tensor(),
+            k.lib_tensor(),
+            v.lib_tensor(),
+            pos_ids.lib_tensor(),
+            slots.lib_tensor(),
+            table.lib_tensor(),
+            c_float(theta),
+        )
+
+    @staticmethod
+    def sample(out_idx: Tensor, logits: Tensor, temperature: float, top_k: int, top_p: float, seed: int):
+        LIB_LLAISYS.llaisysSample(
+            out_idx.lib_tensor(),
+            logits.lib_tensor(),
+            c_float(temperature),
+            c_size_t(top_k),
+            c_float(top_p),
+            c_uint64(seed),
+        )
+
     @staticmethod
     def self_attention(attn_val: Tensor, q: Tensor, k: Tensor, v: Tensor, scale: float):
         LIB_LLAISYS.llaisysSelfAttention(
@@ -50,6 +192,66 @@ class Ops:
             c_float(scale),
         )
 
+    @staticmethod
+    def self_attention_paged(
+        attn_val: Tensor,
+        q: Tensor,
+        k_cache: Tensor,
+        v_cache: Tensor,
+        block_table: Tensor,
+        total_len: int,
+        scale: float,
+        k_scales: Tensor = None,
+        v_scales: Tensor = None,
+    ):
+        if k_scales is not None:
+            return LIB_LLAISYS.llaisysSelfAttentionPagedQuantized(
+                attn_val.lib_tensor(),
+                q.lib_tensor(),
+                k_cache.lib_tensor(),
+                v_cache.lib_tensor(),
+                k_scales.lib_tensor(),
+                v_scales.lib_tensor(),
+                block_table.lib_tensor(),
+                c_size_t(total_len),
+                c_float(scale),
+            )
+        LIB_LLAISYS.llaisysSelfAttentionPaged(
+            attn_val.lib_tensor(),
+            q.lib_tensor(),
+            k_cache.lib_tensor(),
+            v_cache.lib_tensor(),
+            block_table.lib_tensor(),
+            c_size_t(total_len),
+            c_float(scale),
+        )
+
+    @staticmethod
+    def self_attention_batched(
+        attn_val: Tensor,
+        q: Tensor,
+        k_cache: Tensor,
+        v_cache: Tensor,
+        block_tables: Tensor,
+        q_offsets: Tensor,
+        kv_lens: Tensor,
+        scale: float,
+        k_scales: Tensor = None,
+        v_scales: Tensor = None,
+    ):
+        LIB_LLAISYS.llaisysSelfAttentionBatched(
+            attn_val.lib_tensor(),
+            q.lib_tensor(),
+            k_cache.lib_tensor(),
+            v_cache.lib_tensor(),
+            k_scales.lib_tensor() if k_scales is not None else None,
+            v_scales.lib_tensor() if v_scales is not None else None,
+            block_tables.lib_tensor(),
+            q_offsets.lib_tensor(),
+            kv_lens.lib_tensor(),
+            c_float(scale),
+        )
+
     @staticmethod
     def swiglu(out: Tensor, gate: Tensor, up: Tensor):
         LIB_LLAISYS.llaisysSwiGLU(out.lib_tensor(), gate.lib_tensor(), up.lib_tensor())
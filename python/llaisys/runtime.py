@@ -66,3 +66,15 @@ class RuntimeAPI:
         self._api.contents.memcpy_async(
             dst, src, size, libllaisys.llaisysMemcpyKind_t(kind), stream
         )
+
+
+def set_num_threads(num_threads: int) -> None:
+    LIB_LLAISYS.llaisysSetNumThreads(num_threads)
+
+
+def get_num_threads() -> int:
+    return LIB_LLAISYS.llaisysGetNumThreads()
+
+
+def set_thread_pinning(pin: bool) -> None:
+    LIB_LLAISYS.llaisysSetThreadPinning(1 if pin else 0)
@@ -10,9 +10,12 @@ class MemoryAllocator;
 
 class Runtime;
 class Context;
+class ThreadPool;
 
 // Global function to get thread local context
 Context &context();
+// Global function to get the CPU thread pool shared by all threads
+ThreadPool &threadPool();
 } // namespace core
 
 } // namespace llaisys
\ No newline at end of file
@@ -54,6 +54,10 @@ storage_t Runtime::allocateHostStorage(size_t size) {
     return std::shared_ptr<Storage>(new Storage((std::byte *)_api->malloc_host(size), size, *this, true));
 }
 
+storage_t Runtime::wrapHostStorage(std::byte *memory, size_t size, std::shared_ptr<void> owner) {
+    return std::shared_ptr<Storage>(new Storage(memory, size, *this, true, std::move(owner)));
+}
+
 void Runtime::freeStorage(Storage *storage) {
     if (storage->isHost()) {
         _api->free_host(storage->memory());
@@ -39,6 +39,9 @@ public:
     storage_t allocateDeviceStorage(size_t size);
     ;
     storage_t allocateHostStorage(size_t size);
+    // Host memory owned elsewhere, kept alive by `owner` until the storage is released
+    // and never freed by the runtime.
+    storage_t wrapHostStorage(std::byte *memory, size_t size, std::shared_ptr<void> owner);
     void freeStorage(Storage *storage);
 
     llaisysStream_t stream() const;
@@ -3,11 +3,13 @@
 #include "../runtime/runtime.hpp"
 
 namespace llaisys::core {
-Storage::Storage(std::byte *memory, size_t size, Runtime &runtime, bool is_host)
-    : _memory(memory), _size(size), _runtime(runtime), _is_host(is_host) {}
+Storage::Storage(std::byte *memory, size_t size, Runtime &runtime, bool is_host, std::shared_ptr<void> owner)
+    : _memory(memory), _size(size), _runtime(runtime), _is_host(is_host), _owner(std::move(owner)) {}
 
 Storage::~Storage() {
-    _runtime.freeStorage(this);
+    if (!_owner) {
+        _runtime.freeStorage(this);
+    }
 }
 
 std::byte *Storage::memory() const {
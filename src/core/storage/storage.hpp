@@ -12,7 +12,10 @@ private:
     size_t _size;
     Runtime &_runtime;
     bool _is_host;
-    Storage(std::byte *memory, size_t size, Runtime &runtime, bool is_host);
+    // Keeps memory the storage does not own alive, e.g. a file mapping; null when the
+    // runtime allocated it.
+    std::shared_ptr<void> _owner;
+    Storage(std::byte *memory, size_t size, Runtime &runtime, bool is_host, std::shared_ptr<void> owner = nullptr);
 
 public:
     friend class Runtime;
@@ -0,0 +1,243 @@
+#include "thread_pool.hpp"
+
+#include "../../utils.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace llaisys::core {
+namespace {
+// Iterations a worker polls for the next job before blocking on the condition variable.
+constexpr size_t SPIN_COUNT = 1 << 14;
+// Chunks handed out per thread, so that uneven chunks (e.g. causal attention rows)
+// still balance.
+constexpr size_t CHUNKS_PER_THREAD = 4;
+
+// Set on pool workers, and on the caller while it executes a parallel region.
+thread_local bool in_parallel_region = false;
+
+const char *get_env(const char *name) {
+#if defined(_MSC_VER)
+#pragma warning(suppress : 4996)
+#endif
+    return std::getenv(name);
+}
+
+size_t default_num_threads() {
+    if (const char *env = get_env("LLAISYS_NUM_THREADS")) {
+        long n = std::strtol(env, nullptr, 10);
+        if (n > 0) {
+            return static_cast<size_t>(n);
+        }
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+bool default_pinning() {
+    const char *env = get_env("LLAISYS_PIN_THREADS");
+    return env != nullptr && (std::string(env) == "1" || std::string(env) == "true");
+}
+
+void pin_thread(std::thread &thread, size_t core) {
+    size_t num_cores = std::max(1u, std::thread::hardware_concurrency());
+    core %= num_cores;
+#if defined(_WIN32)
+    if (core < sizeof(DWORD_PTR) * 8) {
+        SetThreadAffinityMask(reinterpret_cast<HANDLE>(thread.native_handle()), DWORD_PTR(1) << core);
+    }
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+    (void)thread;
+#endif
+}
+} // namespace
+
+ThreadPool::ThreadPool()
+    : _pin(default_pinning()), _generation(0), _stop(false), _fn(nullptr), _ctx(nullptr),
+      _n(0), _chunk(0), _num_chunks(0), _next_chunk(0), _slots(0), _pending(0) {
+    _start(default_num_threads() - 1);
+}
+
+ThreadPool::~ThreadPool() {
+    _stop_workers();
+}
+
+void ThreadPool::_start(size_t num_workers) {
+    _stop = false;
+    _workers.reserve(num_workers);
+    // Workers may start after the next job is published, so they are told which
+    // generation they were created in rather than reading it themselves.
+    uint64_t generation = _generation.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < num_workers; i++) {
+        _workers.emplace_back(&ThreadPool::_work_loop, this, generation);
+        if (_pin) {
+            pin_thread(_workers.back(), i + 1);
+        }
+    }
+}
+
+void ThreadPool::_stop_workers() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+        _generation.fetch_add(1, std::memory_order_release);
+    }
+    _cv.notify_all();
+    for (auto &worker : _workers) {
+        worker.join();
+    }
+    _workers.clear();
+}
+
+void ThreadPool::_work_loop(uint64_t seen) {
+    in_parallel_region = true;
+    while (true) {
+        for (size_t i = 0; i < SPIN_COUNT && _generation.load(std::memory_order_acquire) == seen; i++) {
+            if (i % 64 == 63) {
+                std::this_thread::yield();
+            }
+        }
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cv.wait(lock, [&] { return _generation.load(std::memory_order_acquire) != seen; });
+            seen = _generation.load(std::memory_order_acquire);
+            if (_stop) {
+                return;
+            }
+        }
+        // Join the job if it still needs workers; otherwise wait for the next one.
+        size_t slots = _slots.load(std::memory_order_acquire);
+        while (slots > 0 && !_slots.compare_exchange_weak(slots, slots - 1, std::memory_order_acq_rel)) {
+        }
+        if (slots == 0) {
+            continue;
+        }
+        _run_chunks();
+        _pending.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+void ThreadPool::_run_chunks() {
+    while (true) {
+        size_t chunk = _next_chunk.fetch_add(1, std::memory_order_relaxed);
+        if (chunk >= _num_chunks) {
+            return;
+        }
+        size_t begin = chunk * _chunk;
+        size_t end = std::min(_n, begin + _chunk);
+        try {
+            _fn(_ctx, begin, end);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(_error_mutex);
+            if (!_error) {
+                _error = std::current_exception();
+            }
+        }
+    }
+}
+
+void ThreadPool::_run(size_t n, size_t grain, task_fn fn, const void *ctx) {
+    if (n == 0) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    size_t num_threads = _workers.size() + 1;
+    size_t num_chunks = std::min((n + grain - 1) / grain, num_threads * CHUNKS_PER_THREAD);
+    if (num_chunks <= 1 || _workers.empty() || in_parallel_region) {
+        return fn(ctx, 0, n);
+    }
+    std::unique_lock<std::mutex> run_lock(_run_mutex, std::try_to_lock);
+    if (!run_lock.owns_lock()) {
+        return fn(ctx, 0, n);
+    }
+
+    _fn = fn;
+    _ctx = ctx;
+    _n = n;
+    _chunk = (n + num_chunks - 1) / num_chunks;
+    _num_chunks = (n + _chunk - 1) / _chunk;
+    _next_chunk.store(0, std::memory_order_relaxed);
+    _error = nullptr;
+    // The caller takes a chunk itself, so only the others need workers. Spinning
+    // workers join first; a sleeping one woken after the slots are taken sleeps again.
+    const size_t participants = std::min(_num_chunks - 1, _workers.size());
+    _pending.store(participants, std::memory_order_relaxed);
+    _slots.store(participants, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _generation.fetch_add(1, std::memory_order_release);
+    }
+    for (size_t i = 0; i < participants; i++) {
+        _cv.notify_one();
+    }
+
+    in_parallel_region = true;
+    _run_chunks();
+    in_parallel_region = false;
+    // Every participant acknowledges the job before the next one may overwrite it.
+    while (_pending.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+    }
+    if (_error) {
+        std::rethrow_exception(_error);
+    }
+}
+
+size_t ThreadPool::numThreads() const {
+    return _workers.size() + 1;
+}
+
+void ThreadPool::setNumThreads(size_t num_threads) {
+    if (num_threads == 0) {
+        num_threads = default_num_threads();
+    }
+    std::lock_guard<std::mutex> run_lock(_run_mutex);
+    if (num_threads == _workers.size() + 1) {
+        return;
+    }
+    _stop_workers();
+    _start(num_threads - 1);
+}
+
+void ThreadPool::setPinning(bool pin) {
+    std::lock_guard<std::mutex> run_lock(_run_mutex);
+    if (pin == _pin) {
+        return;
+    }
+    _pin = pin;
+    size_t num_workers = _workers.size();
+    _stop_workers();
+    _start(num_workers);
+}
+
+bool ThreadPool::pinning() const {
+    return _pin;
+}
+
+// Global API to get the process-wide thread pool. Unlike the context it is shared by
+// all threads. It is never destroyed, so no worker is joined during static destruction
+// at process exit.
+ThreadPool &threadPool() {
+    static ThreadPool *pool = new ThreadPool();
+    return *pool;
+}
+
+} // namespace llaisys::core
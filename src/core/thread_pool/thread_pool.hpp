@@ -0,0 +1,82 @@
+#pragma once
+#include "../core.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace llaisys::core {
+// Persistent pool of worker threads used to split CPU kernels across cores.
+//
+// The calling thread always takes part in the work, so a pool of N threads owns N - 1
+// workers. Workers spin briefly after each job before going to sleep, which keeps the
+// back-to-back ops of a decode step from paying a wake-up per op. A region only takes,
+// and waits for, as many workers as it has chunks besides the caller's. Calls made from
+// inside a parallel region, or while another thread is using the pool, run serially.
+class ThreadPool {
+private:
+    using task_fn = void (*)(const void *, size_t, size_t);
+
+    std::vector<std::thread> _workers;
+    bool _pin;
+
+    // Serializes dispatch and resizing.
+    std::mutex _run_mutex;
+    // Guards _generation transitions for sleeping workers.
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::atomic<uint64_t> _generation;
+    bool _stop;
+
+    // Current job, published by bumping _generation.
+    task_fn _fn;
+    const void *_ctx;
+    size_t _n;
+    size_t _chunk;
+    size_t _num_chunks;
+    std::atomic<size_t> _next_chunk;
+    // Workers still to join the current job, and those yet to finish it.
+    std::atomic<size_t> _slots;
+    std::atomic<size_t> _pending;
+    std::exception_ptr _error;
+    std::mutex _error_mutex;
+
+    ThreadPool();
+
+    void _start(size_t num_workers);
+    void _stop_workers();
+    void _work_loop(uint64_t seen);
+    void _run_chunks();
+    void _run(size_t n, size_t grain, task_fn fn, const void *ctx);
+
+public:
+    ~ThreadPool();
+
+    // Prevent copy
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Number of threads that execute a parallel region, including the caller.
+    size_t numThreads() const;
+    // 0 restores the default: LLAISYS_NUM_THREADS, or the number of logical cores.
+    void setNumThreads(size_t num_threads);
+    // Pin worker i to logical core i + 1, leaving core 0 to the calling thread.
+    void setPinning(bool pin);
+    bool pinning() const;
+
+    // Call f(begin, end) on disjoint sub-ranges covering [0, n). Each sub-range holds
+    // at least `grain` indices except possibly the last. Returns once all are done and
+    // rethrows the first exception raised by f.
+    template <typename F>
+    void parallelFor(size_t n, size_t grain, const F &f) {
+        _run(n, grain, [](const void *ctx, size_t begin, size_t end) { (*static_cast<const F *>(ctx))(begin, end); }, &f);
+    }
+
+    friend ThreadPool &threadPool();
+};
+} // namespace llaisys::core
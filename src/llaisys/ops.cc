@@ -4,11 +4,13 @@
 
 #include "../ops/add/op.hpp"
 #include "../ops/argmax/op.hpp"
+#include "../ops/cast/op.hpp"
 #include "../ops/embedding/op.hpp"
 #include "../ops/linear/op.hpp"
 #include "../ops/rearrange/op.hpp"
 #include "../ops/rms_norm/op.hpp"
 #include "../ops/rope/op.hpp"
+#include "../ops/sample/op.hpp"
 #include "../ops/self_attention/op.hpp"
 #include "../ops/swiglu/op.hpp"
 
@@ -19,11 +21,50 @@ __C {
     void llaisysArgmax(llaisysTensor_t max_idx, llaisysTensor_t max_val, llaisysTensor_t vals) {
         llaisys::ops::argmax(max_idx->tensor, max_val->tensor, vals->tensor);
     }
+    void llaisysCast(llaisysTensor_t out, llaisysTensor_t in) {
+        llaisys::ops::cast(out->tensor, in->tensor);
+    }
     void llaisysEmbedding(llaisysTensor_t out, llaisysTensor_t index, llaisysTensor_t weight) {
         llaisys::ops::embedding(out->tensor, index->tensor, weight->tensor);
     }
+    void llaisysEmbeddingQuantized(llaisysTensor_t out, llaisysTensor_t index, llaisysTensor_t weight, llaisysTensor_t scales) {
+        llaisys::ops::embedding(out->tensor, index->tensor, weight->tensor, scales->tensor);
+    }
     void llaisysLinear(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t weight, llaisysTensor_t bias) {
-        llaisys::ops::linear(out->tensor, in->tensor, weight->tensor, bias->tensor);
+        llaisys::ops::linear(out->tensor, in->tensor, weight->tensor, bias ? bias->tensor : nullptr);
+    }
+    llaisysTensor_t llaisysLinearPackWeight(llaisysTensor_t weight) {
+        return new LlaisysTensor{llaisys::ops::linear_pack_weight(weight->tensor)};
+    }
+    void llaisysLinearQuantized(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t weight, llaisysTensor_t scales, llaisysTensor_t zeros, llaisysTensor_t bias) {
+        llaisys::ops::linear(out->tensor, in->tensor, weight->tensor, bias ? bias->tensor : nullptr,
+                             scales->tensor, zeros ? zeros->tensor : nullptr);
+    }
+    void llaisysLinearFused(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t weight, llaisysTensor_t scales, llaisysTensor_t zeros, llaisysTensor_t bias, llaisysTensor_t residual, llaisysActivation_t activation) {
+        llaisys::ops::linear_fused(out->tensor, in->tensor, weight->tensor, bias ? bias->tensor : nullptr,
+                                   residual ? residual->tensor : nullptr, activation,
+                                   scales ? scales->tensor : nullptr, zeros ? zeros->tensor : nullptr);
+    }
+    void llaisysLinearQKV(llaisysTensor_t q, llaisysTensor_t k, llaisysTensor_t v, llaisysTensor_t in, llaisysTensor_t weight, llaisysTensor_t scales, llaisysTensor_t zeros, llaisysTensor_t bias) {
+        llaisys::ops::linear_qkv(q->tensor, k->tensor, v->tensor, in->tensor, weight->tensor, bias ? bias->tensor : nullptr,
+                                 scales ? scales->tensor : nullptr, zeros ? zeros->tensor : nullptr);
+    }
+    llaisysTensor_t llaisysLinearConcat(llaisysTensor_t *parts, size_t nparts) {
+        std::vector<llaisys::tensor_t> tensors;
+        for (size_t i = 0; i < nparts; i++) {
+            tensors.push_back(parts[i]->tensor);
+        }
+        return new LlaisysTensor{llaisys::ops::linear_concat(tensors)};
+    }
+    void llaisysLinearSwiGLU(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t weight, llaisysTensor_t scales, llaisysTensor_t zeros, llaisysTensor_t bias) {
+        llaisys::ops::linear_swiglu(out->tensor, in->tensor, weight->tensor, bias ? bias->tensor : nullptr,
+                                    scales ? scales->tensor : nullptr, zeros ? zeros->tensor : nullptr);
+    }
+    llaisysTensor_t llaisysLinearSwiGLUInterleave(llaisysTensor_t gate, llaisysTensor_t up) {
+        return new LlaisysTensor{llaisys::ops::linear_swiglu_interleave(gate->tensor, up->tensor)};
+    }
+    void llaisysLinearQuantize(llaisysTensor_t qweight, llaisysTensor_t scales, llaisysTensor_t zeros, llaisysTensor_t weight) {
+        llaisys::ops::linear_quantize(qweight->tensor, scales->tensor, weight->tensor, zeros ? zeros->tensor : nullptr);
     }
     void llaisysRearrange(llaisysTensor_t out, llaisysTensor_t in) {
         llaisys::ops::rearrange(out->tensor, in->tensor);
@@ -34,9 +75,27 @@ __C {
     void llaisysROPE(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t pos_ids, float theta) {
         llaisys::ops::rope(out->tensor, in->tensor, pos_ids->tensor, theta);
     }
+    void llaisysROPETable(llaisysTensor_t table, float theta) {
+        llaisys::ops::rope_table(table->tensor, theta);
+    }
+    void llaisysROPEPaged(llaisysTensor_t q_out, llaisysTensor_t k_cache, llaisysTensor_t v_cache, llaisysTensor_t k_scales, llaisysTensor_t v_scales, llaisysTensor_t q, llaisysTensor_t k, llaisysTensor_t v, llaisysTensor_t pos_ids, llaisysTensor_t slots, llaisysTensor_t table, float theta) {
+        llaisys::ops::rope_paged(q_out->tensor, k_cache->tensor, v_cache->tensor, q->tensor, k->tensor, v->tensor, pos_ids->tensor, slots->tensor, table->tensor, theta, k_scales ? k_scales->tensor : nullptr, v_scales ? v_scales->tensor : nullptr);
+    }
+    void llaisysSample(llaisysTensor_t out_idx, llaisysTensor_t logits, float temperature, size_t top_k, float top_p, uint64_t seed) {
+        llaisys::ops::sample(out_idx->tensor, logits->tensor, temperature, top_k, top_p, seed);
+    }
     void llaisysSelfAttention(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k, llaisysTensor_t v, float scale) {
         llaisys::ops::self_attention(attn_val->tensor, q->tensor, k->tensor, v->tensor, scale);
     }
+    void llaisysSelfAttentionPaged(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k_cache, llaisysTensor_t v_cache, llaisysTensor_t block_table, size_t total_len, float scale) {
+        llaisys::ops::self_attention_paged(attn_val->tensor, q->tensor, k_cache->tensor, v_cache->tensor, block_table->tensor, total_len, scale);
+    }
+    void llaisysSelfAttentionPagedQuantized(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k_cache, llaisysTensor_t v_cache, llaisysTensor_t k_scales, llaisysTensor_t v_scales, llaisysTensor_t block_table, size_t total_len, float scale) {
+        llaisys::ops::self_attention_paged(attn_val->tensor, q->tensor, k_cache->tensor, v_cache->tensor, block_table->tensor, total_len, scale, k_scales->tensor, v_scales->tensor);
+    }
+    void llaisysSelfAttentionBatched(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k_cache, llaisysTensor_t v_cache, llaisysTensor_t k_scales, llaisysTensor_t v_scales, llaisysTensor_t block_tables, llaisysTensor_t q_offsets, llaisysTensor_t kv_lens, float scale) {
+        llaisys::ops::self_attention_batched(attn_val->tensor, q->tensor, k_cache->tensor, v_cache->tensor, block_tables->tensor, q_offsets->tensor, kv_lens->tensor, scale, k_scales ? k_scales->tensor : nullptr, v_scales ? v_scales->tensor : nullptr);
+    }
     void llaisysSwiGLU(llaisysTensor_t out, llaisysTensor_t gate, llaisysTensor_t up) {
         llaisys::ops::swiglu(out->tensor, gate->tensor, up->tensor);
     }
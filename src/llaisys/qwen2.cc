@@ -0,0 +1,158 @@
+#include "llaisys/models/qwen2.h"
+
+#include "llaisys_tensor.hpp"
+
+#include "../models/qwen2/qwen2.hpp"
+
+#include <memory>
+#include <vector>
+
+__C {
+    struct LlaisysQwen2Model {
+        std::unique_ptr<llaisys::models::Qwen2> model;
+        // C handles of the weights, made by the first llaisysQwen2ModelWeights and
+        // sharing the tensors of the model, and the weight of each handle, to point them
+        // at the tensors of a checkpoint once loaded.
+        LlaisysQwen2Weights weights;
+        std::vector<std::unique_ptr<LlaisysTensor>> handles;
+        std::vector<const llaisys::tensor_t *> sources;
+        std::vector<std::vector<llaisysTensor_t>> layer_handles;
+    };
+}
+
+namespace {
+llaisysTensor_t wrap(LlaisysQwen2Model *model, const llaisys::tensor_t &tensor) {
+    model->handles.push_back(std::make_unique<LlaisysTensor>(LlaisysTensor{tensor}));
+    model->sources.push_back(&tensor);
+    return model->handles.back().get();
+}
+
+llaisysTensor_t *wrap_layers(LlaisysQwen2Model *model, const std::vector<llaisys::tensor_t> &tensors) {
+    std::vector<llaisysTensor_t> layer;
+    for (const auto &tensor : tensors) {
+        layer.push_back(wrap(model, tensor));
+    }
+    model->layer_handles.push_back(std::move(layer));
+    return model->layer_handles.back().data();
+}
+
+// Point the handles, if any, at the current tensors of their weights.
+void sync(LlaisysQwen2Model *model) {
+    for (size_t i = 0; i < model->handles.size(); i++) {
+        model->handles[i]->tensor = *model->sources[i];
+    }
+}
+} // namespace
+
+__C {
+    struct LlaisysQwen2Model *llaisysQwen2ModelCreate(const LlaisysQwen2Meta *meta, llaisysDeviceType_t device, int *device_ids, int ndevice) {
+        int device_id = (device_ids && ndevice > 0) ? device_ids[0] : 0;
+        auto model = std::make_unique<LlaisysQwen2Model>();
+        model->model = std::make_unique<llaisys::models::Qwen2>(*meta, device, device_id);
+
+        return model.release();
+    }
+
+    void llaisysQwen2ModelDestroy(struct LlaisysQwen2Model * model) {
+        delete model;
+    }
+
+    struct LlaisysQwen2Weights *llaisysQwen2ModelWeights(struct LlaisysQwen2Model * model) {
+        auto &w = model->model->weights();
+        if (!model->handles.empty()) {
+            sync(model);
+            return &model->weights;
+        }
+        auto &cw = model->weights;
+        cw.in_embed = wrap(model, w.in_embed);
+        cw.out_embed = wrap(model, w.out_embed);
+        cw.out_norm_w = wrap(model, w.out_norm_w);
+        cw.attn_norm_w = wrap_layers(model, w.attn_norm_w);
+        cw.attn_q_w = wrap_layers(model, w.attn_q_w);
+        cw.attn_q_b = wrap_layers(model, w.attn_q_b);
+        cw.attn_k_w = wrap_layers(model, w.attn_k_w);
+        cw.attn_k_b = wrap_layers(model, w.attn_k_b);
+        cw.attn_v_w = wrap_layers(model, w.attn_v_w);
+        cw.attn_v_b = wrap_layers(model, w.attn_v_b);
+        cw.attn_o_w = wrap_layers(model, w.attn_o_w);
+        cw.mlp_norm_w = wrap_layers(model, w.mlp_norm_w);
+        cw.mlp_gate_w = wrap_layers(model, w.mlp_gate_w);
+        cw.mlp_up_w = wrap_layers(model, w.mlp_up_w);
+        cw.mlp_down_w = wrap_layers(model, w.mlp_down_w);
+        return &model->weights;
+    }
+
+    void llaisysQwen2ModelLoad(struct LlaisysQwen2Model * model, const char *path) {
+        model->model->load(path);
+        sync(model);
+    }
+
+    int64_t llaisysQwen2ModelInfer(struct LlaisysQwen2Model * model, int64_t * token_ids, size_t ntoken) {
+        return model->model->infer(token_ids, ntoken);
+    }
+
+    llaisysTensor_t llaisysQwen2ModelLogits(struct LlaisysQwen2Model * model) {
+        return new LlaisysTensor{model->model->logits()};
+    }
+
+    size_t llaisysQwen2ModelGenerate(struct LlaisysQwen2Model * model, int64_t * token_ids, size_t ntoken, int64_t * new_tokens, size_t max_new_tokens, float temperature, size_t top_k, float top_p, uint64_t seed, LlaisysQwen2TokenCallback callback, void *user) {
+        return model->model->generate(token_ids, ntoken, new_tokens, max_new_tokens, temperature, top_k, top_p, seed,
+                                      callback, user);
+    }
+
+    void llaisysQwen2ModelCancel(struct LlaisysQwen2Model * model) {
+        model->model->cancel();
+    }
+
+    void llaisysQwen2ModelTruncateCache(struct LlaisysQwen2Model * model, size_t length) {
+        model->model->truncateCache(length);
+    }
+
+    void llaisysQwen2ModelResetCache(struct LlaisysQwen2Model * model) {
+        model->model->resetCache();
+    }
+
+    void llaisysQwen2ModelSetKVCacheType(struct LlaisysQwen2Model * model, llaisysDataType_t dtype) {
+        model->model->setKVCacheType(dtype);
+    }
+
+    void llaisysQwen2ModelSetKVCacheCapacity(struct LlaisysQwen2Model * model, size_t ntoken) {
+        model->model->setKVCacheCapacity(ntoken);
+    }
+
+    void llaisysQwen2ModelSetWeightFormat(struct LlaisysQwen2Model * model, llaisysQwen2WeightFormat_t format) {
+        model->model->setWeightFormat(format);
+    }
+
+    void llaisysQwen2ModelSetStreaming(struct LlaisysQwen2Model * model, size_t sink_tokens, size_t window) {
+        model->model->setStreaming(sink_tokens, window);
+    }
+
+    void llaisysQwen2ModelCacheStats(struct LlaisysQwen2Model * model, struct LlaisysQwen2CacheStats * stats) {
+        *stats = model->model->cacheStats();
+    }
+
+    int64_t llaisysQwen2ModelCreateSequence(struct LlaisysQwen2Model * model) {
+        return model->model->createSequence();
+    }
+
+    void llaisysQwen2ModelDestroySequence(struct LlaisysQwen2Model * model, int64_t seq) {
+        model->model->destroySequence(seq);
+    }
+
+    void llaisysQwen2ModelAppendTokens(struct LlaisysQwen2Model * model, int64_t seq, int64_t * token_ids, size_t ntoken) {
+        model->model->appendTokens(seq, token_ids, ntoken);
+    }
+
+    void llaisysQwen2ModelSetPrefillChunk(struct LlaisysQwen2Model * model, size_t ntoken) {
+        model->model->setPrefillChunk(ntoken);
+    }
+
+    size_t llaisysQwen2ModelQueuedTokens(struct LlaisysQwen2Model * model) {
+        return model->model->queuedTokens();
+    }
+
+    size_t llaisysQwen2ModelStep(struct LlaisysQwen2Model * model, int64_t * seq_ids, int64_t * next_tokens, size_t capacity) {
+        return model->model->step(seq_ids, next_tokens, capacity);
+    }
+}
@@ -1,5 +1,6 @@
 #include "llaisys/runtime.h"
 #include "../core/context/context.hpp"
+#include "../core/thread_pool/thread_pool.hpp"
 #include "../device/runtime_api.hpp"
 
 // Llaisys API for setting context runtime.
@@ -10,4 +11,18 @@ __C void llaisysSetContextRuntime(llaisysDeviceType_t device_type, int device_id
 // Llaisys API for getting the runtime APIs
 __C const LlaisysRuntimeAPI *llaisysGetRuntimeAPI(llaisysDeviceType_t device_type) {
     return llaisys::device::getRuntimeAPI(device_type);
-}
\ No newline at end of file
+}
+
+// Llaisys API for configuring the CPU thread pool.
+__C void llaisysSetNumThreads(int num_threads) {
+    // A count that is not positive restores the default rather than failing.
+    llaisys::core::threadPool().setNumThreads(num_threads > 0 ? static_cast<size_t>(num_threads) : 0);
+}
+
+__C int llaisysGetNumThreads() {
+    return static_cast<int>(llaisys::core::threadPool().numThreads());
+}
+
+__C void llaisysSetThreadPinning(int pin) {
+    llaisys::core::threadPool().setPinning(pin != 0);
+}
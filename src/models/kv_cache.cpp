@@ -0,0 +1,484 @@
+#include "kv_cache.hpp"
+
+#include "../core/llaisys_core.hpp"
+#include "../utils.hpp"
+
+#include "../ops/linear/op.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace llaisys::models {
+namespace {
+// dst = src for two contiguous tensors of the same size on one device.
+void copy(tensor_t dst, tensor_t src) {
+    const size_t bytes = src->numel() * src->elementSize();
+    if (dst->deviceType() == LLAISYS_DEVICE_CPU) {
+        std::memcpy(dst->data(), src->data(), bytes);
+        return;
+    }
+    core::context().setDevice(dst->deviceType(), dst->deviceId());
+    core::context().runtime().api()->memcpy_sync(dst->data(), src->data(), bytes, LLAISYS_MEMCPY_D2D);
+}
+
+// Positions [first, first + n) of a [nblocks, block_size, ...] pool buffer, counted
+// across blocks, as a contiguous [n, ...] tensor.
+tensor_t rows(tensor_t t, size_t first, size_t n) {
+    std::vector<size_t> shape(t->shape().begin() + 1, t->shape().end());
+    shape[0] *= t->shape()[0];
+    return t->view(shape)->slice(0, first, first + n);
+}
+
+uint64_t mix(uint64_t x) {
+    // splitmix64 finalizer.
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+} // namespace
+
+KVBlockPool::KVBlockPool(size_t nlayer, size_t nblocks, size_t block_size, size_t nkvh, size_t dh, size_t dv,
+                         llaisysDataType_t dtype, llaisysDeviceType_t device_type, int device)
+    : _nblocks(nblocks), _block_size(block_size), _refs(nblocks, 0), _hash(nblocks, 0), _registered(nblocks, false),
+      _entries(nblocks), _lru_pos(nblocks) {
+    CHECK_ARGUMENT(nblocks > 0 && block_size > 0, "KVBlockPool: block count and size must be positive");
+    const bool quantized = dtype == LLAISYS_DTYPE_I8 || dtype == LLAISYS_DTYPE_F8 || dtype == LLAISYS_DTYPE_F8_E5M2;
+    CHECK_ARGUMENT(quantized || dtype == LLAISYS_DTYPE_F32 || dtype == LLAISYS_DTYPE_F16 || dtype == LLAISYS_DTYPE_BF16,
+                   "KVBlockPool: dtype must be F32, F16, BF16, I8, F8 or F8_E5M2");
+    _keys.reserve(nlayer);
+    _values.reserve(nlayer);
+    for (size_t i = 0; i < nlayer; i++) {
+        _keys.push_back(Tensor::create({nblocks, block_size, nkvh, dh}, dtype, device_type, device));
+        _values.push_back(Tensor::create({nblocks, block_size, nkvh, dv}, dtype, device_type, device));
+        if (quantized) {
+            _key_scales.push_back(Tensor::create({nblocks, block_size, nkvh}, LLAISYS_DTYPE_F32, device_type, device));
+            _value_scales.push_back(Tensor::create({nblocks, block_size, nkvh}, LLAISYS_DTYPE_F32, device_type, device));
+        }
+    }
+    _free.reserve(nblocks);
+    for (size_t i = nblocks; i > 0; i--) {
+        _free.push_back(static_cast<int64_t>(i - 1));
+    }
+}
+
+size_t KVBlockPool::nlayer() const {
+    return _keys.size();
+}
+
+size_t KVBlockPool::nblocks() const {
+    return _nblocks;
+}
+
+size_t KVBlockPool::blockSize() const {
+    return _block_size;
+}
+
+size_t KVBlockPool::freeBlocks() const {
+    return _free.size();
+}
+
+size_t KVBlockPool::cachedBlocks() const {
+    return _lru.size();
+}
+
+llaisysDataType_t KVBlockPool::dtype() const {
+    return _keys.at(0)->dtype();
+}
+
+bool KVBlockPool::quantized() const {
+    return !_key_scales.empty();
+}
+
+const KVBlockPool::Stats &KVBlockPool::stats() const {
+    return _stats;
+}
+
+tensor_t KVBlockPool::keys(size_t layer) const {
+    return _keys.at(layer);
+}
+
+tensor_t KVBlockPool::values(size_t layer) const {
+    return _values.at(layer);
+}
+
+tensor_t KVBlockPool::keyScales(size_t layer) const {
+    return quantized() ? _key_scales.at(layer) : nullptr;
+}
+
+tensor_t KVBlockPool::valueScales(size_t layer) const {
+    return quantized() ? _value_scales.at(layer) : nullptr;
+}
+
+int64_t KVBlockPool::allocate() {
+    int64_t block;
+    if (!_free.empty()) {
+        block = _free.back();
+        _free.pop_back();
+    } else {
+        CHECK_ARGUMENT(!_lru.empty(), "KVBlockPool: out of blocks");
+        block = _lru.front();
+        _lru.pop_front();
+        _cached.erase(_hash[block]);
+        _registered[block] = false;
+        _entries[block] = {};
+        _stats.evictions++;
+    }
+    _refs[block] = 1;
+    return block;
+}
+
+void KVBlockPool::acquire(int64_t block) {
+    CHECK_ARGUMENT(block >= 0 && static_cast<size_t>(block) < _nblocks, "KVBlockPool: invalid block");
+    CHECK_ARGUMENT(_refs[block] > 0 || _registered[block], "KVBlockPool: cannot acquire a free block");
+    if (_refs[block]++ == 0) {
+        _lru.erase(_lru_pos[block]);
+    }
+}
+
+void KVBlockPool::release(int64_t block) {
+    CHECK_ARGUMENT(block >= 0 && static_cast<size_t>(block) < _nblocks && _refs[block] > 0,
+                   "KVBlockPool: invalid block release");
+    if (--_refs[block] > 0) {
+        return;
+    }
+    if (_registered[block]) {
+        _lru_pos[block] = _lru.insert(_lru.end(), block);
+    } else {
+        _free.push_back(block);
+    }
+}
+
+uint32_t KVBlockPool::refCount(int64_t block) const {
+    return _refs.at(block);
+}
+
+uint64_t KVBlockPool::hash(uint64_t parent, const int64_t *tokens, size_t n) {
+    uint64_t h = mix(parent + 0x9e3779b97f4a7c15ULL);
+    for (size_t i = 0; i < n; i++) {
+        h = mix(h ^ static_cast<uint64_t>(tokens[i]));
+    }
+    return h;
+}
+
+void KVBlockPool::registerBlock(int64_t block, uint64_t parent, const int64_t *tokens) {
+    CHECK_ARGUMENT(block >= 0 && static_cast<size_t>(block) < _nblocks && _refs[block] > 0,
+                   "KVBlockPool: only a block in use can be registered");
+    const uint64_t h = hash(parent, tokens, _block_size);
+    if (_registered[block] || _cached.count(h)) {
+        return;
+    }
+    _cached.emplace(h, block);
+    _hash[block] = h;
+    _registered[block] = true;
+    _entries[block] = {parent, std::vector<int64_t>(tokens, tokens + _block_size)};
+}
+
+void KVBlockPool::unregisterBlock(int64_t block) {
+    if (!registered(block)) {
+        return;
+    }
+    _cached.erase(_hash[block]);
+    _registered[block] = false;
+    _entries[block] = {};
+    if (_refs[block] == 0) {
+        _lru.erase(_lru_pos[block]);
+        _free.push_back(block);
+    }
+}
+
+bool KVBlockPool::registered(int64_t block) const {
+    return _registered.at(block);
+}
+
+int64_t KVBlockPool::lookup(uint64_t parent, const int64_t *tokens) {
+    _stats.lookups++;
+    auto it = _cached.find(hash(parent, tokens, _block_size));
+    if (it == _cached.end()) {
+        return -1;
+    }
+    // Compare the contents too, so that a hash collision is a miss.
+    const Entry &entry = _entries[it->second];
+    if (entry.parent != parent || !std::equal(entry.tokens.begin(), entry.tokens.end(), tokens)) {
+        return -1;
+    }
+    _stats.hits++;
+    return it->second;
+}
+
+void KVBlockPool::copyBlock(int64_t dst, int64_t src, size_t n) {
+    CHECK_ARGUMENT(n <= _block_size, "KVBlockPool: cannot copy more than a block");
+    for (size_t i = 0; i < nlayer(); i++) {
+        for (const auto &t : {keys(i), values(i), keyScales(i), valueScales(i)}) {
+            if (t) {
+                copy(rows(t, dst * _block_size, n), rows(t, src * _block_size, n));
+            }
+        }
+    }
+}
+
+KVCache::KVCache(std::shared_ptr<KVBlockPool> pool, size_t capacity, bool streaming, size_t sinks)
+    : _pool(std::move(pool)), _capacity(capacity), _streaming(streaming) {
+    CHECK_ARGUMENT(_pool != nullptr, "KVCache: no block pool");
+    CHECK_ARGUMENT(capacity > 0, "KVCache: capacity must be positive");
+    const size_t block_size = _pool->blockSize();
+    _sink_length = streaming ? (sinks + block_size - 1) / block_size * block_size : 0;
+    CHECK_ARGUMENT(!streaming || capacity >= _sink_length + 2 * block_size,
+                   "KVCache: a streaming cache needs two blocks past its sinks");
+    const size_t max_blocks = (capacity + block_size - 1) / block_size;
+    _blocks.reserve(max_blocks);
+    _tokens.reserve(capacity);
+    const auto &keys = _pool->keys(0);
+    _block_table = Tensor::create({max_blocks}, LLAISYS_DTYPE_I64, keys->deviceType(), keys->deviceId());
+}
+
+KVCache::~KVCache() {
+    reset();
+}
+
+void KVCache::_push(int64_t block) {
+    _block_table->slice(0, _blocks.size(), _blocks.size() + 1)->load(&block);
+    _blocks.push_back(block);
+}
+
+const KVBlockPool &KVCache::pool() const {
+    return *_pool;
+}
+
+size_t KVCache::nlayer() const {
+    return _pool->nlayer();
+}
+
+size_t KVCache::capacity() const {
+    return _capacity;
+}
+
+size_t KVCache::length() const {
+    return _tokens.size();
+}
+
+const std::vector<int64_t> &KVCache::tokens() const {
+    return _tokens;
+}
+
+bool KVCache::streaming() const {
+    return _streaming;
+}
+
+size_t KVCache::sinkLength() const {
+    return _sink_length;
+}
+
+size_t KVCache::evicted() const {
+    return _evicted;
+}
+
+size_t KVCache::maxReserve() const {
+    // A streaming cache can drop every full block past its sinks, not the partial last one.
+    return _streaming ? _capacity - _sink_length - _pool->blockSize() + 1 : _capacity;
+}
+
+size_t KVCache::match(const int64_t *tokens, size_t limit) {
+    const size_t block_size = _pool->blockSize();
+    if (length() % block_size != 0 || _evicted > 0) {
+        return 0;
+    }
+    // Blocks reserved past the committed positions are replaced by the matches.
+    truncate(length());
+    limit = std::min(limit, _capacity);
+    const size_t start = length();
+    while (length() + block_size <= limit) {
+        const uint64_t parent = _hashes.empty() ? 0 : _hashes.back();
+        const int64_t *block_tokens = tokens + length();
+        const int64_t block = _pool->lookup(parent, block_tokens);
+        if (block < 0) {
+            break;
+        }
+        _pool->acquire(block);
+        _push(block);
+        _tokens.insert(_tokens.end(), block_tokens, block_tokens + block_size);
+        _hashes.push_back(KVBlockPool::hash(parent, block_tokens, block_size));
+    }
+    return length() - start;
+}
+
+void KVCache::reserve(size_t n) {
+    if (_streaming) {
+        CHECK_ARGUMENT(n <= maxReserve(), "KVCache: too many positions for a streaming cache");
+        while (length() + n > _capacity) {
+            _evict();
+        }
+    }
+    CHECK_ARGUMENT(length() + n <= _capacity, "KVCache: out of capacity");
+    const size_t needed = (length() + n + _pool->blockSize() - 1) / _pool->blockSize();
+    while (_blocks.size() < needed) {
+        _push(_pool->allocate());
+    }
+}
+
+void KVCache::write(size_t layer, tensor_t k, tensor_t v) {
+    CHECK_ARGUMENT(v->shape()[0] == k->shape()[0], "KVCache: key and value counts must match");
+    _store(layer, length(), k, v);
+}
+
+void KVCache::writeKeys(size_t layer, size_t first, tensor_t k) {
+    _store(layer, first, k, nullptr);
+}
+
+void KVCache::_store(size_t layer, size_t first, tensor_t k, tensor_t v) {
+    const size_t n = k->shape()[0];
+    const size_t block_size = _pool->blockSize();
+    CHECK_ARGUMENT(first + n <= _blocks.size() * block_size, "KVCache: positions not reserved");
+    ASSERT(k->isContiguous() && (!v || v->isContiguous()), "KVCache: keys and values must be contiguous.");
+    auto keys = _pool->keys(layer);
+    auto values = _pool->values(layer);
+    const size_t nkvh = keys->shape()[2], dh = keys->shape()[3], dv = values->shape()[3];
+    CHECK_ARGUMENT(k->numel() == n * nkvh * dh && (!v || v->numel() == n * nkvh * dv),
+                   "KVCache: keys and values must be [n, nkvh, d]");
+    const bool quantized = _pool->quantized();
+    if (!quantized) {
+        CHECK_SAME_DTYPE(keys->dtype(), k->dtype());
+        if (v) {
+            CHECK_SAME_DTYPE(keys->dtype(), v->dtype());
+        }
+    }
+
+    // One copy per run of positions within a block. A quantized cache gets each head
+    // of each position as a row with its own scale.
+    for (size_t i = 0; i < n;) {
+        const size_t pos = first + i;
+        const auto block = static_cast<size_t>(_blocks[pos / block_size]);
+        const size_t offset = pos % block_size;
+        const size_t m = std::min(block_size - offset, n - i);
+        auto slots = [&](tensor_t t) { return rows(t, block * block_size + offset, m); };
+        if (quantized) {
+            ops::linear_quantize(slots(keys)->view({m * nkvh, dh}), slots(_pool->keyScales(layer))->view({m * nkvh, 1}),
+                                 k->slice(0, i, i + m)->view({m * nkvh, dh}));
+            if (v) {
+                ops::linear_quantize(slots(values)->view({m * nkvh, dv}),
+                                     slots(_pool->valueScales(layer))->view({m * nkvh, 1}),
+                                     v->slice(0, i, i + m)->view({m * nkvh, dv}));
+            }
+        } else {
+            copy(slots(keys), k->slice(0, i, i + m));
+            if (v) {
+                copy(slots(values), v->slice(0, i, i + m));
+            }
+        }
+        i += m;
+    }
+}
+
+tensor_t KVCache::keys(size_t layer) const {
+    return _pool->keys(layer);
+}
+
+tensor_t KVCache::values(size_t layer) const {
+    return _pool->values(layer);
+}
+
+tensor_t KVCache::keyScales(size_t layer) const {
+    return _pool->keyScales(layer);
+}
+
+tensor_t KVCache::valueScales(size_t layer) const {
+    return _pool->valueScales(layer);
+}
+
+tensor_t KVCache::blockTable(size_t n) const {
+    const size_t used = (length() + n + _pool->blockSize() - 1) / _pool->blockSize();
+    CHECK_ARGUMENT(used <= _blocks.size(), "KVCache: positions not reserved");
+    return _block_table->slice(0, 0, used);
+}
+
+const std::vector<int64_t> &KVCache::blocks() const {
+    return _blocks;
+}
+
+int64_t KVCache::row(size_t t) const {
+    const size_t block_size = _pool->blockSize();
+    return _blocks.at(t / block_size) * static_cast<int64_t>(block_size) + static_cast<int64_t>(t % block_size);
+}
+
+void KVCache::advance(size_t n, const int64_t *tokens) {
+    const size_t block_size = _pool->blockSize();
+    CHECK_ARGUMENT(length() + n <= _blocks.size() * block_size, "KVCache: positions not reserved");
+    _tokens.insert(_tokens.end(), tokens, tokens + n);
+    // Offer every block filled by now to later sequences, while the blocks still hold a
+    // prefix of the sequence.
+    for (size_t b = _hashes.size(); _evicted == 0 && (b + 1) * block_size <= length(); b++) {
+        const uint64_t parent = b == 0 ? 0 : _hashes[b - 1];
+        const int64_t *block_tokens = _tokens.data() + b * block_size;
+        _pool->registerBlock(_blocks[b], parent, block_tokens);
+        _hashes.push_back(KVBlockPool::hash(parent, block_tokens, block_size));
+    }
+}
+
+void KVCache::truncate(size_t length) {
+    CHECK_ARGUMENT(length <= this->length(), "KVCache: cannot truncate past the cached length");
+    CHECK_ARGUMENT(_evicted == 0 || length >= _sink_length, "KVCache: cannot truncate the sinks of a streaming cache");
+    const size_t block_size = _pool->blockSize();
+    _tokens.resize(length);
+    _hashes.resize(std::min(_hashes.size(), length / block_size));
+    const size_t used = (length + block_size - 1) / block_size;
+    while (_blocks.size() > used) {
+        _pool->release(_blocks.back());
+        _blocks.pop_back();
+    }
+    // The rows past `length` of a now partial block will be overwritten, so it can no
+    // longer be offered for its prefix. A block other sequences use is left to them
+    // and its kept rows copied.
+    if (length % block_size == 0 || !_pool->registered(_blocks.back())) {
+        return;
+    }
+    if (_pool->refCount(_blocks.back()) == 1) {
+        _pool->unregisterBlock(_blocks.back());
+    } else {
+        const int64_t shared = _blocks.back();
+        const int64_t block = _pool->allocate();
+        _pool->copyBlock(block, shared, length % block_size);
+        _pool->release(shared);
+        _blocks.pop_back();
+        _push(block);
+    }
+}
+
+void KVCache::reset() {
+    _evicted = 0;
+    truncate(0);
+}
+
+void KVCache::_evict() {
+    const size_t block_size = _pool->blockSize();
+    const size_t sink_blocks = _sink_length / block_size;
+    CHECK_ARGUMENT(length() >= _sink_length + block_size, "KVCache: no full block to evict");
+    // The sinks will be rewritten at other positions: blocks other sequences may still
+    // look up for their prefix are left to them.
+    if (_evicted == 0) {
+        for (size_t b = 0; b < sink_blocks; b++) {
+            const int64_t shared = _blocks[b];
+            if (!_pool->registered(shared)) {
+                continue;
+            }
+            if (_pool->refCount(shared) == 1) {
+                _pool->unregisterBlock(shared);
+                continue;
+            }
+            const int64_t block = _pool->allocate();
+            _pool->copyBlock(block, shared, block_size);
+            _pool->release(shared);
+            _blocks[b] = block;
+            _block_table->slice(0, b, b + 1)->load(&block);
+        }
+    }
+    _pool->release(_blocks[sink_blocks]);
+    _blocks.erase(_blocks.begin() + sink_blocks);
+    _tokens.erase(_tokens.begin() + _sink_length, _tokens.begin() + _sink_length + block_size);
+    _hashes.resize(std::min(_hashes.size(), sink_blocks));
+    _evicted += block_size;
+    if (_blocks.size() > sink_blocks) {
+        _block_table->slice(0, sink_blocks, _blocks.size())->load(_blocks.data() + sink_blocks);
+    }
+}
+} // namespace llaisys::models
@@ -0,0 +1,197 @@
+#pragma once
+
+#include "../tensor/tensor.hpp"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace llaisys::models {
+// Positions per block of a KVBlockPool unless the owner chooses otherwise.
+constexpr size_t KV_BLOCK_SIZE = 16;
+
+// Fixed-size blocks of keys and values shared by the sequences of a decoder. Each
+// layer owns a key buffer [nblocks, block_size, nkvh, dh] and a value buffer
+// [nblocks, block_size, nkvh, dv], allocated once; block i of every layer holds the
+// same positions. Free blocks are handed out lowest index first and released ones
+// are reused first, so the pages in use stay at the front of the buffers.
+//
+// The buffers are stored in F32, F16 or BF16, or quantized to I8, F8 or F8_E5M2 with
+// an F32 scale per head of each position, in [nblocks, block_size, nkvh] buffers.
+//
+// Prefix caching: a full block can be registered under a hash of its tokens and of
+// every token before it. Registered blocks may be shared by several sequences, and
+// when the last one releases them they stay cached, least recently used first in
+// line for eviction once no free block is left, until a sequence looks up the same
+// prefix again.
+class KVBlockPool {
+public:
+    struct Stats {
+        // Full blocks looked up by prefix, and those found in the pool.
+        size_t lookups = 0;
+        size_t hits = 0;
+        // Cached blocks reclaimed for new positions.
+        size_t evictions = 0;
+    };
+
+private:
+    struct Entry {
+        uint64_t parent;
+        std::vector<int64_t> tokens;
+    };
+
+    std::vector<tensor_t> _keys;
+    std::vector<tensor_t> _values;
+    std::vector<tensor_t> _key_scales;
+    std::vector<tensor_t> _value_scales;
+    size_t _nblocks;
+    size_t _block_size;
+    // Free block indices, the next one to hand out at the back.
+    std::vector<int64_t> _free;
+    std::vector<uint32_t> _refs;
+    // Registered blocks by hash, with the hash and contents of each.
+    std::unordered_map<uint64_t, int64_t> _cached;
+    std::vector<uint64_t> _hash;
+    std::vector<bool> _registered;
+    std::vector<Entry> _entries;
+    // Registered blocks no sequence uses, least recently released first.
+    std::list<int64_t> _lru;
+    std::vector<std::list<int64_t>::iterator> _lru_pos;
+    Stats _stats;
+
+public:
+    KVBlockPool(size_t nlayer, size_t nblocks, size_t block_size, size_t nkvh, size_t dh, size_t dv,
+                llaisysDataType_t dtype, llaisysDeviceType_t device_type = LLAISYS_DEVICE_CPU, int device = 0);
+
+    size_t nlayer() const;
+    size_t nblocks() const;
+    size_t blockSize() const;
+    // Blocks holding nothing, and registered blocks kept only for their prefix.
+    size_t freeBlocks() const;
+    size_t cachedBlocks() const;
+    llaisysDataType_t dtype() const;
+    bool quantized() const;
+    const Stats &stats() const;
+
+    // Buffers of a layer, [nblocks, block_size, nkvh, d].
+    tensor_t keys(size_t layer) const;
+    tensor_t values(size_t layer) const;
+    // Scales of a quantized layer, [nblocks, block_size, nkvh]; null otherwise.
+    tensor_t keyScales(size_t layer) const;
+    tensor_t valueScales(size_t layer) const;
+
+    // Take a block for new positions, evicting the least recently used cached block if
+    // none is free; throws when every block is in use.
+    int64_t allocate();
+    // Add a user to a block, e.g. one returned by lookup.
+    void acquire(int64_t block);
+    // Drop a user; a block left without users is freed, or cached if registered.
+    void release(int64_t block);
+    uint32_t refCount(int64_t block) const;
+
+    // Hash of the block_size tokens of a full block following the prefix hashed as
+    // `parent` (0 for the first block).
+    static uint64_t hash(uint64_t parent, const int64_t *tokens, size_t n);
+    // Register a full block holding `tokens` after the prefix `parent`, unless an
+    // equal block is registered already.
+    void registerBlock(int64_t block, uint64_t parent, const int64_t *tokens);
+    void unregisterBlock(int64_t block);
+    bool registered(int64_t block) const;
+    // The registered block holding `tokens` after the prefix `parent`, or -1.
+    int64_t lookup(uint64_t parent, const int64_t *tokens);
+
+    // Copy the first `rows` positions of block src into dst, in every layer.
+    void copyBlock(int64_t dst, int64_t src, size_t rows);
+};
+
+// Keys and values of one sequence, stored in blocks of a shared KVBlockPool and
+// addressed through a block table: position t lives at row t % block_size of block
+// blockTable()[t / block_size]. Blocks are taken as the sequence grows and returned
+// when it is truncated or destroyed. A forward pass over n new positions reserves
+// them, writes their keys and values for every layer, attends through the block
+// table, and commits the positions and their tokens with advance. Each block it
+// fills is registered in the pool, so that a later sequence starting with the same
+// tokens can take it over with match instead of recomputing it.
+//
+// A streaming cache never runs out of capacity: once full, it drops the oldest block
+// after its first sinkLength() positions, the attention sinks, to make room, and the
+// freed block takes the next positions. Slot s then holds position s if it is a sink
+// and s + evicted() otherwise. The owner keeps the sinks just before the oldest kept
+// position, by rewriting their keys (writeKeys) as if they sat at positions
+// evicted() + s, so that every query sees the same distances as in a cache of the
+// kept positions alone. Blocks past the sinks are no longer offered to other
+// sequences once a position was dropped.
+class KVCache {
+private:
+    std::shared_ptr<KVBlockPool> _pool;
+    std::vector<int64_t> _blocks;
+    // _blocks mirrored on the pool's device, for the attention kernel.
+    tensor_t _block_table;
+    // Token of each committed position, and prefix hash of each full block.
+    std::vector<int64_t> _tokens;
+    std::vector<uint64_t> _hashes;
+    size_t _capacity;
+    bool _streaming;
+    size_t _sink_length;
+    size_t _evicted = 0;
+
+    void _push(int64_t block);
+    void _evict();
+    void _store(size_t layer, size_t first, tensor_t k, tensor_t v);
+
+public:
+    // A sequence of at most `capacity` positions, or a streaming cache of `capacity`
+    // slots keeping the first `sinks` positions, rounded up to whole blocks.
+    KVCache(std::shared_ptr<KVBlockPool> pool, size_t capacity, bool streaming = false, size_t sinks = 0);
+    ~KVCache();
+    KVCache(const KVCache &) = delete;
+    KVCache &operator=(const KVCache &) = delete;
+
+    const KVBlockPool &pool() const;
+    size_t nlayer() const;
+    size_t capacity() const;
+    // Number of committed slots, and the token of each.
+    size_t length() const;
+    const std::vector<int64_t> &tokens() const;
+    bool streaming() const;
+    size_t sinkLength() const;
+    // Positions dropped from a streaming cache.
+    size_t evicted() const;
+    // Most positions a single reserve can take.
+    size_t maxReserve() const;
+
+    // Append the cached blocks of the pool that continue this sequence with
+    // tokens[length(), limit), one full block at a time, and return the number of
+    // positions gained. Only a sequence ending on a block boundary can be extended.
+    size_t match(const int64_t *tokens, size_t limit);
+    // Take the blocks for the next n positions, evicting old ones if streaming.
+    void reserve(size_t n);
+    // Store k[n, nkvh, dh] and v[n, nkvh, dv] as the next n positions of a layer,
+    // quantizing each head of each position if the pool is quantized.
+    void write(size_t layer, tensor_t k, tensor_t v);
+    // Overwrite the keys of slots [first, first + n) of a layer with k[n, nkvh, dh].
+    void writeKeys(size_t layer, size_t first, tensor_t k);
+    // Block buffers and scales of a layer, see KVBlockPool.
+    tensor_t keys(size_t layer) const;
+    tensor_t values(size_t layer) const;
+    tensor_t keyScales(size_t layer) const;
+    tensor_t valueScales(size_t layer) const;
+    // Blocks holding the committed positions and the next n, [ceil((length() + n) / block_size)].
+    tensor_t blockTable(size_t n = 0) const;
+    // Every block taken, including those reserved, on the host.
+    const std::vector<int64_t> &blocks() const;
+    // Row of slot t in the pool's buffers viewed as [nblocks * block_size, ...], for
+    // kernels that store positions themselves, e.g. ops::rope_paged.
+    int64_t row(size_t t) const;
+
+    // Commit the next n positions, holding tokens[0, n) and written to every layer.
+    void advance(size_t n, const int64_t *tokens);
+    // Drop every slot from `length` on, returning the blocks no longer used. A shared
+    // block that will be written again is copied first. A streaming cache that evicted
+    // positions keeps its sinks.
+    void truncate(size_t length);
+    void reset();
+};
+} // namespace llaisys::models
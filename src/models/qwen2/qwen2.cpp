@@ -0,0 +1,810 @@
+#include "qwen2.hpp"
+
+#include "../../utils.hpp"
+#include "../safetensors.hpp"
+
+#include "../../ops/argmax/op.hpp"
+#include "../../ops/cast/op.hpp"
+#include "../../ops/embedding/op.hpp"
+#include "../../ops/linear/op.hpp"
+#include "../../ops/rms_norm/op.hpp"
+#include "../../ops/rope/op.hpp"
+#include "../../ops/sample/op.hpp"
+#include "../../ops/self_attention/op.hpp"
+#include "../../ops/swiglu/op.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <tuple>
+#include <unordered_map>
+
+namespace llaisys::models {
+Qwen2::Qwen2(const LlaisysQwen2Meta &meta, llaisysDeviceType_t device_type, int device)
+    : _meta(meta), _device_type(device_type), _device(device) {
+    CHECK_ARGUMENT(meta.nlayer > 0 && meta.hs > 0 && meta.nh > 0 && meta.nkvh > 0 && meta.dh > 0 && meta.di > 0
+                       && meta.voc > 0,
+                   "Qwen2: model dimensions must be positive");
+    CHECK_ARGUMENT(meta.nh % meta.nkvh == 0, "Qwen2: query heads must be a multiple of key/value heads");
+
+    for (auto *layers : {&_weights.attn_norm_w, &_weights.attn_q_w, &_weights.attn_q_b, &_weights.attn_k_w,
+                         &_weights.attn_k_b, &_weights.attn_v_w, &_weights.attn_v_b, &_weights.attn_o_w,
+                         &_weights.mlp_norm_w, &_weights.mlp_gate_w, &_weights.mlp_up_w, &_weights.mlp_down_w}) {
+        layers->resize(meta.nlayer);
+    }
+    _rope_table = Tensor::create({meta.maxseq, meta.dh}, LLAISYS_DTYPE_F32, device_type, device);
+    ops::rope_table(_rope_table, meta.theta);
+    setKVCacheType(meta.dtype);
+    _reserve(std::min(_prefill_chunk, meta.maxseq), 1);
+}
+
+const LlaisysQwen2Meta &Qwen2::meta() const {
+    return _meta;
+}
+
+Qwen2Weights &Qwen2::weights() {
+    // Q, K and V of a layer missing altogether are allocated stacked, so that the DENSE
+    // format runs them fused without a copy.
+    auto &w = _weights;
+    const size_t q_dim = _meta.nh * _meta.dh;
+    const size_t kv_dim = _meta.nkvh * _meta.dh;
+    auto stack = [&](tensor_t &stacked, tensor_t &q, tensor_t &k, tensor_t &v, std::vector<size_t> shape) {
+        if (q || k || v) {
+            return;
+        }
+        shape[0] = q_dim + 2 * kv_dim;
+        stacked = Tensor::create(shape, _meta.dtype, _device_type, _device);
+        q = stacked->slice(0, 0, q_dim);
+        k = stacked->slice(0, q_dim, q_dim + kv_dim);
+        v = stacked->slice(0, q_dim + kv_dim, q_dim + 2 * kv_dim);
+    };
+    _qkv_w.resize(_meta.nlayer);
+    _qkv_b.resize(_meta.nlayer);
+    for (size_t i = 0; i < _meta.nlayer; i++) {
+        stack(_qkv_w[i], w.attn_q_w[i], w.attn_k_w[i], w.attn_v_w[i], {0, _meta.hs});
+        stack(_qkv_b[i], w.attn_q_b[i], w.attn_k_b[i], w.attn_v_b[i], {0});
+    }
+    for (const auto &slot : _weightSlots()) {
+        if (*slot.tensor == nullptr) {
+            *slot.tensor = Tensor::create(slot.shape, _meta.dtype, _device_type, _device);
+        }
+    }
+    _layers.clear();
+    return _weights;
+}
+
+const KVCache &Qwen2::cache() const {
+    return *_seqs[0]->cache;
+}
+
+std::vector<Qwen2::WeightSlot> Qwen2::_weightSlots() {
+    auto &w = _weights;
+    const auto &m = _meta;
+    const size_t q_dim = m.nh * m.dh;
+    const size_t kv_dim = m.nkvh * m.dh;
+    std::vector<WeightSlot> slots{
+        {"model.embed_tokens.weight", &w.in_embed, {m.voc, m.hs}},
+        {"lm_head.weight", &w.out_embed, {m.voc, m.hs}},
+        {"model.norm.weight", &w.out_norm_w, {m.hs}},
+    };
+    const std::tuple<const char *, std::vector<tensor_t> Qwen2Weights::*, std::vector<size_t>> fields[] = {
+        {"input_layernorm.weight", &Qwen2Weights::attn_norm_w, {m.hs}},
+        {"self_attn.q_proj.weight", &Qwen2Weights::attn_q_w, {q_dim, m.hs}},
+        {"self_attn.q_proj.bias", &Qwen2Weights::attn_q_b, {q_dim}},
+        {"self_attn.k_proj.weight", &Qwen2Weights::attn_k_w, {kv_dim, m.hs}},
+        {"self_attn.k_proj.bias", &Qwen2Weights::attn_k_b, {kv_dim}},
+        {"self_attn.v_proj.weight", &Qwen2Weights::attn_v_w, {kv_dim, m.hs}},
+        {"self_attn.v_proj.bias", &Qwen2Weights::attn_v_b, {kv_dim}},
+        {"self_attn.o_proj.weight", &Qwen2Weights::attn_o_w, {m.hs, q_dim}},
+        {"post_attention_layernorm.weight", &Qwen2Weights::mlp_norm_w, {m.hs}},
+        {"mlp.gate_proj.weight", &Qwen2Weights::mlp_gate_w, {m.di, m.hs}},
+        {"mlp.up_proj.weight", &Qwen2Weights::mlp_up_w, {m.di, m.hs}},
+        {"mlp.down_proj.weight", &Qwen2Weights::mlp_down_w, {m.hs, m.di}},
+    };
+    for (size_t i = 0; i < m.nlayer; i++) {
+        for (const auto &[field, member, shape] : fields) {
+            slots.push_back({"model.layers." + std::to_string(i) + "." + field, &(w.*member)[i], shape});
+        }
+    }
+    return slots;
+}
+
+void Qwen2::load(const std::string &path) {
+    namespace fs = std::filesystem;
+    std::vector<fs::path> files;
+    if (fs::is_directory(path)) {
+        for (const auto &entry : fs::directory_iterator(path)) {
+            if (entry.path().extension() == ".safetensors") {
+                files.push_back(entry.path());
+            }
+        }
+        std::sort(files.begin(), files.end());
+    } else {
+        files.emplace_back(path);
+    }
+    CHECK_ARGUMENT(!files.empty(), "Qwen2: no .safetensors file in " + path);
+
+    const auto slots = _weightSlots();
+    std::unordered_map<std::string, const WeightSlot *> by_name;
+    for (const auto &slot : slots) {
+        by_name[slot.name] = &slot;
+    }
+    bool lm_head = false;
+    for (const auto &file : files) {
+        const SafeTensors checkpoint(file.string());
+        for (const auto &entry : checkpoint.entries()) {
+            const auto found = by_name.find(entry.name);
+            if (found == by_name.end()) {
+                continue;
+            }
+            tensor_t *weight = found->second->tensor;
+            auto stored = checkpoint.get(entry);
+            CHECK_ARGUMENT(stored->shape() == found->second->shape,
+                           "Qwen2: shape of " + entry.name + " does not match the model");
+            lm_head |= entry.name == "lm_head.weight";
+            const bool aligned = reinterpret_cast<uintptr_t>(stored->data()) % stored->elementSize() == 0;
+            if (stored->dtype() == _meta.dtype && _device_type == LLAISYS_DEVICE_CPU && aligned) {
+                *weight = stored;
+                continue;
+            }
+            // A fresh tensor, as the current one may be shared, e.g. by tied embeddings.
+            *weight = Tensor::create(stored->shape(), _meta.dtype, _device_type, _device);
+            if (stored->dtype() == _meta.dtype) {
+                (*weight)->load(stored->data());
+            } else if (_device_type == LLAISYS_DEVICE_CPU) {
+                ops::cast(*weight, stored);
+            } else {
+                auto converted = Tensor::create(stored->shape(), _meta.dtype);
+                ops::cast(converted, stored);
+                (*weight)->load(converted->data());
+            }
+        }
+    }
+    if (!lm_head) {
+        _weights.out_embed = _weights.in_embed;
+    }
+    _prepare();
+}
+
+void Qwen2::_prepare() {
+    for (const auto &slot : _weightSlots()) {
+        CHECK_ARGUMENT(*slot.tensor != nullptr, "Qwen2: no weight " + slot.name);
+    }
+    const auto &w = _weights;
+    _qkv_w.resize(_meta.nlayer);
+    _qkv_b.resize(_meta.nlayer);
+    _layers.resize(_meta.nlayer);
+    for (size_t i = 0; i < _meta.nlayer; i++) {
+        auto &layer = _layers[i];
+        // Stacked tensors whose slices were replaced, e.g. by load, are dropped.
+        _qkv_w[i] = _stacked(_qkv_w[i], {w.attn_q_w[i], w.attn_k_w[i], w.attn_v_w[i]});
+        _qkv_b[i] = _stacked(_qkv_b[i], {w.attn_q_b[i], w.attn_k_b[i], w.attn_v_b[i]});
+        layer.o = _linear(w.attn_o_w[i]);
+        layer.down = _linear(w.mlp_down_w[i]);
+        if (_format == LLAISYS_QWEN2_WEIGHTS_DENSE) {
+            const bool stacked = _qkv_w[i] && _qkv_b[i];
+            layer.qkv = {stacked ? _qkv_w[i] : nullptr};
+            layer.qkv_b = stacked ? _qkv_b[i] : nullptr;
+            layer.gate_up = {};
+            continue;
+        }
+        layer.qkv = _linear(ops::linear_concat({w.attn_q_w[i], w.attn_k_w[i], w.attn_v_w[i]}));
+        layer.qkv_b = ops::linear_concat({w.attn_q_b[i], w.attn_k_b[i], w.attn_v_b[i]});
+        layer.gate_up = _linear(ops::linear_swiglu_interleave(w.mlp_gate_w[i], w.mlp_up_w[i]));
+    }
+    _lm_head = _linear(w.out_embed);
+}
+
+tensor_t Qwen2::_stacked(const tensor_t &stacked, const std::vector<tensor_t> &parts) {
+    if (!stacked) {
+        return nullptr;
+    }
+    const std::byte *next = stacked->data();
+    for (const auto &part : parts) {
+        if (part->data() != next || !part->isContiguous()) {
+            return nullptr;
+        }
+        next += part->numel() * part->elementSize();
+    }
+    return next == stacked->data() + stacked->numel() * stacked->elementSize() ? stacked : nullptr;
+}
+
+Qwen2::Linear Qwen2::_linear(tensor_t weight) const {
+    const size_t out_features = weight->shape()[0];
+    const size_t in_features = weight->shape()[1];
+    switch (_format) {
+    case LLAISYS_QWEN2_WEIGHTS_PACKED:
+        if (_device_type == LLAISYS_DEVICE_CPU) {
+            return {ops::linear_pack_weight(weight)};
+        }
+        return {weight};
+    case LLAISYS_QWEN2_WEIGHTS_INT8: {
+        auto qweight = Tensor::create({out_features, in_features}, LLAISYS_DTYPE_I8, _device_type, _device);
+        auto scales = Tensor::create({out_features, 1}, _meta.dtype, _device_type, _device);
+        ops::linear_quantize(qweight, scales, weight);
+        return {qweight, scales};
+    }
+    case LLAISYS_QWEN2_WEIGHTS_INT4: {
+        CHECK_ARGUMENT(in_features % 32 == 0, "Qwen2: int4 weights need input features in multiples of 32");
+        const size_t group_size = in_features % 128 == 0 ? 128 : in_features % 64 == 0 ? 64 : 32;
+        const size_t groups = in_features / group_size;
+        auto qweight = Tensor::create({out_features, in_features / 2}, LLAISYS_DTYPE_U8, _device_type, _device);
+        auto scales = Tensor::create({out_features, groups}, _meta.dtype, _device_type, _device);
+        auto zeros = Tensor::create({out_features, groups}, LLAISYS_DTYPE_U8, _device_type, _device);
+        ops::linear_quantize(qweight, scales, weight, zeros);
+        return {qweight, scales, zeros};
+    }
+    default:
+        return {weight};
+    }
+}
+
+tensor_t Qwen2::forward(const int64_t *token_ids, size_t ntoken) {
+    auto &seq = *_seqs[0];
+    auto &cache = *seq.cache;
+    CHECK_ARGUMENT(ntoken > 0, "Qwen2: no input tokens");
+    CHECK_ARGUMENT(cache.streaming() || ntoken <= cache.capacity(), "Qwen2: sequence longer than maxseq");
+
+    // Reuse the longest cached prefix, keeping at least one token to compute logits from:
+    // the positions of this sequence that match token_ids, then the blocks of the pool
+    // that continue them.
+    const auto &tokens = cache.tokens();
+    const size_t sinks = cache.sinkLength();
+    const size_t evicted = cache.evicted();
+    size_t past = 0;
+    if (evicted == 0) {
+        past = std::mismatch(tokens.begin(), tokens.end(), token_ids, token_ids + ntoken).first - tokens.begin();
+        past = std::min(past, ntoken - 1);
+        cache.truncate(past);
+    } else {
+        // Slot s past the sinks holds position s + evicted: token_ids must start with the
+        // sinks and reach the kept positions, or the whole sequence is computed again.
+        if (ntoken > sinks + evicted && std::equal(tokens.begin(), tokens.begin() + sinks, token_ids)) {
+            const auto kept = std::mismatch(tokens.begin() + sinks, tokens.end(), token_ids + sinks + evicted,
+                                            token_ids + ntoken).first - (tokens.begin() + sinks);
+            past = std::min(sinks + evicted + kept, ntoken - 1);
+        }
+        if (past < sinks + evicted) {
+            cache.reset();
+            past = 0;
+        } else {
+            cache.truncate(past - evicted);
+        }
+    }
+    _stats.query_tokens += ntoken - past;
+    // Blocks of the pool only continue a sequence whose sinks were computed here.
+    if (cache.length() >= sinks) {
+        const size_t hit = cache.match(token_ids, ntoken - 1);
+        _stats.hit_tokens += hit;
+        past += hit;
+    }
+
+    // The remaining positions go in passes of at most a prefill chunk, and of what a
+    // streaming cache can take at once.
+    tensor_t logits;
+    while (past < ntoken) {
+        const size_t n = std::min({ntoken - past, cache.maxReserve(), _prefill_chunk});
+        const Chunk chunk{&seq, token_ids + past, n, past + n == ntoken};
+        logits = _forward(&chunk, 1);
+        past += n;
+    }
+    return logits;
+}
+
+void Qwen2::_reserve(size_t ntoken, size_t nseq) {
+    auto &ws = _ws;
+    const size_t stride = (_seqs[0]->cache->capacity() + KV_BLOCK_SIZE - 1) / KV_BLOCK_SIZE;
+    const bool up = _format == LLAISYS_QWEN2_WEIGHTS_DENSE;
+    if (ntoken <= ws.ntoken && nseq <= ws.nseq && stride == ws.table_stride && up == (ws.up != nullptr)) {
+        return;
+    }
+    const auto &m = _meta;
+    auto create = [&](tensor_t &buffer, const std::vector<size_t> &shape, llaisysDataType_t dtype) {
+        buffer.reset();
+        buffer = Tensor::create(shape, dtype, _device_type, _device);
+    };
+    ws.ntoken = ntoken = std::max(ntoken, ws.ntoken);
+    ws.nseq = nseq = std::max(nseq, ws.nseq);
+    ws.table_stride = stride;
+    ws.view = {};
+    ws.n = ws.s = ws.m = 0;
+    create(ws.index, {ntoken}, LLAISYS_DTYPE_I64);
+    create(ws.pos_ids, {ntoken}, LLAISYS_DTYPE_I64);
+    create(ws.cache_rows, {ntoken}, LLAISYS_DTYPE_I64);
+    create(ws.x, {ntoken, m.hs}, m.dtype);
+    create(ws.h, {ntoken, m.hs}, m.dtype);
+    create(ws.q, {ntoken, m.nh, m.dh}, m.dtype);
+    create(ws.k, {ntoken, m.nkvh, m.dh}, m.dtype);
+    create(ws.v, {ntoken, m.nkvh, m.dh}, m.dtype);
+    create(ws.attn, {ntoken, m.nh, m.dh}, m.dtype);
+    create(ws.gate, {ntoken, m.di}, m.dtype);
+    ws.up.reset();
+    if (up) {
+        create(ws.up, {ntoken, m.di}, m.dtype);
+    }
+    create(ws.block_tables, {nseq, stride}, LLAISYS_DTYPE_I64);
+    create(ws.q_offsets, {nseq + 1}, LLAISYS_DTYPE_I64);
+    create(ws.kv_lens, {nseq}, LLAISYS_DTYPE_I64);
+    create(ws.logit_index, {nseq}, LLAISYS_DTYPE_I64);
+    create(ws.last, {nseq, m.hs}, m.dtype);
+    create(ws.logits, {nseq, m.voc}, m.dtype);
+    create(ws.max_idx, {1}, LLAISYS_DTYPE_I64);
+    create(ws.max_val, {1}, m.dtype);
+    ws.tokens.reserve(ntoken);
+    ws.positions.reserve(ntoken);
+    ws.rows.reserve(ntoken);
+    ws.tables.reserve(nseq * stride);
+    ws.offsets.reserve(nseq + 1);
+    ws.lengths.reserve(nseq);
+    ws.kept.reserve(nseq);
+    ws.slots.reserve(nseq);
+}
+
+void Qwen2::_shape(size_t n, size_t s, size_t m) {
+    auto &ws = _ws;
+    if (n == ws.n && s == ws.s && m == ws.m) {
+        return;
+    }
+    const auto &meta = _meta;
+    auto &v = ws.view;
+    v.index = ws.index->slice(0, 0, n);
+    v.pos_ids = ws.pos_ids->slice(0, 0, n);
+    v.cache_rows = ws.cache_rows->slice(0, 0, n);
+    v.x = ws.x->slice(0, 0, n);
+    v.h = ws.h->slice(0, 0, n);
+    v.q = ws.q->slice(0, 0, n);
+    v.k = ws.k->slice(0, 0, n);
+    v.v = ws.v->slice(0, 0, n);
+    v.attn = ws.attn->slice(0, 0, n);
+    v.gate = ws.gate->slice(0, 0, n);
+    v.up = ws.up ? ws.up->slice(0, 0, n) : nullptr;
+    v.q_2d = v.q->view({n, meta.nh * meta.dh});
+    v.k_2d = v.k->view({n, meta.nkvh * meta.dh});
+    v.v_2d = v.v->view({n, meta.nkvh * meta.dh});
+    v.attn_2d = v.attn->view({n, meta.nh * meta.dh});
+    v.block_tables = ws.block_tables->slice(0, 0, s);
+    v.q_offsets = ws.q_offsets->slice(0, 0, s + 1);
+    v.kv_lens = ws.kv_lens->slice(0, 0, s);
+    v.logit_index = ws.logit_index->slice(0, 0, m);
+    v.last = ws.last->slice(0, 0, m);
+    v.logits = ws.logits->slice(0, 0, m);
+    v.logit_rows.resize(m);
+    for (size_t j = 0; j < m; j++) {
+        v.logit_rows[j] = ws.logits->slice(0, j, j + 1)->view({meta.voc});
+    }
+    ws.n = n;
+    ws.s = s;
+    ws.m = m;
+}
+
+tensor_t Qwen2::_forward(const Chunk *chunks, size_t nseq) {
+    const auto &m = _meta;
+    const auto &w = _weights;
+    auto &ws = _ws;
+    if (_layers.empty()) {
+        _prepare();
+    }
+
+    // Take the slots of every chunk first; sinks moved by an eviction are rotated again.
+    auto &slots = ws.slots;
+    slots.resize(nseq);
+    size_t total = 0;
+    size_t nlogits = 0;
+    for (size_t s = 0; s < nseq; s++) {
+        auto &cache = *chunks[s].seq->cache;
+        const size_t evicted = cache.evicted();
+        cache.reserve(chunks[s].n);
+        if (cache.evicted() != evicted) {
+            _rotateSinks(*chunks[s].seq);
+        }
+        slots[s] = cache.length();
+        total += chunks[s].n;
+        nlogits += chunks[s].logits;
+    }
+    _reserve(total, nseq);
+    _shape(total, nseq, nlogits);
+    const auto &b = ws.view;
+
+    // Tokens, positions and cache rows of the chunks packed in order, the block table,
+    // query rows and length of each sequence for the attention, and the rows of x whose
+    // logits are kept.
+    const size_t stride = ws.table_stride;
+    ws.tokens.resize(total);
+    ws.positions.resize(total);
+    ws.rows.resize(total);
+    ws.tables.resize(nseq * stride);
+    ws.offsets.resize(nseq + 1);
+    ws.lengths.resize(nseq);
+    ws.kept.clear();
+    ws.offsets[0] = 0;
+    for (size_t s = 0; s < nseq; s++) {
+        const auto &c = chunks[s];
+        const auto &cache = *c.seq->cache;
+        const size_t row = static_cast<size_t>(ws.offsets[s]);
+        std::copy(c.tokens, c.tokens + c.n, ws.tokens.begin() + row);
+        for (size_t i = 0; i < c.n; i++) {
+            ws.positions[row + i] = static_cast<int64_t>(slots[s] + i + cache.evicted());
+            ws.rows[row + i] = cache.row(slots[s] + i);
+        }
+        std::copy(cache.blocks().begin(), cache.blocks().end(), ws.tables.begin() + s * stride);
+        ws.offsets[s + 1] = static_cast<int64_t>(row + c.n);
+        ws.lengths[s] = static_cast<int64_t>(slots[s] + c.n);
+        if (c.logits) {
+            ws.kept.push_back(ws.offsets[s + 1] - 1);
+        }
+    }
+    b.index->load(ws.tokens.data());
+    b.pos_ids->load(ws.positions.data());
+    b.cache_rows->load(ws.rows.data());
+    b.block_tables->load(ws.tables.data());
+    b.q_offsets->load(ws.offsets.data());
+    b.kv_lens->load(ws.lengths.data());
+    b.logit_index->load(ws.kept.data());
+    const float scale = 1.0f / std::sqrt(static_cast<float>(m.dh));
+
+    ops::embedding(b.x, b.index, w.in_embed);
+    for (size_t i = 0; i < m.nlayer; i++) {
+        // Attention block, each sequence over its cached positions.
+        const auto &layer = _layers[i];
+        ops::rms_norm(b.h, b.x, w.attn_norm_w[i], m.epsilon);
+        if (layer.qkv.weight) {
+            ops::linear_qkv(b.q, b.k, b.v, b.h, layer.qkv.weight, layer.qkv_b, layer.qkv.scales, layer.qkv.zeros);
+        } else {
+            ops::linear(b.q_2d, b.h, w.attn_q_w[i], w.attn_q_b[i]);
+            ops::linear(b.k_2d, b.h, w.attn_k_w[i], w.attn_k_b[i]);
+            ops::linear(b.v_2d, b.h, w.attn_v_w[i], w.attn_v_b[i]);
+        }
+        for (size_t s = 0; s < nseq; s++) {
+            const size_t row = static_cast<size_t>(ws.offsets[s]);
+            const size_t sinks = std::min(chunks[s].seq->cache->sinkLength(), slots[s] + chunks[s].n);
+            if (slots[s] < sinks) {
+                ops::cast(chunks[s].seq->sink_keys[i]->slice(0, slots[s], sinks),
+                          b.k->slice(0, row, row + sinks - slots[s]));
+            }
+        }
+        // Rotate the queries in place and the keys straight into their cache rows.
+        ops::rope_paged(b.q, _pool->keys(i), _pool->values(i), b.q, b.k, b.v, b.pos_ids, b.cache_rows, _rope_table,
+                        m.theta, _pool->keyScales(i), _pool->valueScales(i));
+        ops::self_attention_batched(b.attn, b.q, _pool->keys(i), _pool->values(i), b.block_tables, b.q_offsets,
+                                    b.kv_lens, scale, _pool->keyScales(i), _pool->valueScales(i));
+        ops::linear_fused(b.x, b.attn_2d, layer.o.weight, nullptr, b.x, LLAISYS_ACTIVATION_NONE, layer.o.scales,
+                          layer.o.zeros);
+
+        // MLP block.
+        ops::rms_norm(b.h, b.x, w.mlp_norm_w[i], m.epsilon);
+        if (layer.gate_up.weight) {
+            ops::linear_swiglu(b.gate, b.h, layer.gate_up.weight, nullptr, layer.gate_up.scales, layer.gate_up.zeros);
+        } else {
+            ops::linear(b.gate, b.h, w.mlp_gate_w[i], nullptr);
+            ops::linear(b.up, b.h, w.mlp_up_w[i], nullptr);
+            ops::swiglu(b.gate, b.gate, b.up);
+        }
+        ops::linear_fused(b.x, b.gate, layer.down.weight, nullptr, b.x, LLAISYS_ACTIVATION_NONE, layer.down.scales,
+                          layer.down.zeros);
+    }
+    for (size_t s = 0; s < nseq; s++) {
+        chunks[s].seq->cache->advance(chunks[s].n, chunks[s].tokens);
+    }
+    if (nlogits == 0) {
+        return nullptr;
+    }
+
+    // Only the last position of each chunk asking for logits is needed: gather those
+    // rows, then normalize them in place.
+    ops::embedding(b.last, b.logit_index, b.x);
+    ops::rms_norm(b.last, b.last, w.out_norm_w, m.epsilon);
+    ops::linear(b.logits, b.last, _lm_head.weight, nullptr, _lm_head.scales, _lm_head.zeros);
+    return b.logits;
+}
+
+void Qwen2::_rotateSinks(Sequence &seq) {
+    // Keys of the sinks as if they sat just before the oldest kept position, rotated
+    // from their unrotated copies so that no rounding accumulates.
+    const auto &cache = *seq.cache;
+    const size_t sinks = cache.sinkLength();
+    if (sinks == 0) {
+        return;
+    }
+    for (size_t i = 0; i < sinks; i++) {
+        seq.sink_positions[i] = static_cast<int64_t>(cache.evicted() + i);
+    }
+    seq.sink_pos_ids->load(seq.sink_positions.data());
+    for (size_t i = 0; i < _meta.nlayer; i++) {
+        ops::rope(seq.sink_rotated, seq.sink_keys[i], seq.sink_pos_ids, _meta.theta);
+        seq.cache->writeKeys(i, 0, seq.sink_rotated);
+    }
+}
+
+int64_t Qwen2::_argmax(size_t row) {
+    const auto &max_idx = _ws.max_idx;
+    ops::argmax(max_idx, _ws.max_val, _ws.view.logit_rows.at(row));
+
+    int64_t token = 0;
+    if (_device_type == LLAISYS_DEVICE_CPU) {
+        token = *reinterpret_cast<const int64_t *>(max_idx->data());
+    } else {
+        core::context().setDevice(_device_type, _device);
+        core::context().runtime().api()->memcpy_sync(&token, max_idx->data(), sizeof(token), LLAISYS_MEMCPY_D2H);
+    }
+    return token;
+}
+
+int64_t Qwen2::_sample(size_t row, float temperature, size_t top_k, float top_p, uint64_t seed) {
+    const auto &max_idx = _ws.max_idx;
+    ops::sample(max_idx, _ws.view.logit_rows.at(row), temperature, top_k, top_p, seed);
+
+    int64_t token = 0;
+    if (_device_type == LLAISYS_DEVICE_CPU) {
+        token = *reinterpret_cast<const int64_t *>(max_idx->data());
+    } else {
+        core::context().setDevice(_device_type, _device);
+        core::context().runtime().api()->memcpy_sync(&token, max_idx->data(), sizeof(token), LLAISYS_MEMCPY_D2H);
+    }
+    return token;
+}
+
+int64_t Qwen2::infer(const int64_t *token_ids, size_t ntoken) {
+    forward(token_ids, ntoken);
+    return _argmax(0);
+}
+
+tensor_t Qwen2::logits() const {
+    CHECK_ARGUMENT(_ws.view.logits != nullptr, "Qwen2: no pass has run yet");
+    return _ws.view.logits;
+}
+
+size_t Qwen2::generate(const int64_t *token_ids, size_t ntoken, int64_t *new_tokens, size_t max_new_tokens,
+                       float temperature, size_t top_k, float top_p, uint64_t seed, TokenCallback callback,
+                       void *user) {
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+    auto &seq = *_seqs[0];
+    if (!seq.cache->streaming()) {
+        // The last token drawn is never computed.
+        max_new_tokens = std::min(max_new_tokens, seq.cache->capacity() + 1 - std::min(ntoken, seq.cache->capacity()));
+    }
+    if (max_new_tokens == 0) {
+        _cancel.store(false, std::memory_order_relaxed);
+        return 0;
+    }
+    forward(token_ids, ntoken);
+    size_t n = 0;
+    while (true) {
+        const int64_t token = _sample(0, temperature, top_k, top_p, seed + n * 0x9e3779b97f4a7c15ULL);
+        new_tokens[n++] = token;
+        bool stop = token == _meta.end_token || n == max_new_tokens;
+        if (callback) {
+            const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start);
+            stop |= callback(token, static_cast<uint64_t>(elapsed.count()), user) != 0;
+        }
+        // A cancel from before the call stops it here too; it is cleared on return.
+        if (stop || _cancel.load(std::memory_order_relaxed)) {
+            _cancel.store(false, std::memory_order_relaxed);
+            return n;
+        }
+        // The cache holds every position before the token: only it is computed.
+        const Chunk chunk{&seq, &new_tokens[n - 1], 1, true};
+        _forward(&chunk, 1);
+        _stats.query_tokens++;
+    }
+}
+
+void Qwen2::cancel() {
+    _cancel.store(true, std::memory_order_relaxed);
+}
+
+void Qwen2::truncateCache(size_t length) {
+    auto &cache = *_seqs[0]->cache;
+    cache.truncate(std::min(length, cache.length()));
+}
+
+void Qwen2::resetCache() {
+    _seqs[0]->cache->reset();
+}
+
+void Qwen2::setKVCacheType(llaisysDataType_t dtype) {
+    CHECK_ARGUMENT(dtype == _meta.dtype || dtype == LLAISYS_DTYPE_I8 || dtype == LLAISYS_DTYPE_F8
+                       || dtype == LLAISYS_DTYPE_F8_E5M2,
+                   "Qwen2: KV cache dtype must be the model's, I8, F8 or F8_E5M2");
+    _createCache(dtype, _pool ? _pool->nblocks() * KV_BLOCK_SIZE : _meta.maxseq, _sinks, _window);
+}
+
+void Qwen2::setKVCacheCapacity(size_t ntoken) {
+    _createCache(_pool->dtype(), std::max(ntoken, _meta.maxseq), _sinks, _window);
+}
+
+void Qwen2::setWeightFormat(WeightFormat format) {
+    CHECK_ARGUMENT(format == LLAISYS_QWEN2_WEIGHTS_DENSE || format == LLAISYS_QWEN2_WEIGHTS_PACKED
+                       || format == LLAISYS_QWEN2_WEIGHTS_INT8 || format == LLAISYS_QWEN2_WEIGHTS_INT4,
+                   "Qwen2: unknown weight format");
+    _format = format;
+    _layers.clear();
+}
+
+void Qwen2::setStreaming(size_t sinks, size_t window) {
+    // Eviction drops a whole block, and the partial last one is never dropped.
+    CHECK_ARGUMENT(window == 0 || window >= 2 * KV_BLOCK_SIZE, "Qwen2: a streaming window holds at least 32 positions");
+    CHECK_ARGUMENT(sinks <= _meta.maxseq, "Qwen2: more sinks than maxseq");
+    _createCache(_pool->dtype(), _pool->nblocks() * KV_BLOCK_SIZE, sinks, window);
+}
+
+Qwen2::CacheStats Qwen2::cacheStats() const {
+    CacheStats stats = _stats;
+    stats.cached_blocks = _pool->cachedBlocks();
+    stats.free_blocks = _pool->freeBlocks();
+    stats.evicted_blocks = _pool->stats().evictions;
+    return stats;
+}
+
+int64_t Qwen2::createSequence() {
+    auto free = std::find(_seqs.begin() + 1, _seqs.end(), nullptr);
+    if (free == _seqs.end()) {
+        free = _seqs.insert(_seqs.end(), nullptr);
+    }
+    *free = _newSequence(_pool, _sinks, _window);
+    return free - _seqs.begin();
+}
+
+void Qwen2::destroySequence(int64_t id) {
+    _sequence(id);
+    _seqs[id].reset();
+}
+
+void Qwen2::appendTokens(int64_t id, const int64_t *token_ids, size_t ntoken) {
+    auto &seq = _sequence(id);
+    const size_t length = seq.cache->length() + seq.queued.size() - seq.consumed + ntoken;
+    CHECK_ARGUMENT(seq.cache->streaming() || length <= seq.cache->capacity(), "Qwen2: sequence longer than maxseq");
+    if (ntoken == 0) {
+        return;
+    }
+    if (seq.consumed == seq.queued.size()) {
+        seq.queued.clear();
+        seq.consumed = 0;
+        seq.queued_at = _queue_clock++;
+        seq.matched = false;
+    }
+    seq.queued.insert(seq.queued.end(), token_ids, token_ids + ntoken);
+}
+
+void Qwen2::setPrefillChunk(size_t ntoken) {
+    CHECK_ARGUMENT(ntoken > 0, "Qwen2: prefill chunk must be positive");
+    _prefill_chunk = ntoken;
+    _reserve(std::min(ntoken, _meta.maxseq), 1);
+}
+
+size_t Qwen2::prefillChunk() const {
+    return _prefill_chunk;
+}
+
+size_t Qwen2::queuedTokens() const {
+    size_t n = 0;
+    for (const auto &seq : _seqs) {
+        n += seq ? seq->queued.size() - seq->consumed : 0;
+    }
+    return n;
+}
+
+size_t Qwen2::step(int64_t *seq_ids, int64_t *next_tokens, size_t capacity) {
+    // Newly queued prompts first take what the pool has cached of them, keeping one
+    // token to compute logits from.
+    auto &decodes = _ws.decodes;
+    auto &prefills = _ws.prefills;
+    decodes.clear();
+    prefills.clear();
+    for (size_t id = 1; id < _seqs.size(); id++) {
+        auto *seq = _seqs[id].get();
+        if (!seq || seq->consumed == seq->queued.size()) {
+            continue;
+        }
+        auto &cache = *seq->cache;
+        if (!seq->matched) {
+            seq->matched = true;
+            _stats.query_tokens += seq->queued.size();
+            // Only a whole block can be taken, leaving out the last token: not after
+            // the single token of a decode, so its step copies nothing.
+            if (seq->queued.size() > _pool->blockSize() && cache.length() >= cache.sinkLength()
+                && cache.evicted() == 0) {
+                std::vector<int64_t> tokens(cache.tokens());
+                tokens.insert(tokens.end(), seq->queued.begin(), seq->queued.end());
+                const size_t hit = cache.match(tokens.data(), tokens.size() - 1);
+                _stats.hit_tokens += hit;
+                seq->consumed += hit;
+            }
+        }
+        (seq->queued.size() - seq->consumed == 1 ? decodes : prefills).push_back(static_cast<int64_t>(id));
+    }
+    std::stable_sort(prefills.begin(), prefills.end(),
+                     [&](int64_t a, int64_t b) { return _seqs[a]->queued_at < _seqs[b]->queued_at; });
+
+    // Every decode, then prompt chunks oldest first within the budget.
+    auto &ids = _ws.ids;
+    auto &chunks = _ws.chunks;
+    ids.clear();
+    chunks.clear();
+    for (int64_t id : decodes) {
+        auto *seq = _seqs[id].get();
+        ids.push_back(id);
+        chunks.push_back(Chunk{seq, seq->queued.data() + seq->consumed, 1, true});
+    }
+    size_t budget = _prefill_chunk;
+    for (int64_t id : prefills) {
+        auto *seq = _seqs[id].get();
+        const size_t left = seq->queued.size() - seq->consumed;
+        const size_t n = std::min({left, budget, seq->cache->maxReserve()});
+        if (n == 0) {
+            break;
+        }
+        ids.push_back(id);
+        chunks.push_back(Chunk{seq, seq->queued.data() + seq->consumed, n, n == left});
+        budget -= n;
+    }
+    if (chunks.empty()) {
+        return 0;
+    }
+    const size_t nout = std::count_if(chunks.begin(), chunks.end(), [](const Chunk &c) { return c.logits; });
+    CHECK_ARGUMENT(nout <= capacity, "Qwen2: more finished sequences than output entries");
+
+    _forward(chunks.data(), chunks.size());
+    for (size_t s = 0, j = 0; s < chunks.size(); s++) {
+        chunks[s].seq->consumed += chunks[s].n;
+        if (chunks[s].logits) {
+            seq_ids[j] = ids[s];
+            next_tokens[j] = _argmax(j);
+            j++;
+        }
+    }
+    return nout;
+}
+
+std::unique_ptr<Qwen2::Sequence> Qwen2::_newSequence(const std::shared_ptr<KVBlockPool> &pool, size_t sinks,
+                                                      size_t window) const {
+    auto seq = std::make_unique<Sequence>();
+    if (window == 0) {
+        seq->cache = std::make_unique<KVCache>(pool, _meta.maxseq);
+        return seq;
+    }
+    sinks = (sinks + KV_BLOCK_SIZE - 1) / KV_BLOCK_SIZE * KV_BLOCK_SIZE;
+    seq->cache = std::make_unique<KVCache>(pool, sinks + window, true, sinks);
+    if (sinks == 0) {
+        return seq;
+    }
+    for (size_t i = 0; i < _meta.nlayer; i++) {
+        seq->sink_keys.push_back(Tensor::create({sinks, _meta.nkvh, _meta.dh}, _meta.dtype, _device_type, _device));
+    }
+    // Staging for _rotateSinks, which runs on every eviction.
+    seq->sink_positions.resize(sinks);
+    seq->sink_pos_ids = Tensor::create({sinks}, LLAISYS_DTYPE_I64, _device_type, _device);
+    seq->sink_rotated = Tensor::create({sinks, _meta.nkvh, _meta.dh}, _meta.dtype, _device_type, _device);
+    return seq;
+}
+
+Qwen2::Sequence &Qwen2::_sequence(int64_t id) {
+    // Sequence 0 is only reached through forward and infer.
+    CHECK_ARGUMENT(id > 0 && static_cast<size_t>(id) < _seqs.size() && _seqs[id], "Qwen2: no such sequence");
+    return *_seqs[id];
+}
+
+void Qwen2::_createCache(llaisysDataType_t dtype, size_t ntoken, size_t sinks, size_t window) {
+    // The new pool and sequences are built aside and only replace the old ones once
+    // complete, so that a failure leaves the model as it was; every sequence starts over.
+    if (window > 0) {
+        ntoken = std::max(ntoken, (sinks + KV_BLOCK_SIZE - 1) / KV_BLOCK_SIZE * KV_BLOCK_SIZE + window);
+    }
+    auto pool = std::make_shared<KVBlockPool>(_meta.nlayer, (ntoken + KV_BLOCK_SIZE - 1) / KV_BLOCK_SIZE,
+                                              KV_BLOCK_SIZE, _meta.nkvh, _meta.dh, _meta.dh, dtype, _device_type,
+                                              _device);
+    std::vector<std::unique_ptr<Sequence>> seqs(std::max<size_t>(_seqs.size(), 1));
+    for (size_t id = 0; id < seqs.size(); id++) {
+        if (id == 0 || _seqs[id]) {
+            seqs[id] = _newSequence(pool, sinks, window);
+        }
+    }
+    _seqs = std::move(seqs);
+    _pool = std::move(pool);
+    _sinks = sinks;
+    _window = window;
+    _stats = {};
+}
+} // namespace llaisys::models
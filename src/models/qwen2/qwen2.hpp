@@ -0,0 +1,265 @@
+#pragma once
+
+#include "llaisys/models/qwen2.h"
+
+#include "../../tensor/tensor.hpp"
+#include "../kv_cache.hpp"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llaisys::models {
+// Parameters of a Qwen2 decoder, one entry per layer in the vectors.
+struct Qwen2Weights {
+    tensor_t in_embed;
+    tensor_t out_embed;
+    tensor_t out_norm_w;
+    std::vector<tensor_t> attn_norm_w;
+    std::vector<tensor_t> attn_q_w;
+    std::vector<tensor_t> attn_q_b;
+    std::vector<tensor_t> attn_k_w;
+    std::vector<tensor_t> attn_k_b;
+    std::vector<tensor_t> attn_v_w;
+    std::vector<tensor_t> attn_v_b;
+    std::vector<tensor_t> attn_o_w;
+    std::vector<tensor_t> mlp_norm_w;
+    std::vector<tensor_t> mlp_gate_w;
+    std::vector<tensor_t> mlp_up_w;
+    std::vector<tensor_t> mlp_down_w;
+};
+
+// Qwen2 decoder with a paged KV cache of meta.maxseq positions. The weights are read
+// from a checkpoint by load, or allocated in meta.dtype on the model's device by
+// weights() and filled by the caller.
+//
+// Full blocks of the cache stay in its pool, keyed by their tokens and every token
+// before them, after the sequence moves on; a later sequence with the same prefix,
+// e.g. a shared system prompt, takes them over instead of recomputing them. A pool
+// larger than maxseq (setKVCacheCapacity) keeps more of them.
+//
+// In streaming mode (setStreaming) the cache holds a few sink positions and a window of
+// the latest ones instead, see KVCache, so a sequence can grow without bound at a
+// constant cost per token. Queries and kept keys are rotated at their positions in the
+// sequence and the sinks just before the window, from unrotated copies of their keys.
+//
+// Besides the sequence of forward and infer (id 0), the model serves sequences created
+// with createSequence, whose caches share the pool. Each step computes their queued
+// tokens in a single pass: the next token of every decoding sequence, and at most
+// prefillChunk() prompt tokens taken from the others in the order they were queued, so
+// that a long prompt is spread over several steps instead of stalling the decodes.
+class Qwen2 {
+public:
+    using CacheStats = LlaisysQwen2CacheStats;
+    using TokenCallback = LlaisysQwen2TokenCallback;
+    using WeightFormat = llaisysQwen2WeightFormat_t;
+
+private:
+    // A sequence in the pool: its cache, the unrotated keys of its sinks when streaming
+    // with the positions and keys their rotation is staged in, and the tokens queued for
+    // the next steps, from `consumed` on.
+    struct Sequence {
+        std::unique_ptr<KVCache> cache;
+        std::vector<tensor_t> sink_keys;
+        std::vector<int64_t> sink_positions;
+        tensor_t sink_pos_ids, sink_rotated;
+        std::vector<int64_t> queued;
+        size_t consumed = 0;
+        // Order of the first queued token, and whether the pool was searched for them.
+        uint64_t queued_at = 0;
+        bool matched = false;
+    };
+    // n tokens of a sequence computed by one pass, and whether their last logits are kept.
+    struct Chunk {
+        Sequence *seq;
+        const int64_t *tokens;
+        size_t n;
+        bool logits;
+    };
+    // Buffers of a pass, allocated for `ntoken` tokens of `nseq` sequences and grown
+    // only when a pass takes more, and views of them shaped for the last pass. Every
+    // layer runs in place in them, so a pass shaped like the previous one, e.g. the
+    // next decode step, allocates nothing.
+    struct Workspace {
+        size_t ntoken = 0;
+        size_t nseq = 0;
+        // Entries per row of the block tables, the most blocks a cache holds.
+        size_t table_stride = 0;
+        // up only serves the separate gate and up projections of the DENSE format.
+        tensor_t index, pos_ids, cache_rows, x, h, q, k, v, attn, gate, up;
+        tensor_t block_tables, q_offsets, kv_lens, logit_index, last, logits, max_idx, max_val;
+        // Tokens, sequences and rows of logits of the views.
+        size_t n = 0, s = 0, m = 0;
+        struct {
+            tensor_t index, pos_ids, cache_rows, x, h, q, k, v, attn, gate, up, q_2d, k_2d, v_2d, attn_2d;
+            tensor_t block_tables, q_offsets, kv_lens, logit_index, last, logits;
+            std::vector<tensor_t> logit_rows;
+        } view;
+        // Layout of the pass on the host, loaded into the buffers above.
+        std::vector<size_t> slots;
+        std::vector<int64_t> tokens, positions, rows, tables, offsets, lengths, kept;
+        // Sequences of a step.
+        std::vector<int64_t> decodes, prefills, ids;
+        std::vector<Chunk> chunks;
+    };
+
+    // A projection as the passes run it: a loaded weight, a packed copy, or a quantized
+    // one with its scales and zero points (null if unused), see ops::linear_quantize.
+    struct Linear {
+        tensor_t weight, scales, zeros;
+    };
+    // Projections of a layer: Q, K and V stacked for ops::linear_qkv, and gate and up
+    // interleaved for ops::linear_swiglu. The DENSE format copies nothing, so it leaves
+    // gate_up null and runs gate and up apart, and stacks Q, K and V only if they already
+    // are, as allocated by weights(); otherwise qkv is null too.
+    struct Layer {
+        Linear qkv, o, gate_up, down;
+        tensor_t qkv_b;
+    };
+
+    LlaisysQwen2Meta _meta;
+    llaisysDeviceType_t _device_type;
+    int _device;
+    Qwen2Weights _weights;
+    // Q, K and V weights and biases of each layer allocated by weights() as one tensor,
+    // of which those of _weights are row slices, or null.
+    std::vector<tensor_t> _qkv_w, _qkv_b;
+    // Built from _weights in _format before the first pass after either changes.
+    std::vector<Layer> _layers;
+    Linear _lm_head;
+    WeightFormat _format = LLAISYS_QWEN2_WEIGHTS_DENSE;
+    // Rotations of positions [0, maxseq), see ops::rope_table.
+    tensor_t _rope_table;
+    std::shared_ptr<KVBlockPool> _pool;
+    // Sequences by id, null for free ids; id 0 is the sequence of forward and infer.
+    std::vector<std::unique_ptr<Sequence>> _seqs;
+    uint64_t _queue_clock = 0;
+    size_t _prefill_chunk = 512;
+    CacheStats _stats{};
+    Workspace _ws;
+    // Streaming window (0 if off) and sinks.
+    size_t _window = 0;
+    size_t _sinks = 0;
+    // Set by cancel, read once per token by generate and cleared when it returns.
+    std::atomic<bool> _cancel{false};
+
+    // Checkpoint name, tensor and shape of every weight.
+    struct WeightSlot {
+        std::string name;
+        tensor_t *tensor;
+        std::vector<size_t> shape;
+    };
+    std::vector<WeightSlot> _weightSlots();
+    // Build the projections of the passes from the weights.
+    void _prepare();
+    Linear _linear(tensor_t weight) const;
+    // `stacked` if `parts` still are its consecutive row slices, or null.
+    static tensor_t _stacked(const tensor_t &stacked, const std::vector<tensor_t> &parts);
+    // Replace the pool and every sequence with empty ones, in streaming mode if window > 0.
+    void _createCache(llaisysDataType_t dtype, size_t ntoken, size_t sinks, size_t window);
+    std::unique_ptr<Sequence> _newSequence(const std::shared_ptr<KVBlockPool> &pool, size_t sinks,
+                                           size_t window) const;
+    Sequence &_sequence(int64_t id);
+    // Grow the workspace to passes of ntoken tokens over nseq sequences, and shape its
+    // views for n tokens, s sequences and m rows of logits.
+    void _reserve(size_t ntoken, size_t nseq);
+    void _shape(size_t n, size_t s, size_t m);
+    // Compute the tokens of the nseq chunks into the caches of their sequences, in one
+    // pass, and return the logits [m, voc] of the m chunks that ask for them, in order.
+    tensor_t _forward(const Chunk *chunks, size_t nseq);
+    void _rotateSinks(Sequence &seq);
+    // The most likely token of row `row` of the logits of the last pass.
+    int64_t _argmax(size_t row);
+    // A token drawn from row `row` of the logits of the last pass, see ops::sample.
+    int64_t _sample(size_t row, float temperature, size_t top_k, float top_p, uint64_t seed);
+
+public:
+    Qwen2(const LlaisysQwen2Meta &meta, llaisysDeviceType_t device_type = LLAISYS_DEVICE_CPU, int device = 0);
+
+    const LlaisysQwen2Meta &meta() const;
+    // The weights, for the caller to fill; those not loaded yet are allocated first, Q,
+    // K and V of a layer as row slices of one tensor that the passes use as is. The
+    // projections are rebuilt from them at the next pass, so weights changed in place
+    // must be reached through this call.
+    Qwen2Weights &weights();
+    const KVCache &cache() const;
+    // Load the weights from the .safetensors files of directory `path`, or from the file
+    // `path`. Weights stored in meta.dtype share the mapped file on a CPU model, so
+    // nothing is copied in the DENSE format and pages are read as the first pass touches
+    // them; others are copied, converted to meta.dtype. Without lm_head.weight, the output embedding is
+    // tied to the input one. Replaces the tensors of weights(); a weight that neither the
+    // checkpoint nor an earlier weights() call provides is an error.
+    void load(const std::string &path);
+
+    // Logits [1, voc] of the token following token_ids[0, ntoken). The cached positions
+    // that match a prefix of token_ids are reused, so a caller passing the whole
+    // sequence at every step only computes the tokens appended since the last call;
+    // so are the cached blocks of earlier sequences that continue that prefix. Without
+    // streaming, ntoken is at most maxseq; with it, only the sinks and the kept window
+    // are compared, the positions dropped in between are taken to be unchanged. The
+    // logits live in the model's workspace, until the next pass.
+    tensor_t forward(const int64_t *token_ids, size_t ntoken);
+    // The most likely next token.
+    int64_t infer(const int64_t *token_ids, size_t ntoken);
+    // Logits [m, voc] of the last pass: the row of forward and infer, the one generate
+    // drew its last token from, or those of the m sequences reported by step, in order.
+    // They live in the model's workspace, until the next pass.
+    tensor_t logits() const;
+    // Continue token_ids[0, ntoken) with up to max_new_tokens tokens, written to
+    // new_tokens, and return how many: the prompt is computed as by forward, then each
+    // token is drawn (see ops::sample) and fed back in a one-token pass, until
+    // meta.end_token is drawn. Draw i is seeded with the i-th value of a splitmix64
+    // sequence from `seed`. Without streaming, the sequence stops at the cache capacity.
+    // Each token is passed to `callback`, if any, as soon as it is drawn; a nonzero
+    // return, or cancel, stops the loop after it.
+    size_t generate(const int64_t *token_ids, size_t ntoken, int64_t *new_tokens, size_t max_new_tokens,
+                    float temperature, size_t top_k, float top_p, uint64_t seed, TokenCallback callback = nullptr,
+                    void *user = nullptr);
+    // Stop the generate call in progress after its current token, from any thread. A
+    // cancel with no call in progress stops the next one after its first token.
+    void cancel();
+
+    // Store the projections in `format` from the next pass on. DENSE uses the weights as
+    // loaded. The other formats build a copy of each projection, Q, K and V stacked and
+    // gate and up interleaved, kept next to the weights: packing only applies to a CPU
+    // model, elsewhere the copies are just stacked; quantized weights are computed from
+    // the loaded ones, with scales in meta.dtype.
+    void setWeightFormat(WeightFormat format);
+
+    // Keep only the first `length` cached positions.
+    void truncateCache(size_t length);
+    void resetCache();
+    // Store the KV cache in `dtype`: meta.dtype (the default), or I8, F8 or F8_E5M2
+    // quantized per head of each position. Empties the cache.
+    void setKVCacheType(llaisysDataType_t dtype);
+    // Size the block pool for `ntoken` positions (at least maxseq), the excess holding
+    // cached prefixes. Empties the cache.
+    void setKVCacheCapacity(size_t ntoken);
+    // Keep only the first `sinks` positions (at most maxseq, rounded up to a KV block)
+    // and a window of the latest ones in the cache, or the whole sequence if window is 0.
+    // A window holds at least two blocks; it is emptied a block at a time, so after a
+    // pass it keeps between window - 15 and window positions. Empties the cache, unless
+    // the arguments are invalid, which changes nothing.
+    void setStreaming(size_t sinks, size_t window);
+    CacheStats cacheStats() const;
+
+    // A new empty sequence, and its id.
+    int64_t createSequence();
+    // Drop a sequence, returning its blocks to the pool; full ones stay cached.
+    void destroySequence(int64_t id);
+    // Queue tokens to append to a sequence: a prompt, or the token sampled after the
+    // last step. Without streaming, a sequence holds at most maxseq positions.
+    void appendTokens(int64_t id, const int64_t *token_ids, size_t ntoken);
+    // Prompt tokens computed per step, over all sequences; decode tokens always are.
+    // forward computes its input in passes of at most as many tokens.
+    void setPrefillChunk(size_t ntoken);
+    size_t prefillChunk() const;
+    // Tokens queued and not yet computed, over all sequences.
+    size_t queuedTokens() const;
+    // Run one step and return the number of sequences whose queued tokens are all
+    // computed, writing the id and most likely next token of each to seq_ids and
+    // next_tokens, which hold at most `capacity` entries.
+    size_t step(int64_t *seq_ids, int64_t *next_tokens, size_t capacity);
+};
+} // namespace llaisys::models
@@ -0,0 +1,314 @@
+#include "safetensors.hpp"
+
+#include "../utils.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define LLAISYS_HAS_MMAP
+#endif
+
+namespace {
+// Just enough of a JSON reader for a safetensors header: objects, arrays, strings and
+// non-negative integers, other values skipped.
+class Json {
+    const char *_p;
+    const char *_end;
+
+    void _fail() const {
+        CHECK_ARGUMENT(false, "SafeTensors: malformed header");
+    }
+
+public:
+    Json(const char *begin, const char *end) : _p(begin), _end(end) {}
+
+    char peek() {
+        while (_p < _end && (*_p == ' ' || *_p == '\t' || *_p == '\n' || *_p == '\r')) {
+            _p++;
+        }
+        return _p < _end ? *_p : '\0';
+    }
+
+    void expect(char c) {
+        if (peek() != c) {
+            _fail();
+        }
+        _p++;
+    }
+
+    // Consume `c` if it comes next.
+    bool accept(char c) {
+        if (peek() != c) {
+            return false;
+        }
+        _p++;
+        return true;
+    }
+
+    std::string string() {
+        expect('"');
+        std::string s;
+        while (_p < _end && *_p != '"') {
+            char c = *_p++;
+            if (c == '\\') {
+                if (_p >= _end) {
+                    _fail();
+                }
+                c = *_p++;
+                switch (c) {
+                case 'b':
+                    c = '\b';
+                    break;
+                case 'f':
+                    c = '\f';
+                    break;
+                case 'n':
+                    c = '\n';
+                    break;
+                case 'r':
+                    c = '\r';
+                    break;
+                case 't':
+                    c = '\t';
+                    break;
+                case 'u': {
+                    // A UTF-16 code unit, written as UTF-8; names are ASCII in practice.
+                    if (_end - _p < 4) {
+                        _fail();
+                    }
+                    unsigned u = 0;
+                    for (int i = 0; i < 4; i++) {
+                        const char h = *_p++;
+                        if (h >= '0' && h <= '9') {
+                            u = u * 16 + static_cast<unsigned>(h - '0');
+                        } else if (h >= 'a' && h <= 'f') {
+                            u = u * 16 + static_cast<unsigned>(h - 'a' + 10);
+                        } else if (h >= 'A' && h <= 'F') {
+                            u = u * 16 + static_cast<unsigned>(h - 'A' + 10);
+                        } else {
+                            _fail();
+                        }
+                    }
+                    if (u < 0x80) {
+                        s += static_cast<char>(u);
+                    } else if (u < 0x800) {
+                        s += static_cast<char>(0xc0 | (u >> 6));
+                        s += static_cast<char>(0x80 | (u & 0x3f));
+                    } else {
+                        s += static_cast<char>(0xe0 | (u >> 12));
+                        s += static_cast<char>(0x80 | ((u >> 6) & 0x3f));
+                        s += static_cast<char>(0x80 | (u & 0x3f));
+                    }
+                    continue;
+                }
+                default: // '"', '\\' and '/' stand for themselves.
+                    break;
+                }
+            }
+            s += c;
+        }
+        expect('"');
+        return s;
+    }
+
+    size_t integer() {
+        if (peek() < '0' || peek() > '9') {
+            _fail();
+        }
+        size_t n = 0;
+        while (_p < _end && *_p >= '0' && *_p <= '9') {
+            const size_t d = static_cast<size_t>(*_p++ - '0');
+            if (n > (SIZE_MAX - d) / 10) {
+                _fail();
+            }
+            n = n * 10 + d;
+        }
+        return n;
+    }
+
+    std::vector<size_t> integers() {
+        std::vector<size_t> v;
+        expect('[');
+        if (!accept(']')) {
+            do {
+                v.push_back(integer());
+            } while (accept(','));
+            expect(']');
+        }
+        return v;
+    }
+
+    void skip() {
+        const char c = peek();
+        if (c == '"') {
+            string();
+        } else if (c == '{' || c == '[') {
+            const char close = c == '{' ? '}' : ']';
+            _p++;
+            if (!accept(close)) {
+                do {
+                    if (c == '{') {
+                        string();
+                        expect(':');
+                    }
+                    skip();
+                } while (accept(','));
+                expect(close);
+            }
+        } else {
+            // Numbers and literals.
+            const char *begin = _p;
+            while (_p < _end && std::strchr(",}] \t\n\r", *_p) == nullptr) {
+                _p++;
+            }
+            if (_p == begin) {
+                _fail();
+            }
+        }
+    }
+};
+
+llaisysDataType_t parse_dtype(const std::string &name) {
+    static const std::pair<const char *, llaisysDataType_t> dtypes[] = {
+        {"BOOL", LLAISYS_DTYPE_BOOL},
+        {"I8", LLAISYS_DTYPE_I8},
+        {"I16", LLAISYS_DTYPE_I16},
+        {"I32", LLAISYS_DTYPE_I32},
+        {"I64", LLAISYS_DTYPE_I64},
+        {"U8", LLAISYS_DTYPE_U8},
+        {"U16", LLAISYS_DTYPE_U16},
+        {"U32", LLAISYS_DTYPE_U32},
+        {"U64", LLAISYS_DTYPE_U64},
+        {"F8_E4M3", LLAISYS_DTYPE_F8},
+        {"F8_E5M2", LLAISYS_DTYPE_F8_E5M2},
+        {"F16", LLAISYS_DTYPE_F16},
+        {"BF16", LLAISYS_DTYPE_BF16},
+        {"F32", LLAISYS_DTYPE_F32},
+        {"F64", LLAISYS_DTYPE_F64},
+    };
+    for (const auto &[str, dtype] : dtypes) {
+        if (name == str) {
+            return dtype;
+        }
+    }
+    return LLAISYS_DTYPE_INVALID;
+}
+
+#ifdef LLAISYS_HAS_MMAP
+struct Mapping {
+    void *addr;
+    size_t size;
+    Mapping(void *addr_, size_t size_) : addr(addr_), size(size_) {}
+    Mapping(const Mapping &) = delete;
+    Mapping &operator=(const Mapping &) = delete;
+    ~Mapping() {
+        munmap(addr, size);
+    }
+};
+#endif
+} // namespace
+
+namespace llaisys::models {
+SafeTensors::SafeTensors(const std::string &path) {
+    std::byte *memory = nullptr;
+    size_t size = 0;
+    std::shared_ptr<void> owner;
+#ifdef LLAISYS_HAS_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    CHECK_ARGUMENT(fd >= 0, "SafeTensors: cannot open " + path);
+    struct stat st;
+    void *addr = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        size = static_cast<size_t>(st.st_size);
+        // Private and writable, so that a weight modified in place never reaches the file.
+        addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+    CHECK_ARGUMENT(addr != MAP_FAILED, "SafeTensors: cannot map " + path);
+    memory = static_cast<std::byte *>(addr);
+    owner = std::make_shared<Mapping>(addr, size);
+#else
+    // Without mmap the file is read whole.
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    CHECK_ARGUMENT(file.good(), "SafeTensors: cannot open " + path);
+    size = static_cast<size_t>(file.tellg());
+    auto buffer = std::make_shared<std::vector<std::byte>>(size);
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(buffer->data()), static_cast<std::streamsize>(size));
+    CHECK_ARGUMENT(file.good(), "SafeTensors: cannot read " + path);
+    memory = buffer->data();
+    owner = buffer;
+#endif
+    _storage = core::context().runtime().wrapHostStorage(memory, size, std::move(owner));
+
+    uint64_t header_size = 0;
+    CHECK_ARGUMENT(size >= 8, "SafeTensors: truncated file " + path);
+    for (size_t i = 0; i < 8; i++) {
+        header_size |= static_cast<uint64_t>(memory[i]) << (8 * i);
+    }
+    CHECK_ARGUMENT(header_size <= size - 8, "SafeTensors: truncated file " + path);
+    _data = 8 + static_cast<size_t>(header_size);
+
+    const char *header = reinterpret_cast<const char *>(memory + 8);
+    Json json(header, header + header_size);
+    json.expect('{');
+    if (!json.accept('}')) {
+        do {
+            Entry entry{json.string(), LLAISYS_DTYPE_INVALID, {}, 0, 0};
+            json.expect(':');
+            if (entry.name == "__metadata__") {
+                json.skip();
+                continue;
+            }
+            bool has_offsets = false;
+            json.expect('{');
+            do {
+                const auto key = json.string();
+                json.expect(':');
+                if (key == "dtype") {
+                    entry.dtype = parse_dtype(json.string());
+                } else if (key == "shape") {
+                    entry.shape = json.integers();
+                } else if (key == "data_offsets") {
+                    const auto offsets = json.integers();
+                    CHECK_ARGUMENT(offsets.size() == 2, "SafeTensors: malformed header");
+                    entry.begin = offsets[0];
+                    entry.end = offsets[1];
+                    has_offsets = true;
+                } else {
+                    json.skip();
+                }
+            } while (json.accept(','));
+            json.expect('}');
+            CHECK_ARGUMENT(has_offsets && entry.begin <= entry.end && entry.end <= size - _data,
+                           "SafeTensors: " + entry.name + " lies outside of " + path);
+            _entries.push_back(std::move(entry));
+        } while (json.accept(','));
+        json.expect('}');
+    }
+}
+
+const std::vector<SafeTensors::Entry> &SafeTensors::entries() const {
+    return _entries;
+}
+
+tensor_t SafeTensors::get(const Entry &entry) const {
+    if (entry.dtype == LLAISYS_DTYPE_INVALID) {
+        EXCEPTION_UNSUPPORTED_DATATYPE(entry.dtype);
+    }
+    // Any overflow of the byte count is a mismatch, as the range fits in the file.
+    size_t bytes = utils::dsize(entry.dtype);
+    for (const size_t d : entry.shape) {
+        CHECK_ARGUMENT(d == 0 || bytes <= SIZE_MAX / d, "SafeTensors: size of " + entry.name + " does not match its shape");
+        bytes *= d;
+    }
+    CHECK_ARGUMENT(bytes == entry.end - entry.begin, "SafeTensors: size of " + entry.name + " does not match its shape");
+    return Tensor::createFromStorage(entry.shape, entry.dtype, _storage, _data + entry.begin);
+}
+} // namespace llaisys::models
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "../tensor/tensor.hpp"
+
+#include <string>
+#include <vector>
+
+namespace llaisys::models {
+// A .safetensors checkpoint mapped into memory: an 8-byte little-endian header size, a
+// JSON header giving the dtype, shape and byte range of each tensor, then their data.
+// The file is mapped copy-on-write rather than read, and each tensor is a view into
+// the mapping, which stays mapped while any of them is alive. Pages are read from the
+// file when first touched, so opening a checkpoint costs only its header.
+class SafeTensors {
+public:
+    struct Entry {
+        std::string name;
+        // LLAISYS_DTYPE_INVALID for dtypes without a llaisys equivalent, e.g. F64.
+        llaisysDataType_t dtype;
+        std::vector<size_t> shape;
+        // Byte range in the data section.
+        size_t begin, end;
+    };
+
+private:
+    core::storage_t _storage;
+    // Offset of the data section in the mapping.
+    size_t _data;
+    // In header order.
+    std::vector<Entry> _entries;
+
+public:
+    explicit SafeTensors(const std::string &path);
+
+    const std::vector<Entry> &entries() const;
+    // The tensor of `entry` on the host, in its stored dtype, sharing the mapping.
+    tensor_t get(const Entry &entry) const;
+};
+} // namespace llaisys::models
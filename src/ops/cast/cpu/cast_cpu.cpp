@@ -0,0 +1,145 @@
+// Intrinsics must come before llaisys.h, whose __C macro clashes with parameter
+// names used inside the compiler's intrinsic headers (see linear_cpu.cpp).
+#if defined(__AVX2__) || defined(__F16C__)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#else
+#include <immintrin.h>
+#endif
+#endif
+
+#include "cast_cpu.hpp"
+
+#include "../../../core/thread_pool/thread_pool.hpp"
+#include "../../../utils.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+// Elements converted per step through an fp32 buffer on the stack.
+constexpr size_t BLOCK = 256;
+constexpr size_t GRAIN_ELEMENTS = 16384;
+
+// Widen n elements to fp32 and multiply them by scale.
+template <typename T>
+void widen(float *dst, const T *src, size_t n, float scale) {
+    size_t i = 0;
+#if defined(__AVX2__) && defined(__F16C__)
+    const __m256 s = _mm256_set1_ps(scale);
+    for (; i + 8 <= n; i += 8) {
+        __m256 v;
+        if constexpr (std::is_same_v<T, float>) {
+            v = _mm256_loadu_ps(src + i);
+        } else if constexpr (std::is_same_v<T, llaisys::bf16_t>) {
+            __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            v = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16));
+        } else if constexpr (std::is_same_v<T, llaisys::fp16_t>) {
+            v = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+        } else if constexpr (std::is_same_v<T, int8_t>) {
+            v = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i))));
+        } else if constexpr (std::is_same_v<T, llaisys::f8e4m3_t>) {
+            // E4M3 bits moved into an fp16 with the same exponent field encode the value
+            // times 2^-8, as the fp16 exponent bias is 8 larger; subnormals map likewise.
+            __m128i b = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i)));
+            __m128i h = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(b, _mm_set1_epi16(0x7f)), 7),
+                                     _mm_slli_epi16(_mm_and_si128(b, _mm_set1_epi16(0x80)), 8));
+            v = _mm256_mul_ps(_mm256_cvtph_ps(h), _mm256_set1_ps(256.0f));
+        } else {
+            // E5M2 is the upper byte of an fp16.
+            __m128i b = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i)));
+            v = _mm256_cvtph_ps(_mm_slli_epi16(b, 8));
+        }
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(v, s));
+    }
+#endif
+    for (; i < n; i++) {
+        dst[i] = llaisys::utils::cast<float>(src[i]) * scale;
+    }
+}
+
+// Round n fp32 values to T.
+template <typename T>
+void narrow(T *dst, const float *src, size_t n) {
+    size_t i = 0;
+#if defined(__AVX2__) && defined(__F16C__)
+    if constexpr (std::is_same_v<T, llaisys::bf16_t>) {
+        // Round to nearest even on the bits, as utils::cast does.
+        for (; i + 8 <= n; i += 8) {
+            __m256i b = _mm256_castps_si256(_mm256_loadu_ps(src + i));
+            __m256i odd = _mm256_and_si256(_mm256_srli_epi32(b, 16), _mm256_set1_epi32(1));
+            b = _mm256_srli_epi32(_mm256_add_epi32(b, _mm256_add_epi32(odd, _mm256_set1_epi32(0x7fff))), 16);
+            __m128i h = _mm_packus_epi32(_mm256_castsi256_si128(b), _mm256_extracti128_si256(b, 1));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), h);
+        }
+    } else if constexpr (std::is_same_v<T, llaisys::fp16_t>) {
+        for (; i + 8 <= n; i += 8) {
+            __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), h);
+        }
+        for (; i < n; i++) {
+            dst[i] = llaisys::fp16_t{_cvtss_sh(src[i], _MM_FROUND_TO_NEAREST_INT)};
+        }
+    }
+#endif
+    if constexpr (std::is_same_v<T, float>) {
+        std::memcpy(dst, src, n * sizeof(float));
+        return;
+    }
+    for (; i < n; i++) {
+        dst[i] = llaisys::utils::cast<T>(src[i]);
+    }
+}
+
+template <typename TO, typename TI>
+void cast_(TO *out, const TI *in, size_t numel, float scale) {
+    llaisys::core::threadPool().parallelFor(numel, GRAIN_ELEMENTS, [=](size_t begin, size_t end) {
+        float buf[BLOCK];
+        for (size_t i = begin; i < end; i += BLOCK) {
+            size_t n = std::min(BLOCK, end - i);
+            widen(buf, in + i, n, scale);
+            narrow(out + i, buf, n);
+        }
+    });
+}
+
+// Calls f with a value of the C++ type that stores floating point dtype `type`, or
+// I8 if `with_i8`.
+template <typename F>
+void dispatch_(llaisysDataType_t type, F &&f, bool with_i8 = false) {
+    if (with_i8 && type == LLAISYS_DTYPE_I8) {
+        return f(int8_t{});
+    }
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return f(float{});
+    case LLAISYS_DTYPE_BF16:
+        return f(llaisys::bf16_t{});
+    case LLAISYS_DTYPE_F16:
+        return f(llaisys::fp16_t{});
+    case LLAISYS_DTYPE_F8:
+        return f(llaisys::f8e4m3_t{});
+    case LLAISYS_DTYPE_F8_E5M2:
+        return f(llaisys::f8e5m2_t{});
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+} // namespace
+
+namespace llaisys::ops::cpu {
+void cast(std::byte *out, const std::byte *in, llaisysDataType_t out_type, llaisysDataType_t in_type,
+          size_t numel, float scale) {
+    dispatch_(out_type, [&](auto to) {
+        using TO = decltype(to);
+        dispatch_(in_type, [&](auto ti) {
+            using TI = decltype(ti);
+            cast_(reinterpret_cast<TO *>(out), reinterpret_cast<const TI *>(in), numel, scale);
+        }, true);
+    });
+}
+} // namespace llaisys::ops::cpu
@@ -0,0 +1,11 @@
+#pragma once
+#include "llaisys.h"
+
+#include <cstddef>
+
+namespace llaisys::ops::cpu {
+// out = in * scale, elementwise, converting from in_type to out_type. Both types are
+// F32, BF16, F16, F8 (E4M3) or F8_E5M2; in_type may also be I8, e.g. to dequantize.
+void cast(std::byte *out, const std::byte *in, llaisysDataType_t out_type, llaisysDataType_t in_type,
+          size_t numel, float scale = 1.0f);
+}
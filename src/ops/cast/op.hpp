@@ -0,0 +1,10 @@
+#pragma once
+
+#include "../../tensor/tensor.hpp"
+
+namespace llaisys::ops {
+// Convert `in` to the dtype of `out`. Both are F32, BF16, F16, F8 (E4M3) or F8_E5M2;
+// conversions to 8-bit floats round to nearest and saturate to the largest finite value.
+// `in` may also be I8, whose integers are converted exactly.
+void cast(tensor_t out, tensor_t in);
+}
@@ -0,0 +1,66 @@
+#include "embedding_cpu.hpp"
+
+#include "../../../core/thread_pool/thread_pool.hpp"
+#include "../../../utils.hpp"
+#include "../../cast/cpu/cast_cpu.hpp"
+
+#include <cstring>
+
+namespace {
+constexpr size_t GRAIN_BYTES = 64 * 1024;
+} // namespace
+
+namespace llaisys::ops::cpu {
+void embedding(std::byte *out, const std::byte *index, const std::byte *weight, llaisysDataType_t type,
+               size_t num_index, size_t embedding_dim) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+    case LLAISYS_DTYPE_BF16:
+    case LLAISYS_DTYPE_F16:
+        break;
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+
+    // Rows are copied verbatim, so only the element size matters.
+    const size_t row_bytes = embedding_dim * llaisys::utils::dsize(type);
+    const int64_t *indices = reinterpret_cast<const int64_t *>(index);
+    size_t grain = (GRAIN_BYTES + row_bytes - 1) / row_bytes;
+    llaisys::core::threadPool().parallelFor(num_index, grain, [=](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            std::memcpy(out + i * row_bytes, weight + indices[i] * row_bytes, row_bytes);
+        }
+    });
+}
+
+void embedding_scaled(std::byte *out, const std::byte *index, const std::byte *weight, const std::byte *scales,
+                      llaisysDataType_t out_type, llaisysDataType_t weight_type, llaisysDataType_t scale_type,
+                      size_t num_index, size_t embedding_dim, bool per_tensor) {
+    auto scale_at = [=](size_t row) -> float {
+        switch (scale_type) {
+        case LLAISYS_DTYPE_F32:
+            return reinterpret_cast<const float *>(scales)[row];
+        case LLAISYS_DTYPE_BF16:
+            return llaisys::utils::cast<float>(reinterpret_cast<const llaisys::bf16_t *>(scales)[row]);
+        case LLAISYS_DTYPE_F16:
+            return llaisys::utils::cast<float>(reinterpret_cast<const llaisys::fp16_t *>(scales)[row]);
+        default:
+            EXCEPTION_UNSUPPORTED_DATATYPE(scale_type);
+        }
+    };
+    // Validate the scale type before entering the parallel region.
+    scale_at(0);
+
+    const size_t out_row_bytes = embedding_dim * llaisys::utils::dsize(out_type);
+    const size_t weight_row_bytes = embedding_dim * llaisys::utils::dsize(weight_type);
+    const int64_t *indices = reinterpret_cast<const int64_t *>(index);
+    size_t grain = (GRAIN_BYTES + out_row_bytes - 1) / out_row_bytes;
+    llaisys::core::threadPool().parallelFor(num_index, grain, [=](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            size_t row = static_cast<size_t>(indices[i]);
+            cast(out + i * out_row_bytes, weight + row * weight_row_bytes, out_type, weight_type, embedding_dim,
+                 scale_at(per_tensor ? 0 : row));
+        }
+    });
+}
+} // namespace llaisys::ops::cpu
@@ -0,0 +1,17 @@
+#pragma once
+#include "llaisys.h"
+
+#include <cstddef>
+
+namespace llaisys::ops::cpu {
+// out[i] = weight[index[i]] for each of the `num_index` int64 indices
+void embedding(std::byte *out, const std::byte *index, const std::byte *weight, llaisysDataType_t type,
+               size_t num_index, size_t embedding_dim);
+
+// Same lookup from an F8 or F8_E5M2 weight of dtype weight_type: each row is widened to
+// out_type and multiplied by its scale of scale_type, scales[index[i]], or scales[0]
+// for all rows if `per_tensor`.
+void embedding_scaled(std::byte *out, const std::byte *index, const std::byte *weight, const std::byte *scales,
+                      llaisysDataType_t out_type, llaisysDataType_t weight_type, llaisysDataType_t scale_type,
+                      size_t num_index, size_t embedding_dim, bool per_tensor);
+}
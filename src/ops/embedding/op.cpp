@@ -1,55 +1,61 @@
 #include "op.hpp"
 
 #include "../../core/llaisys_core.hpp"
-#include "../../utils/check.hpp"
+#include "../../utils.hpp"
 
-#include "embedding_cpu.hpp"
+#include "cpu/embedding_cpu.hpp"
 
 namespace llaisys::ops {
-void embedding(tensor_t out, tensor_t index, tensor_t weight) {
-    CHECK_SAME_DEVICE(out, weight);
-    CHECK_SAME_DEVICE(out, index);
-    
-    CHECK_SAME_DTYPE(out->dtype(), weight->dtype());
-    CHECK_ARGUMENT(index->dtype() == LLAISYS_DTYPE_I64, 
-                  "Index tensor must be Int64 type");
-    
-    CHECK_ARGUMENT(out->ndim() == 2, "Output must be 2D tensor");
-    CHECK_ARGUMENT(index->ndim() == 1, "Index must be 1D tensor");
-    CHECK_ARGUMENT(weight->ndim() == 2, "Weight must be 2D tensor");
-    
-    int64_t index_size = index->shape()[0];
-    int64_t embedding_dim = weight->shape()[1];
-    
-    CHECK_ARGUMENT(out->shape()[0] == index_size, 
-                  "Output first dimension must match index size");
-    CHECK_ARGUMENT(out->shape()[1] == embedding_dim,
-                  "Output second dimension must match weight embedding dimension");
-    
-    CHECK_ARGUMENT(index_size > 0 && embedding_dim > 0,
-                  "Dimensions must be positive");
-    
+void embedding(tensor_t out, tensor_t index, tensor_t weight, tensor_t scales) {
+    CHECK_SAME_DEVICE(out, index, weight);
+    bool fp8 = weight->dtype() == LLAISYS_DTYPE_F8 || weight->dtype() == LLAISYS_DTYPE_F8_E5M2;
+    bool per_tensor = false;
+    if (fp8) {
+        CHECK_ARGUMENT(scales != nullptr, "Embedding: an fp8 weight needs scales");
+        CHECK_SAME_DEVICE(weight, scales);
+        per_tensor = scales->numel() == 1;
+        CHECK_ARGUMENT(per_tensor || (scales->shape()[0] == weight->shape()[0] && scales->numel() == scales->shape()[0]),
+                       "Embedding: scales must be [vocab], [vocab, 1] or [1]");
+        ASSERT(scales->isContiguous(), "Embedding: scales must be contiguous.");
+    } else {
+        CHECK_ARGUMENT(scales == nullptr, "Embedding: scales are only used with an fp8 weight");
+        CHECK_SAME_DTYPE(out->dtype(), weight->dtype());
+    }
+    CHECK_ARGUMENT(index->dtype() == LLAISYS_DTYPE_I64, "Embedding: index must be int64");
+    CHECK_ARGUMENT(out->ndim() == 2 && index->ndim() == 1 && weight->ndim() == 2,
+                   "Embedding: expected out [n, dim], index [n] and weight [vocab, dim]");
+    CHECK_ARGUMENT(out->shape()[0] == index->shape()[0], "Embedding: output rows must match index size");
+    CHECK_ARGUMENT(out->shape()[1] == weight->shape()[1], "Embedding: output and weight dims must match");
     ASSERT(out->isContiguous() && index->isContiguous() && weight->isContiguous(),
-           "Embedding: all tensors must be contiguous");
+           "Embedding: all tensors must be contiguous.");
+
+    size_t num_index = index->shape()[0];
+    size_t embedding_dim = weight->shape()[1];
+
+    auto embedding_cpu = [&]() {
+        if (fp8) {
+            return cpu::embedding_scaled(out->data(), index->data(), weight->data(), scales->data(), out->dtype(),
+                                         weight->dtype(), scales->dtype(), num_index, embedding_dim, per_tensor);
+        }
+        return cpu::embedding(out->data(), index->data(), weight->data(), out->dtype(), num_index, embedding_dim);
+    };
 
     if (out->deviceType() == LLAISYS_DEVICE_CPU) {
-        return cpu::embedding(out->data(), index->data(), weight->data(),
-                            out->dtype(), index_size, embedding_dim);
+        return embedding_cpu();
     }
 
     llaisys::core::context().setDevice(out->deviceType(), out->deviceId());
 
     switch (out->deviceType()) {
-        case LLAISYS_DEVICE_CPU:
-            return cpu::embedding(out->data(), index->data(), weight->data(),
-                                out->dtype(), index_size, embedding_dim);
+    case LLAISYS_DEVICE_CPU:
+        return embedding_cpu();
 #ifdef ENABLE_NVIDIA_API
-        case LLAISYS_DEVICE_NVIDIA:
-            TO_BE_IMPLEMENTED();
-            return;
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return;
 #endif
-        default:
-            EXCEPTION_UNSUPPORTED_DEVICE;
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
     }
 }
 } // namespace llaisys::ops
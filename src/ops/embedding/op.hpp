@@ -3,5 +3,7 @@
 #include "../../tensor/tensor.hpp"
 
 namespace llaisys::ops {
-void embedding(tensor_t out, tensor_t index, tensor_t weight);
+// out[i] = weight[index[i]]. An F8 or F8_E5M2 weight is dequantized into the dtype of
+// out with `scales`, one per row ([vocab] or [vocab, 1]) or a single one ([1]).
+void embedding(tensor_t out, tensor_t index, tensor_t weight, tensor_t scales = nullptr);
 }
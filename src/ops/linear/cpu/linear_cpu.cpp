@@ -0,0 +1,1120 @@
+// Intrinsics must come before llaisys.h, whose __C macro clashes with parameter
+// names used inside the compiler's intrinsic headers. GCC also reports spurious
+// maybe-uninitialized warnings from the AVX-512 headers, which -Werror turns fatal.
+#if defined(__AVX2__) || defined(__AVX512F__) || defined(__F16C__)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#else
+#include <immintrin.h>
+#endif
+#endif
+
+#include "linear_cpu.hpp"
+
+#include "../../../core/thread_pool/thread_pool.hpp"
+#include "../../../utils.hpp"
+#include "../../quantize.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace {
+template <typename T>
+inline float to_f32(T val) {
+    if constexpr (std::is_same_v<T, llaisys::bf16_t>) {
+        uint32_t bits = static_cast<uint32_t>(val._v) << 16;
+        float out;
+        std::memcpy(&out, &bits, sizeof(out));
+        return out;
+#if defined(__F16C__)
+    } else if constexpr (std::is_same_v<T, llaisys::fp16_t>) {
+        return _cvtsh_ss(val._v);
+    } else if constexpr (std::is_same_v<T, llaisys::f8e4m3_t>) {
+        // See Vec::load.
+        return _cvtsh_ss(static_cast<unsigned short>((val._v & 0x7f) << 7 | (val._v & 0x80) << 8)) * 256.0f;
+    } else if constexpr (std::is_same_v<T, llaisys::f8e5m2_t>) {
+        return _cvtsh_ss(static_cast<unsigned short>(val._v << 8));
+#endif
+    } else {
+        return llaisys::utils::cast<float>(val);
+    }
+}
+
+// Widen n contiguous elements to fp32.
+template <typename T>
+void convert_row(float *dst, const T *src, size_t n) {
+    if constexpr (std::is_same_v<T, float>) {
+        std::memcpy(dst, src, n * sizeof(float));
+        return;
+    }
+    size_t i = 0;
+#if defined(__AVX2__)
+    if constexpr (std::is_same_v<T, llaisys::bf16_t>) {
+        for (; i + 8 <= n; i += 8) {
+            __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            __m256i w = _mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16);
+            _mm256_storeu_ps(dst + i, _mm256_castsi256_ps(w));
+        }
+    }
+#endif
+#if defined(__F16C__)
+    if constexpr (std::is_same_v<T, llaisys::fp16_t>) {
+        for (; i + 8 <= n; i += 8) {
+            __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        dst[i] = to_f32(src[i]);
+    }
+}
+
+// 4-bit weights are stored in blocks of Q4_BLOCK values packed into Q4_BLOCK / 2
+// bytes: byte j holds value j in its low nibble and value j + Q4_BLOCK / 2 in its
+// high nibble, so that the two halves of a block unpack into whole vectors.
+constexpr size_t Q4_BLOCK = 32;
+
+// fp32 vector of the widest available instruction set. Loads from half precision
+// storage widen to fp32 in registers.
+#if defined(__AVX512F__)
+#define LLAISYS_LINEAR_SIMD
+struct Vec {
+    using reg = __m512;
+    static constexpr size_t width = 16;
+    static reg zero() { return _mm512_setzero_ps(); }
+    static reg set1(float v) { return _mm512_set1_ps(v); }
+    static reg add(reg a, reg b) { return _mm512_add_ps(a, b); }
+    static reg mul(reg a, reg b) { return _mm512_mul_ps(a, b); }
+    static reg fmadd(reg a, reg b, reg c) { return _mm512_fmadd_ps(a, b, c); }
+    static float sum(reg v) { return _mm512_reduce_add_ps(v); }
+    static void store(float *p, reg v) { _mm512_storeu_ps(p, v); }
+    static reg load(const float *p) { return _mm512_loadu_ps(p); }
+    static reg load(const llaisys::bf16_t *p) {
+        __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(h), 16));
+    }
+    static reg load(const llaisys::fp16_t *p) {
+        return _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+    }
+    static reg load(const int8_t *p) {
+        return _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))));
+    }
+    // E4M3 bits moved into an fp16 with the same exponent field encode the value times
+    // 2^-8, as the fp16 exponent bias is 8 larger; subnormals map likewise. The E4M3
+    // NaN encoding is not special-cased. E5M2 is the upper byte of an fp16.
+    static reg load(const llaisys::f8e4m3_t *p) {
+        __m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+        __m256i h = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(b, _mm256_set1_epi16(0x7f)), 7),
+                                    _mm256_slli_epi16(_mm256_and_si256(b, _mm256_set1_epi16(0x80)), 8));
+        return _mm512_mul_ps(_mm512_cvtph_ps(h), _mm512_set1_ps(256.0f));
+    }
+    static reg load(const llaisys::f8e5m2_t *p) {
+        __m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+        return _mm512_cvtph_ps(_mm256_slli_epi16(b, 8));
+    }
+    // Unpack one block of 4-bit values into Q4_BLOCK / width vectors.
+    static void load_q4(const uint8_t *p, reg *out) {
+        __m512i b = _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+        out[0] = _mm512_cvtepi32_ps(_mm512_and_si512(b, _mm512_set1_epi32(0xf)));
+        out[1] = _mm512_cvtepi32_ps(_mm512_srli_epi32(b, 4));
+    }
+};
+#elif defined(__AVX2__) && defined(__FMA__) && defined(__F16C__)
+#define LLAISYS_LINEAR_SIMD
+struct Vec {
+    using reg = __m256;
+    static constexpr size_t width = 8;
+    static reg zero() { return _mm256_setzero_ps(); }
+    static reg set1(float v) { return _mm256_set1_ps(v); }
+    static reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+    static reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+    static reg fmadd(reg a, reg b, reg c) { return _mm256_fmadd_ps(a, b, c); }
+    static float sum(reg v) {
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        s = _mm_add_ss(s, _mm_movehdup_ps(s));
+        return _mm_cvtss_f32(s);
+    }
+    static void store(float *p, reg v) { _mm256_storeu_ps(p, v); }
+    static reg load(const float *p) { return _mm256_loadu_ps(p); }
+    static reg load(const llaisys::bf16_t *p) {
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16));
+    }
+    static reg load(const llaisys::fp16_t *p) {
+        return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+    }
+    static reg load(const int8_t *p) {
+        return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p))));
+    }
+    static reg load(const llaisys::f8e4m3_t *p) {
+        __m128i b = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+        __m128i h = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(b, _mm_set1_epi16(0x7f)), 7),
+                                 _mm_slli_epi16(_mm_and_si128(b, _mm_set1_epi16(0x80)), 8));
+        return _mm256_mul_ps(_mm256_cvtph_ps(h), _mm256_set1_ps(256.0f));
+    }
+    static reg load(const llaisys::f8e5m2_t *p) {
+        __m128i b = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+        return _mm256_cvtph_ps(_mm_slli_epi16(b, 8));
+    }
+    static void load_q4(const uint8_t *p, reg *out) {
+        __m256i b0 = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+        __m256i b1 = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p + 8)));
+        __m256i mask = _mm256_set1_epi32(0xf);
+        out[0] = _mm256_cvtepi32_ps(_mm256_and_si256(b0, mask));
+        out[1] = _mm256_cvtepi32_ps(_mm256_and_si256(b1, mask));
+        out[2] = _mm256_cvtepi32_ps(_mm256_srli_epi32(b0, 4));
+        out[3] = _mm256_cvtepi32_ps(_mm256_srli_epi32(b1, 4));
+    }
+};
+#else
+struct Vec {
+    using reg = float;
+    static constexpr size_t width = 1;
+    static reg zero() { return 0.0f; }
+    static reg set1(float v) { return v; }
+    static reg add(reg a, reg b) { return a + b; }
+    static reg mul(reg a, reg b) { return a * b; }
+    static reg fmadd(reg a, reg b, reg c) { return a * b + c; }
+    static float sum(reg v) { return v; }
+    static void store(float *p, reg v) { *p = v; }
+    template <typename T>
+    static reg load(const T *p) { return to_f32(*p); }
+    static void load_q4(const uint8_t *p, reg *out) {
+        for (size_t j = 0; j < Q4_BLOCK / 2; j++) {
+            out[j] = static_cast<float>(p[j] & 0xf);
+            out[j + Q4_BLOCK / 2] = static_cast<float>(p[j] >> 4);
+        }
+    }
+};
+#endif
+
+// GEMM engine for out = in * weight^T.
+//
+// The computation follows the usual Goto/BLIS decomposition: a KC x NC block of the
+// weight is laid out as panels of NR rows and kept in L3, an MC x KC panel of the
+// activation is packed into L2, and an MR x NR tile of fp32 accumulators is updated
+// in registers by the micro kernel while streaming KC x NR weight slivers from L1.
+// The activation is widened to fp32 while packing. Weight slivers keep their storage
+// type and are widened in registers, so a weight that was packed once at load time
+// (see linear_pack_weight) is consumed directly without any per-call copy.
+#if defined(__AVX512F__)
+constexpr size_t MR = 12;
+#elif defined(LLAISYS_LINEAR_SIMD)
+constexpr size_t MR = 6;
+#else
+constexpr size_t MR = 4;
+#endif
+#if defined(LLAISYS_LINEAR_SIMD)
+constexpr size_t NR = 2 * Vec::width;
+#else
+constexpr size_t NR = 16;
+#endif
+constexpr size_t KC = 256;
+constexpr size_t MC = MR * 10;
+constexpr size_t NC = NR * 16;
+// Work is split across threads in tiles of output rows and columns, each computed by
+// a private run of the blocked loops above. Every tile re-packs its activation rows,
+// so GEMM tiles are only narrowed below NC when there are too few to go around.
+constexpr size_t TILE_M = MC * 2;
+constexpr size_t TILES_PER_THREAD = 2;
+constexpr size_t GEMV_TILE_N = NR * 4;
+
+// Pack `rows` x `kc` activation elements (leading dimension ld) into fp32 panels of
+// MR rows stored k-major, i.e. dst[panel][k][r]. The last panel is zero padded so
+// that the micro kernel never needs to special-case ragged edges.
+template <typename T>
+void pack_a(float *dst, const T *src, size_t ld, size_t rows, size_t kc) {
+    float row[KC];
+    for (size_t r0 = 0; r0 < rows; r0 += MR) {
+        size_t nrows = std::min(MR, rows - r0);
+        for (size_t r = 0; r < MR; r++) {
+            if (r < nrows) {
+                convert_row(row, src + (r0 + r) * ld, kc);
+            } else {
+                std::fill(row, row + kc, 0.0f);
+            }
+            for (size_t k = 0; k < kc; k++) {
+                dst[k * MR + r] = row[k];
+            }
+        }
+        dst += MR * kc;
+    }
+}
+
+// Same layout for weight rows in panels of NR, keeping the storage type.
+template <typename T>
+void pack_b(T *dst, const T *src, size_t ld, size_t rows, size_t kc) {
+    for (size_t r0 = 0; r0 < rows; r0 += NR) {
+        size_t nrows = std::min(NR, rows - r0);
+        for (size_t r = 0; r < NR; r++) {
+            for (size_t k = 0; k < kc; k++) {
+                dst[k * NR + r] = r < nrows ? src[(r0 + r) * ld + k] : T{};
+            }
+        }
+        dst += NR * kc;
+    }
+}
+
+// Same layout for int8 or fp8 weight rows starting at column k0, dequantized to fp32.
+// Each row has one scale per group_size consecutive columns, and the scales of
+// consecutive rows are scale_stride apart (0 when one scale covers the whole tensor).
+template <typename Q, typename TS>
+void pack_b_scaled(float *dst, const Q *src, const TS *scales, size_t scale_stride, size_t ld, size_t group_size,
+                   size_t rows, size_t k0, size_t kc) {
+    for (size_t r0 = 0; r0 < rows; r0 += NR) {
+        size_t nrows = std::min(NR, rows - r0);
+        for (size_t r = 0; r < NR; r++) {
+            const Q *q = src + (r0 + r) * ld + k0;
+            const TS *s = scales + (r0 + r) * scale_stride;
+            for (size_t k = 0; k < kc;) {
+                size_t g = (k0 + k) / group_size;
+                size_t end = std::min(kc, (g + 1) * group_size - k0);
+                float scale = r < nrows ? to_f32(s[g]) : 0.0f;
+                for (; k < end; k++) {
+                    dst[k * NR + r] = r < nrows ? to_f32(q[k]) * scale : 0.0f;
+                }
+            }
+        }
+        dst += NR * kc;
+    }
+}
+
+// Same for 4-bit weight rows, with K measured in values rather than bytes. k0 and kc
+// are multiples of Q4_BLOCK, and so is group_size. A row without zero points uses 8.
+template <typename TS>
+void pack_b_int4(float *dst, const uint8_t *src, const TS *scales, const uint8_t *zeros, size_t K,
+                 size_t group_size, size_t rows, size_t k0, size_t kc) {
+    const size_t groups = K / group_size;
+    for (size_t r0 = 0; r0 < rows; r0 += NR) {
+        size_t nrows = std::min(NR, rows - r0);
+        for (size_t r = 0; r < NR; r++) {
+            if (r >= nrows) {
+                for (size_t k = 0; k < kc; k++) {
+                    dst[k * NR + r] = 0.0f;
+                }
+                continue;
+            }
+            const size_t row = r0 + r;
+            for (size_t kb = 0; kb < kc; kb += Q4_BLOCK) {
+                const uint8_t *q = src + row * K / 2 + (k0 + kb) / 2;
+                size_t g = row * groups + (k0 + kb) / group_size;
+                float scale = to_f32(scales[g]);
+                float zero = zeros ? static_cast<float>(zeros[g]) : 8.0f;
+                for (size_t j = 0; j < Q4_BLOCK / 2; j++) {
+                    dst[(kb + j) * NR + r] = (static_cast<float>(q[j] & 0xf) - zero) * scale;
+                    dst[(kb + j + Q4_BLOCK / 2) * NR + r] = (static_cast<float>(q[j] >> 4) - zero) * scale;
+                }
+            }
+        }
+        dst += NR * kc;
+    }
+}
+
+// c[MR, NR] (+)= a[kc, MR]^T * b[kc, NR]
+#if defined(LLAISYS_LINEAR_SIMD)
+template <typename TB>
+void micro_kernel(size_t kc, const float *a, const TB *b, float *c, size_t ldc, bool accumulate) {
+    Vec::reg acc[MR][2];
+    for (size_t i = 0; i < MR; i++) {
+        acc[i][0] = Vec::zero();
+        acc[i][1] = Vec::zero();
+    }
+    for (size_t k = 0; k < kc; k++) {
+        Vec::reg b0 = Vec::load(b);
+        Vec::reg b1 = Vec::load(b + Vec::width);
+        for (size_t i = 0; i < MR; i++) {
+            Vec::reg ai = Vec::set1(a[i]);
+            acc[i][0] = Vec::fmadd(ai, b0, acc[i][0]);
+            acc[i][1] = Vec::fmadd(ai, b1, acc[i][1]);
+        }
+        a += MR;
+        b += NR;
+    }
+    for (size_t i = 0; i < MR; i++) {
+        float *ci = c + i * ldc;
+        if (accumulate) {
+            acc[i][0] = Vec::add(acc[i][0], Vec::load(ci));
+            acc[i][1] = Vec::add(acc[i][1], Vec::load(ci + Vec::width));
+        }
+        Vec::store(ci, acc[i][0]);
+        Vec::store(ci + Vec::width, acc[i][1]);
+    }
+}
+#else
+template <typename TB>
+void micro_kernel(size_t kc, const float *a, const TB *b, float *c, size_t ldc, bool accumulate) {
+    float acc[MR][NR] = {};
+    for (size_t k = 0; k < kc; k++) {
+        for (size_t i = 0; i < MR; i++) {
+            for (size_t j = 0; j < NR; j++) {
+                acc[i][j] += a[i] * to_f32(b[j]);
+            }
+        }
+        a += MR;
+        b += NR;
+    }
+    for (size_t i = 0; i < MR; i++) {
+        for (size_t j = 0; j < NR; j++) {
+            c[i * ldc + j] = accumulate ? c[i * ldc + j] + acc[i][j] : acc[i][j];
+        }
+    }
+}
+#endif
+
+// c[mc, nc] (+)= packed a[mc, kc] * packed b[nc, kc]^T, where consecutive weight
+// panels start b_stride elements apart.
+template <typename TB>
+void macro_kernel(size_t mc, size_t nc, size_t kc, const float *a_pack, const TB *b_pack, size_t b_stride,
+                  float *c, size_t ldc, bool accumulate) {
+    alignas(64) float tile[MR * NR];
+    for (size_t jr = 0; jr < nc; jr += NR) {
+        size_t nr = std::min(NR, nc - jr);
+        const TB *b = b_pack + jr / NR * b_stride;
+        for (size_t ir = 0; ir < mc; ir += MR) {
+            size_t mr = std::min(MR, mc - ir);
+            const float *a = a_pack + ir * kc;
+            float *ct = c + ir * ldc + jr;
+            if (mr == MR && nr == NR) {
+                micro_kernel(kc, a, b, ct, ldc, accumulate);
+                continue;
+            }
+            micro_kernel(kc, a, b, tile, NR, false);
+            for (size_t i = 0; i < mr; i++) {
+                for (size_t j = 0; j < nr; j++) {
+                    ct[i * ldc + j] = accumulate ? ct[i * ldc + j] + tile[i * NR + j] : tile[i * NR + j];
+                }
+            }
+        }
+    }
+}
+
+// Weight operands of the GEMM and GEMV kernels. panels(jc, pc, nc, kc) returns the
+// NR-row panels covering weight rows [jc, jc + nc) and columns [pc, pc + kc), with
+// the distance in elements between consecutive panels. rows(j0) views the weight
+// from row j0 on, where j0 is a multiple of NR.
+
+// Row-major weight, packed block by block as the GEMM reaches it.
+template <typename T>
+struct DenseWeight {
+    static constexpr size_t gemv_max_batch = 16;
+    const T *w;
+    size_t K;
+
+    DenseWeight rows(size_t j0) const { return {w + j0 * K, K}; }
+    std::pair<const T *, size_t> panels(size_t jc, size_t pc, size_t nc, size_t kc) const {
+        thread_local std::vector<T> buf;
+        buf.resize(NC * KC);
+        pack_b(buf.data(), w + jc * K + pc, K, nc, kc);
+        return {buf.data(), kc * NR};
+    }
+};
+
+// Weight produced by linear_pack_weight. It already holds full-K panels of NR rows,
+// so every block is addressed in place, and with no set-up cost the GEMM takes over
+// from the GEMV sooner.
+template <typename T>
+struct PackedWeight {
+    static constexpr size_t gemv_max_batch = 4;
+    const T *w;
+    size_t K;
+
+    PackedWeight rows(size_t j0) const { return {w + j0 * K, K}; }
+    std::pair<const T *, size_t> panels(size_t jc, size_t pc, size_t, size_t) const {
+        return {w + jc * K + pc * NR, K * NR};
+    }
+};
+
+// Row-major int8 or fp8 weight with one scale per group of group_size input features,
+// or a single scale for the whole tensor (scale_stride 0). The GEMM dequantizes each
+// block to fp32 while packing it.
+template <typename Q, typename TS>
+struct ScaledWeight {
+    static constexpr size_t gemv_max_batch = 16;
+    const Q *q;
+    const TS *scales;
+    size_t scale_stride;
+    size_t K;
+    size_t group_size;
+
+    ScaledWeight rows(size_t j0) const {
+        return {q + j0 * K, scales + j0 * scale_stride, scale_stride, K, group_size};
+    }
+    std::pair<const float *, size_t> panels(size_t jc, size_t pc, size_t nc, size_t kc) const {
+        thread_local std::vector<float> buf;
+        buf.resize(NC * KC);
+        pack_b_scaled(buf.data(), q + jc * K, scales + jc * scale_stride, scale_stride, K, group_size, nc, pc, kc);
+        return {buf.data(), kc * NR};
+    }
+};
+
+// 4-bit weight with one scale, and optionally one zero point, per group of
+// group_size input features, dequantized to fp32 while packing like ScaledWeight.
+template <typename TS>
+struct Int4Weight {
+    static constexpr size_t gemv_max_batch = 16;
+    const uint8_t *q;
+    const TS *scales;
+    const uint8_t *zeros;
+    size_t K;
+    size_t group_size;
+
+    Int4Weight rows(size_t j0) const {
+        size_t groups = K / group_size;
+        return {q + j0 * K / 2, scales + j0 * groups, zeros ? zeros + j0 * groups : nullptr, K, group_size};
+    }
+    std::pair<const float *, size_t> panels(size_t jc, size_t pc, size_t nc, size_t kc) const {
+        thread_local std::vector<float> buf;
+        buf.resize(NC * KC);
+        Int4Weight w = rows(jc);
+        pack_b_int4(buf.data(), w.q, w.scales, w.zeros, K, group_size, nc, pc, kc);
+        return {buf.data(), kc * NR};
+    }
+};
+
+inline float activate(llaisysActivation_t activation, float x) {
+    switch (activation) {
+    case LLAISYS_ACTIVATION_RELU:
+        return std::max(x, 0.0f);
+    case LLAISYS_ACTIVATION_SILU:
+        return x / (1.0f + std::exp(-x));
+    case LLAISYS_ACTIVATION_GELU:
+        return 0.5f * x * (1.0f + std::erf(x * 0.70710678f));
+    default:
+        return x;
+    }
+}
+
+// Epilogue shared by the kernels. They hand over fp32 results by runs of columns of
+// one output row; the store adds the bias, applies the activation and the residual,
+// rounds to T and routes each column to the output part that holds it. Each value is
+// read and written once, while the run is still in cache.
+template <typename T>
+struct Store {
+    const llaisys::ops::cpu::LinearOutput &out;
+    const T *bias;
+    const T *residual;
+    llaisysActivation_t activation;
+    size_t ld_residual;
+
+    // vals holds columns [j, j + n) of output row i.
+    void operator()(size_t i, size_t j, const float *vals, size_t n) const {
+        for (size_t p = 0, col = 0; p < out.parts && n > 0; col += out.width[p++]) {
+            if (j >= col + out.width[p]) {
+                continue;
+            }
+            size_t c0 = j - col;
+            size_t cn = std::min(n, out.width[p] - c0);
+            T *o = reinterpret_cast<T *>(out.data[p]) + i * out.width[p] + c0;
+            if (activation == LLAISYS_ACTIVATION_NONE && !residual) {
+                for (size_t c = 0; c < cn; c++) {
+                    float val = bias ? vals[c] + to_f32(bias[j + c]) : vals[c];
+                    o[c] = llaisys::utils::cast<T>(val);
+                }
+            } else {
+                // The residual may alias the output; each element is read before it is written.
+                const T *r = residual ? residual + i * ld_residual + j : nullptr;
+                for (size_t c = 0; c < cn; c++) {
+                    float val = activate(activation, bias ? vals[c] + to_f32(bias[j + c]) : vals[c]);
+                    o[c] = llaisys::utils::cast<T>(r ? val + to_f32(r[c]) : val);
+                }
+            }
+            j += cn;
+            vals += cn;
+            n -= cn;
+        }
+    }
+};
+
+// Epilogue of the fused gate/up projection. The weight rows alternate between
+// LINEAR_SWIGLU_BLOCK gate rows and the matching up rows, and every run handed over by
+// the kernels starts at a multiple of NR and covers whole pairs of blocks, so each
+// pair is reduced to silu(gate) * up right away and only the product is written.
+static_assert(NR % (2 * llaisys::ops::cpu::LINEAR_SWIGLU_BLOCK) == 0,
+              "column runs must hold whole pairs of gate and up blocks");
+
+template <typename T>
+struct SwiGLUStore {
+    T *out;
+    const T *bias;
+    size_t width;
+
+    // vals holds interleaved columns [j, j + n) of row i, i.e. outputs from j / 2 on.
+    void operator()(size_t i, size_t j, const float *vals, size_t n) const {
+        using llaisys::ops::cpu::LINEAR_SWIGLU_BLOCK;
+        T *o = out + i * width;
+        for (const size_t end = j + n; j < end;) {
+            size_t c0 = j / 2;
+            size_t blk = std::min(LINEAR_SWIGLU_BLOCK, width - c0);
+            for (size_t c = 0; c < blk; c++) {
+                float gate = bias ? vals[c] + to_f32(bias[j + c]) : vals[c];
+                float up = bias ? vals[blk + c] + to_f32(bias[j + blk + c]) : vals[blk + c];
+                o[c0 + c] = llaisys::utils::cast<T>(up * gate / (1.0f + std::exp(-gate)));
+            }
+            j += 2 * blk;
+            vals += 2 * blk;
+        }
+    }
+};
+
+// Output rows [i0, i0 + M) and columns [j0, j0 + N) of in * weight^T for one tile,
+// where `in` and `weight` already point at the tile's first row.
+template <typename T, typename Weight, typename Store>
+void gemm_tile_(const Store &store, size_t i0, size_t j0, const T *in, const Weight &weight,
+                size_t M, size_t K, size_t N) {
+    // Packing buffers and the fp32 accumulator block are reused across calls. The
+    // block is handed to the store once the whole K dimension has been reduced.
+    thread_local std::vector<float> a_pack, c_acc;
+    a_pack.resize(MC * KC);
+    c_acc.resize(M * NC);
+
+    for (size_t jc = 0; jc < N; jc += NC) {
+        size_t nc = std::min(NC, N - jc);
+        float *c = c_acc.data();
+        size_t ldc = nc;
+        if (K == 0) {
+            std::fill(c, c + M * ldc, 0.0f);
+        }
+
+        for (size_t pc = 0; pc < K; pc += KC) {
+            size_t kc = std::min(KC, K - pc);
+            auto [b, b_stride] = weight.panels(jc, pc, nc, kc);
+            for (size_t ic = 0; ic < M; ic += MC) {
+                size_t mc = std::min(MC, M - ic);
+                pack_a(a_pack.data(), in + ic * K + pc, K, mc, kc);
+                macro_kernel(mc, nc, kc, a_pack.data(), b, b_stride, c + ic * ldc, ldc, pc != 0);
+            }
+        }
+
+        for (size_t i = 0; i < M; i++) {
+            store(i0 + i, j0 + jc, c + i * ldc, nc);
+        }
+    }
+}
+
+template <typename T, typename Weight, typename Store>
+void gemm_(const Store &store, const T *in, const Weight &weight, size_t M, size_t K, size_t N) {
+    auto &pool = llaisys::core::threadPool();
+    const size_t m_tiles = (M + TILE_M - 1) / TILE_M;
+    size_t tile_n = NC;
+    while (tile_n > NR && m_tiles * ((N + tile_n - 1) / tile_n) < pool.numThreads() * TILES_PER_THREAD) {
+        tile_n /= 2;
+    }
+    const size_t n_tiles = (N + tile_n - 1) / tile_n;
+    pool.parallelFor(m_tiles * n_tiles, 1, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+            size_t i0 = t / n_tiles * TILE_M;
+            size_t j0 = t % n_tiles * tile_n;
+            gemm_tile_(store, i0, j0, in + i0 * K, weight.rows(j0),
+                       std::min(TILE_M, M - i0), K, std::min(tile_n, N - j0));
+        }
+    });
+}
+
+// Decode path. With only a few activation rows every weight element is used a
+// handful of times, so the kernel is bound by how fast the weight can be streamed
+// from memory. GEMV_ROWS weight rows are read concurrently and widened to fp32 in
+// registers, and each loaded chunk is applied to up to GEMV_GROUP activation rows,
+// giving GEMV_ROWS * GEMV_GROUP independent accumulator chains to hide FMA latency.
+// Batches larger than the weight's gemv_max_batch go to the GEMM.
+constexpr size_t GEMV_GROUP = 4;
+constexpr size_t GEMV_ROWS = 4;
+
+// out[M, N] (leading dimension ldo) = x[M, K] * weight[N, K]^T in fp32, with x
+// already widened to fp32.
+template <size_t M, typename T>
+void gemv_(float *out, size_t ldo, const float *x, const DenseWeight<T> &weight, size_t K, size_t N) {
+    constexpr size_t W = Vec::width;
+    const size_t k_vec = K - K % W;
+    for (size_t o = 0; o < N; o += GEMV_ROWS) {
+        size_t rows = std::min(GEMV_ROWS, N - o);
+        // A ragged tail re-reads the last row instead of branching in the hot loop.
+        const T *w[GEMV_ROWS];
+        for (size_t r = 0; r < GEMV_ROWS; r++) {
+            w[r] = weight.w + (o + std::min(r, rows - 1)) * K;
+        }
+
+        Vec::reg acc[GEMV_ROWS][M];
+        for (size_t r = 0; r < GEMV_ROWS; r++) {
+            for (size_t b = 0; b < M; b++) {
+                acc[r][b] = Vec::zero();
+            }
+        }
+        for (size_t k = 0; k < k_vec; k += W) {
+            Vec::reg xv[M];
+            for (size_t b = 0; b < M; b++) {
+                xv[b] = Vec::load(x + b * K + k);
+            }
+            for (size_t r = 0; r < GEMV_ROWS; r++) {
+                Vec::reg wv = Vec::load(w[r] + k);
+                for (size_t b = 0; b < M; b++) {
+                    acc[r][b] = Vec::fmadd(wv, xv[b], acc[r][b]);
+                }
+            }
+        }
+
+        for (size_t r = 0; r < rows; r++) {
+            for (size_t b = 0; b < M; b++) {
+                float sum = Vec::sum(acc[r][b]);
+                for (size_t k = k_vec; k < K; k++) {
+                    sum += to_f32(w[r][k]) * x[b * K + k];
+                }
+                out[b * ldo + o + r] = sum;
+            }
+        }
+    }
+}
+
+// gemv_ for a pre-packed weight. Each panel is one sequential stream of K x NR
+// elements whose NR outputs accumulate lane-wise, so no horizontal sums or K tails
+// are needed.
+template <size_t M, typename T>
+void gemv_(float *out, size_t ldo, const float *x, const PackedWeight<T> &weight, size_t K, size_t N) {
+    constexpr size_t W = Vec::width;
+    constexpr size_t C = NR / W;
+    alignas(64) float tile[NR];
+    for (size_t n0 = 0; n0 < N; n0 += NR) {
+        const T *w = weight.w + n0 * K;
+        Vec::reg acc[M][C];
+        for (size_t b = 0; b < M; b++) {
+            for (size_t c = 0; c < C; c++) {
+                acc[b][c] = Vec::zero();
+            }
+        }
+        for (size_t k = 0; k < K; k++) {
+            Vec::reg xv[M];
+            for (size_t b = 0; b < M; b++) {
+                xv[b] = Vec::set1(x[b * K + k]);
+            }
+            for (size_t c = 0; c < C; c++) {
+                Vec::reg wv = Vec::load(w + c * W);
+                for (size_t b = 0; b < M; b++) {
+                    acc[b][c] = Vec::fmadd(wv, xv[b], acc[b][c]);
+                }
+            }
+            w += NR;
+        }
+
+        size_t nr = std::min(NR, N - n0);
+        for (size_t b = 0; b < M; b++) {
+            for (size_t c = 0; c < C; c++) {
+                Vec::store(tile + c * W, acc[b][c]);
+            }
+            std::copy(tile, tile + nr, out + b * ldo + n0);
+        }
+    }
+}
+
+// gemv_ for an int8 or fp8 weight. Each chunk is widened and multiplied by its
+// group's scale in registers, one extra multiply shared by all M activation rows, so
+// the kernel streams a quarter of the bytes of fp32 and half of those of bf16.
+template <size_t M, typename Q, typename TS>
+void gemv_(float *out, size_t ldo, const float *x, const ScaledWeight<Q, TS> &weight, size_t K, size_t N) {
+    constexpr size_t W = Vec::width;
+    const size_t group_size = weight.group_size;
+    const size_t groups = K / group_size;
+    const size_t g_vec = group_size - group_size % W;
+    for (size_t o = 0; o < N; o += GEMV_ROWS) {
+        size_t rows = std::min(GEMV_ROWS, N - o);
+        const Q *w[GEMV_ROWS];
+        const TS *s[GEMV_ROWS];
+        for (size_t r = 0; r < GEMV_ROWS; r++) {
+            size_t row = o + std::min(r, rows - 1);
+            w[r] = weight.q + row * K;
+            s[r] = weight.scales + row * weight.scale_stride;
+        }
+
+        Vec::reg acc[GEMV_ROWS][M];
+        float tail[GEMV_ROWS][M] = {};
+        for (size_t r = 0; r < GEMV_ROWS; r++) {
+            for (size_t b = 0; b < M; b++) {
+                acc[r][b] = Vec::zero();
+            }
+        }
+        for (size_t g = 0; g < groups; g++) {
+            const size_t k0 = g * group_size;
+            Vec::reg sv[GEMV_ROWS];
+            for (size_t r = 0; r < GEMV_ROWS; r++) {
+                sv[r] = Vec::set1(to_f32(s[r][g]));
+            }
+            for (size_t k = k0; k < k0 + g_vec; k += W) {
+                Vec::reg xv[M];
+                for (size_t b = 0; b < M; b++) {
+                    xv[b] = Vec::load(x + b * K + k);
+                }
+                for (size_t r = 0; r < GEMV_ROWS; r++) {
+                    Vec::reg wv = Vec::mul(Vec::load(w[r] + k), sv[r]);
+                    for (size_t b = 0; b < M; b++) {
+                        acc[r][b] = Vec::fmadd(wv, xv[b], acc[r][b]);
+                    }
+                }
+            }
+            // Groups that are not a whole number of vectors (e.g. per-channel scales
+            // over an odd K) finish in scalar code.
+            for (size_t r = 0; g_vec != group_size && r < rows; r++) {
+                for (size_t b = 0; b < M; b++) {
+                    float sum = 0.0f;
+                    for (size_t k = k0 + g_vec; k < k0 + group_size; k++) {
+                        sum += to_f32(w[r][k]) * x[b * K + k];
+                    }
+                    tail[r][b] += sum * to_f32(s[r][g]);
+                }
+            }
+        }
+
+        for (size_t r = 0; r < rows; r++) {
+            for (size_t b = 0; b < M; b++) {
+                out[b * ldo + o + r] = Vec::sum(acc[r][b]) + tail[r][b];
+            }
+        }
+    }
+}
+
+// gemv_ for a 4-bit weight. A block is unpacked to fp32 in registers and mapped to
+// (q - zero) * scale with a single FMA, then applied to every activation row.
+template <size_t M, typename TS>
+void gemv_(float *out, size_t ldo, const float *x, const Int4Weight<TS> &weight, size_t K, size_t N) {
+    constexpr size_t W = Vec::width;
+    constexpr size_t C = Q4_BLOCK / W;
+    const size_t group_size = weight.group_size;
+    const size_t groups = K / group_size;
+    for (size_t o = 0; o < N; o += GEMV_ROWS) {
+        size_t rows = std::min(GEMV_ROWS, N - o);
+        const uint8_t *w[GEMV_ROWS];
+        size_t g0[GEMV_ROWS];
+        for (size_t r = 0; r < GEMV_ROWS; r++) {
+            size_t row = o + std::min(r, rows - 1);
+            w[r] = weight.q + row * K / 2;
+            g0[r] = row * groups;
+        }
+
+        Vec::reg acc[GEMV_ROWS][M];
+        for (size_t r = 0; r < GEMV_ROWS; r++) {
+            for (size_t b = 0; b < M; b++) {
+                acc[r][b] = Vec::zero();
+            }
+        }
+        for (size_t g = 0; g < groups; g++) {
+            Vec::reg sv[GEMV_ROWS], zv[GEMV_ROWS];
+            for (size_t r = 0; r < GEMV_ROWS; r++) {
+                float scale = to_f32(weight.scales[g0[r] + g]);
+                float zero = weight.zeros ? static_cast<float>(weight.zeros[g0[r] + g]) : 8.0f;
+                sv[r] = Vec::set1(scale);
+                zv[r] = Vec::set1(-zero * scale);
+            }
+            for (size_t k = g * group_size; k < (g + 1) * group_size; k += Q4_BLOCK) {
+                for (size_t r = 0; r < GEMV_ROWS; r++) {
+                    Vec::reg wq[C];
+                    Vec::load_q4(w[r] + k / 2, wq);
+                    for (size_t c = 0; c < C; c++) {
+                        Vec::reg wv = Vec::fmadd(wq[c], sv[r], zv[r]);
+                        for (size_t b = 0; b < M; b++) {
+                            acc[r][b] = Vec::fmadd(wv, Vec::load(x + b * K + k + c * W), acc[r][b]);
+                        }
+                    }
+                }
+            }
+        }
+
+        for (size_t r = 0; r < rows; r++) {
+            for (size_t b = 0; b < M; b++) {
+                out[b * ldo + o + r] = Vec::sum(acc[r][b]);
+            }
+        }
+    }
+}
+
+template <typename T, typename Weight, typename Store>
+void linear_(const Store &store, const T *in, const Weight &weight,
+             size_t batch_size, size_t in_features, size_t out_features) {
+    const size_t M = batch_size, K = in_features, N = out_features;
+    if (M > Weight::gemv_max_batch) {
+        return gemm_(store, in, weight, M, K, N);
+    }
+
+    const float *x;
+    thread_local std::vector<float> x_f32;
+    if constexpr (std::is_same_v<T, float>) {
+        x = in;
+    } else {
+        x_f32.resize(M * K);
+        convert_row(x_f32.data(), in, M * K);
+        x = x_f32.data();
+    }
+    // Threads split the output columns, so each streams a disjoint part of the weight.
+    // Activation rows are consumed GEMV_GROUP at a time; beyond that the register
+    // file runs out and re-streaming the weight is still cheaper than packing it.
+    const size_t n_tiles = (N + GEMV_TILE_N - 1) / GEMV_TILE_N;
+    llaisys::core::threadPool().parallelFor(n_tiles, 1, [&](size_t begin, size_t end) {
+        const size_t j0 = begin * GEMV_TILE_N;
+        const size_t nb = std::min(end * GEMV_TILE_N, N) - j0;
+        const Weight w = weight.rows(j0);
+        thread_local std::vector<float> acc;
+        acc.resize(M * nb);
+        for (size_t b = 0; b < M; b += GEMV_GROUP) {
+            float *o = acc.data() + b * nb;
+            const float *xb = x + b * K;
+            switch (std::min(GEMV_GROUP, M - b)) {
+            case 1:
+                gemv_<1>(o, nb, xb, w, K, nb);
+                break;
+            case 2:
+                gemv_<2>(o, nb, xb, w, K, nb);
+                break;
+            case 3:
+                gemv_<3>(o, nb, xb, w, K, nb);
+                break;
+            default:
+                gemv_<4>(o, nb, xb, w, K, nb);
+                break;
+            }
+        }
+        for (size_t b = 0; b < M; b++) {
+            store(b, j0, acc.data() + b * nb, nb);
+        }
+    });
+}
+
+// Symmetric int8 or fp8 quantization: each group of group_size weights, or the whole
+// tensor if per_tensor, is scaled so that its largest magnitude maps to the largest
+// value of Q. Values are divided by the scale after it has been rounded to its storage
+// type, which is the scale the kernels multiply by.
+template <typename Q, typename T, typename TS>
+void quantize_scaled_(Q *q, TS *scales, const T *weight, size_t N, size_t K, size_t group_size, bool per_tensor) {
+    using llaisys::ops::quantization_scale;
+    using llaisys::ops::quantize_row;
+    auto &pool = llaisys::core::threadPool();
+    const size_t grain = std::max<size_t>(1, 16384 / K);
+    auto values = [](const T *w) { return [w](size_t k) { return to_f32(w[k]); }; };
+
+    if (per_tensor) {
+        std::vector<float> row_scales(N);
+        pool.parallelFor(N, grain, [&](size_t begin, size_t end) {
+            for (size_t n = begin; n < end; n++) {
+                row_scales[n] = quantization_scale<Q>(K, values(weight + n * K));
+            }
+        });
+        scales[0] = llaisys::utils::cast<TS>(N ? *std::max_element(row_scales.begin(), row_scales.end()) : 0.0f);
+        const float s = to_f32(scales[0]);
+        pool.parallelFor(N, grain, [&](size_t begin, size_t end) {
+            for (size_t n = begin; n < end; n++) {
+                quantize_row(q + n * K, K, s, values(weight + n * K));
+            }
+        });
+        return;
+    }
+
+    const size_t groups = K / group_size;
+    pool.parallelFor(N, grain, [&](size_t begin, size_t end) {
+        for (size_t n = begin; n < end; n++) {
+            for (size_t g = 0; g < groups; g++) {
+                const T *w = weight + n * K + g * group_size;
+                TS scale = llaisys::utils::cast<TS>(quantization_scale<Q>(group_size, values(w)));
+                scales[n * groups + g] = scale;
+                quantize_row(q + n * K + g * group_size, group_size, to_f32(scale), values(w));
+            }
+        }
+    });
+}
+
+// 4-bit group quantization. Without zero points the levels are symmetric around a
+// fixed zero of 8, with the largest magnitude mapped to 7. With zero points each
+// group spans [min, max] (widened to include 0) over all 16 levels.
+template <typename T, typename TS>
+void quantize_int4_(uint8_t *q, TS *scales, uint8_t *zeros, const T *weight, size_t N, size_t K, size_t group_size) {
+    const size_t groups = K / group_size;
+    llaisys::core::threadPool().parallelFor(N, std::max<size_t>(1, 16384 / K), [&](size_t begin, size_t end) {
+        for (size_t n = begin; n < end; n++) {
+            for (size_t g = 0; g < groups; g++) {
+                const T *w = weight + n * K + g * group_size;
+                uint8_t *qg = q + (n * K + g * group_size) / 2;
+                float lo = 0.0f, hi = 0.0f;
+                for (size_t k = 0; k < group_size; k++) {
+                    lo = std::min(lo, to_f32(w[k]));
+                    hi = std::max(hi, to_f32(w[k]));
+                }
+                TS scale = llaisys::utils::cast<TS>(zeros ? (hi - lo) / 15.0f : std::max(-lo, hi) / 7.0f);
+                scales[n * groups + g] = scale;
+                float s = to_f32(scale);
+                float inv = s > 0.0f ? 1.0f / s : 0.0f;
+                float zero = 8.0f;
+                if (zeros) {
+                    zero = std::clamp(std::nearbyint(-lo * inv), 0.0f, 15.0f);
+                    zeros[n * groups + g] = static_cast<uint8_t>(zero);
+                }
+                auto level = [&](size_t k) {
+                    return static_cast<uint8_t>(std::clamp(std::nearbyint(to_f32(w[k]) * inv) + zero, 0.0f, 15.0f));
+                };
+                for (size_t kb = 0; kb < group_size; kb += Q4_BLOCK) {
+                    for (size_t j = 0; j < Q4_BLOCK / 2; j++) {
+                        qg[kb / 2 + j] = static_cast<uint8_t>(level(kb + j) | level(kb + j + Q4_BLOCK / 2) << 4);
+                    }
+                }
+            }
+        }
+    });
+}
+
+// Calls f with a value of the C++ type that stores floating point dtype `type`.
+template <typename F>
+void dispatch_float_(llaisysDataType_t type, F &&f) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return f(float{});
+    case LLAISYS_DTYPE_BF16:
+        return f(llaisys::bf16_t{});
+    case LLAISYS_DTYPE_F16:
+        return f(llaisys::fp16_t{});
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+
+// Calls f with the kernels' view of `weight` for activations of type T.
+template <typename T, typename F>
+void dispatch_weight_(const llaisys::ops::cpu::LinearWeight &weight, llaisysDataType_t type, size_t in_features,
+                      F &&f) {
+    // Calls f with a weight of int8 or fp8 values Q.
+    auto scaled = [&](auto qv) {
+        using Q = decltype(qv);
+        dispatch_float_(weight.scale_type, [&](auto ts) {
+            using TS = decltype(ts);
+            size_t scale_stride = weight.per_tensor ? 0 : in_features / weight.group_size;
+            f(ScaledWeight<Q, TS>{reinterpret_cast<const Q *>(weight.data), reinterpret_cast<const TS *>(weight.scales),
+                                  scale_stride, in_features, weight.group_size});
+        });
+    };
+    switch (weight.type) {
+    case LLAISYS_DTYPE_I8:
+        return scaled(int8_t{});
+    case LLAISYS_DTYPE_F8:
+        return scaled(llaisys::f8e4m3_t{});
+    case LLAISYS_DTYPE_F8_E5M2:
+        return scaled(llaisys::f8e5m2_t{});
+    case LLAISYS_DTYPE_U8:
+        return dispatch_float_(weight.scale_type, [&](auto ts) {
+            using TS = decltype(ts);
+            f(Int4Weight<TS>{reinterpret_cast<const uint8_t *>(weight.data),
+                             reinterpret_cast<const TS *>(weight.scales),
+                             reinterpret_cast<const uint8_t *>(weight.zeros), in_features, weight.group_size});
+        });
+    default:
+        CHECK_SAME_DTYPE(weight.type, type);
+        if (weight.packed) {
+            return f(PackedWeight<T>{reinterpret_cast<const T *>(weight.data), in_features});
+        }
+        return f(DenseWeight<T>{reinterpret_cast<const T *>(weight.data), in_features});
+    }
+}
+} // namespace
+
+namespace llaisys::ops::cpu {
+void linear(const LinearOutput &out, const std::byte *in, const LinearWeight &weight, const LinearEpilogue &epilogue,
+            llaisysDataType_t type, size_t batch_size, size_t in_features, size_t out_features) {
+    dispatch_float_(type, [&](auto t) {
+        using T = decltype(t);
+        const Store<T> store{out, reinterpret_cast<const T *>(epilogue.bias),
+                             reinterpret_cast<const T *>(epilogue.residual), epilogue.activation, out_features};
+        dispatch_weight_<T>(weight, type, in_features, [&](const auto &w) {
+            linear_(store, reinterpret_cast<const T *>(in), w, batch_size, in_features, out_features);
+        });
+    });
+}
+
+void linear(std::byte *out, const std::byte *in, const std::byte *weight, const std::byte *bias,
+            llaisysDataType_t type, size_t batch_size, size_t in_features, size_t out_features, bool packed) {
+    LinearOutput output{{out}, {out_features}, 1};
+    LinearWeight w{weight, type, packed};
+    linear(output, in, w, LinearEpilogue{bias}, type, batch_size, in_features, out_features);
+}
+
+void linear_swiglu(std::byte *out, const std::byte *in, const LinearWeight &weight, const std::byte *bias,
+                   llaisysDataType_t type, size_t batch_size, size_t in_features, size_t intermediate_size) {
+    dispatch_float_(type, [&](auto t) {
+        using T = decltype(t);
+        const SwiGLUStore<T> store{reinterpret_cast<T *>(out), reinterpret_cast<const T *>(bias), intermediate_size};
+        dispatch_weight_<T>(weight, type, in_features, [&](const auto &w) {
+            linear_(store, reinterpret_cast<const T *>(in), w, batch_size, in_features, 2 * intermediate_size);
+        });
+    });
+}
+
+void linear_swiglu_interleave(std::byte *out, const std::byte *gate, const std::byte *up,
+                              size_t intermediate_size, size_t row_bytes) {
+    for (size_t r = 0; r < intermediate_size; r += LINEAR_SWIGLU_BLOCK) {
+        size_t bytes = std::min(LINEAR_SWIGLU_BLOCK, intermediate_size - r) * row_bytes;
+        std::memcpy(out, gate + r * row_bytes, bytes);
+        std::memcpy(out + bytes, up + r * row_bytes, bytes);
+        out += 2 * bytes;
+    }
+}
+
+void linear_quantize_scaled(std::byte *qweight, std::byte *scales, const std::byte *weight, llaisysDataType_t qtype,
+                            llaisysDataType_t type, llaisysDataType_t scale_type, size_t out_features,
+                            size_t in_features, size_t group_size, bool per_tensor) {
+    dispatch_float_(type, [&](auto t) {
+        using T = decltype(t);
+        dispatch_float_(scale_type, [&](auto ts) {
+            using TS = decltype(ts);
+            auto quantize = [&](auto qv) {
+                using Q = decltype(qv);
+                quantize_scaled_(reinterpret_cast<Q *>(qweight), reinterpret_cast<TS *>(scales),
+                                 reinterpret_cast<const T *>(weight), out_features, in_features, group_size,
+                                 per_tensor);
+            };
+            switch (qtype) {
+            case LLAISYS_DTYPE_I8:
+                return quantize(int8_t{});
+            case LLAISYS_DTYPE_F8:
+                return quantize(llaisys::f8e4m3_t{});
+            case LLAISYS_DTYPE_F8_E5M2:
+                return quantize(llaisys::f8e5m2_t{});
+            default:
+                EXCEPTION_UNSUPPORTED_DATATYPE(qtype);
+            }
+        });
+    });
+}
+
+void linear_quantize_int4(std::byte *qweight, std::byte *scales, std::byte *zeros, const std::byte *weight,
+                          llaisysDataType_t type, llaisysDataType_t scale_type,
+                          size_t out_features, size_t in_features, size_t group_size) {
+    dispatch_float_(type, [&](auto t) {
+        using T = decltype(t);
+        dispatch_float_(scale_type, [&](auto ts) {
+            using TS = decltype(ts);
+            quantize_int4_(reinterpret_cast<uint8_t *>(qweight), reinterpret_cast<TS *>(scales),
+                           reinterpret_cast<uint8_t *>(zeros), reinterpret_cast<const T *>(weight),
+                           out_features, in_features, group_size);
+        });
+    });
+}
+
+size_t linear_packed_numel(size_t out_features, size_t in_features) {
+    return (out_features + NR - 1) / NR * NR * in_features;
+}
+
+void linear_pack_weight(std::byte *packed, const std::byte *weight, llaisysDataType_t type,
+                        size_t out_features, size_t in_features) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return pack_b(reinterpret_cast<float *>(packed), reinterpret_cast<const float *>(weight),
+                      in_features, out_features, in_features);
+    case LLAISYS_DTYPE_BF16:
+        return pack_b(reinterpret_cast<llaisys::bf16_t *>(packed), reinterpret_cast<const llaisys::bf16_t *>(weight),
+                      in_features, out_features, in_features);
+    case LLAISYS_DTYPE_F16:
+        return pack_b(reinterpret_cast<llaisys::fp16_t *>(packed), reinterpret_cast<const llaisys::fp16_t *>(weight),
+                      in_features, out_features, in_features);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+} // namespace llaisys::ops::cpu
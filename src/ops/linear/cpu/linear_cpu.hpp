@@ -0,0 +1,89 @@
+#pragma once
+#include "llaisys.h"
+
+#include <cstddef>
+
+namespace llaisys::ops::cpu {
+// Weight operand of linear. A floating point weight of dtype `type` is a row-major
+// [out_features, in_features] matrix, or the output of linear_pack_weight if `packed`.
+// An I8, F8 or F8_E5M2 weight [out_features, in_features] carries one scale of
+// scale_type per group_size input features, i.e. scales[out_features, in_features /
+// group_size], or a single scale for the whole tensor if `per_tensor`.
+// A U8 weight [out_features, in_features / 2] holds 4-bit values in blocks of 32 values
+// in 16 bytes, byte j carrying value j in its low nibble and value j + 16 in its high
+// nibble. Each group of group_size values (a multiple of 32) has a scale and, if `zeros`
+// is not null, a uint8 zero point in [0, 15]; otherwise the zero point is 8.
+struct LinearWeight {
+    const std::byte *data;
+    llaisysDataType_t type;
+    bool packed = false;
+    const std::byte *scales = nullptr;
+    llaisysDataType_t scale_type = LLAISYS_DTYPE_INVALID;
+    const std::byte *zeros = nullptr;
+    size_t group_size = 0;
+    bool per_tensor = false;
+};
+
+// Destination of linear. The output columns are split in order over `parts` row-major
+// matrices data[p][batch_size, width[p]], whose widths sum to out_features. A fused
+// projection uses this to write e.g. Q, K and V directly into separate tensors.
+struct LinearOutput {
+    static constexpr size_t MAX_PARTS = 3;
+    std::byte *data[MAX_PARTS];
+    size_t width[MAX_PARTS];
+    size_t parts;
+};
+
+// Operations applied to the product before it is stored, all optional:
+// out = activation(product + bias[out_features]) + residual[batch_size, out_features].
+// The residual is row-major over all output columns and may alias a single output,
+// which then accumulates the result.
+struct LinearEpilogue {
+    const std::byte *bias = nullptr;
+    const std::byte *residual = nullptr;
+    llaisysActivation_t activation = LLAISYS_ACTIVATION_NONE;
+};
+
+// out[batch_size, out_features] = in[batch_size, in_features] * weight[out_features, in_features]^T,
+// followed by the epilogue. The activations, output, bias and residual have dtype `type`.
+void linear(const LinearOutput &out, const std::byte *in, const LinearWeight &weight, const LinearEpilogue &epilogue,
+            llaisysDataType_t type, size_t batch_size, size_t in_features, size_t out_features);
+
+// Same product plus bias into a single output with a floating point weight of dtype `type`.
+void linear(std::byte *out, const std::byte *in, const std::byte *weight, const std::byte *bias,
+            llaisysDataType_t type, size_t batch_size, size_t in_features, size_t out_features, bool packed = false);
+
+// Rows of the gate and up projections alternate in blocks of this size in the weight
+// of linear_swiglu. Twice the block divides the column runs of the kernels.
+constexpr size_t LINEAR_SWIGLU_BLOCK = 8;
+
+// out[batch_size, intermediate_size] = silu(in * gate^T) * (in * up^T), with the gate and
+// up projections (and their biases) interleaved by linear_swiglu_interleave into one
+// weight[2 * intermediate_size, in_features].
+void linear_swiglu(std::byte *out, const std::byte *in, const LinearWeight &weight, const std::byte *bias,
+                   llaisysDataType_t type, size_t batch_size, size_t in_features, size_t intermediate_size);
+
+// Interleave gate[intermediate_size, ...] and up[intermediate_size, ...], whose rows are
+// row_bytes long, into the layout read by linear_swiglu.
+void linear_swiglu_interleave(std::byte *out, const std::byte *gate, const std::byte *up,
+                              size_t intermediate_size, size_t row_bytes);
+
+// Quantize weight[out_features, in_features] into the I8, F8 or F8_E5M2 (qtype) weight and
+// scales of a LinearWeight.
+void linear_quantize_scaled(std::byte *qweight, std::byte *scales, const std::byte *weight, llaisysDataType_t qtype,
+                            llaisysDataType_t type, llaisysDataType_t scale_type, size_t out_features,
+                            size_t in_features, size_t group_size, bool per_tensor = false);
+
+// Quantize weight[out_features, in_features] into the operands of a 4-bit LinearWeight. Zero points
+// are computed only if `zeros` is not null.
+void linear_quantize_int4(std::byte *qweight, std::byte *scales, std::byte *zeros, const std::byte *weight,
+                          llaisysDataType_t type, llaisysDataType_t scale_type,
+                          size_t out_features, size_t in_features, size_t group_size);
+
+// Number of elements of a packed weight, including the zero padding of the last panel.
+size_t linear_packed_numel(size_t out_features, size_t in_features);
+
+// Rearrange a row-major weight[out_features, in_features] into the panel layout read by the GEMM kernel.
+void linear_pack_weight(std::byte *packed, const std::byte *weight, llaisysDataType_t type,
+                        size_t out_features, size_t in_features);
+}
@@ -4,52 +4,319 @@
 #include "../../core/llaisys_core.hpp"
 #include "../../utils.hpp"
 
-#include "linear_cpu.hpp"
+#include "cpu/linear_cpu.hpp"
 
 namespace llaisys::ops {
-void linear(tensor_t out, tensor_t in, tensor_t weight, tensor_t bias) {
-    CHECK_SAME_DEVICE(out, in, weight);
+namespace {
+bool is_float_dtype(llaisysDataType_t dtype) {
+    return dtype == LLAISYS_DTYPE_F32 || dtype == LLAISYS_DTYPE_F16 || dtype == LLAISYS_DTYPE_BF16;
+}
+
+bool is_quantized_dtype(llaisysDataType_t dtype) {
+    return dtype == LLAISYS_DTYPE_I8 || dtype == LLAISYS_DTYPE_U8 || dtype == LLAISYS_DTYPE_F8
+        || dtype == LLAISYS_DTYPE_F8_E5M2;
+}
+
+// Checks the shape of a weight for [out_features, in_features] and its quantization
+// operands, and returns the group size (0 for a floating point weight). An I8, F8 or
+// F8_E5M2 weight holds one value per element and a U8 weight two 4-bit values per
+// byte. Only the former may have a single per-tensor scale, reported in `per_tensor`.
+size_t check_weight(tensor_t weight, tensor_t scales, tensor_t zeros, size_t out_features, size_t in_features,
+                    bool &per_tensor) {
+    CHECK_ARGUMENT(weight->ndim() == 2, "Linear: weight must be 2-D");
+    CHECK_ARGUMENT(weight->shape()[0] == out_features, "Weight output features must match output features");
+    per_tensor = false;
+    if (!is_quantized_dtype(weight->dtype())) {
+        CHECK_ARGUMENT(weight->shape()[1] == in_features, "Weight input features must match input features");
+        CHECK_ARGUMENT(scales == nullptr && zeros == nullptr, "Linear: scales are only used with a quantized weight");
+        return 0;
+    }
+
+    bool int4 = weight->dtype() == LLAISYS_DTYPE_U8;
+    if (int4) {
+        CHECK_ARGUMENT(weight->shape()[1] * 2 == in_features,
+                       "Linear: a U8 weight holds 4-bit values two per byte and must be [out_features, in_features / 2]");
+    } else {
+        CHECK_ARGUMENT(weight->shape()[1] == in_features, "Weight input features must match input features");
+    }
+    CHECK_ARGUMENT(scales != nullptr, "Linear: a quantized weight needs scales");
+    CHECK_SAME_DEVICE(weight, scales);
+    CHECK_ARGUMENT(is_float_dtype(scales->dtype()), "Linear: scales must be F32, F16 or BF16");
+    if (!int4 && scales->ndim() == 1 && scales->shape()[0] == 1) {
+        CHECK_ARGUMENT(zeros == nullptr, "Linear: zero points are only used with a 4-bit weight");
+        ASSERT(weight->isContiguous(), "Linear: quantized weights must be contiguous");
+        per_tensor = true;
+        return in_features;
+    }
+    CHECK_ARGUMENT(scales->ndim() == 2 && scales->shape()[0] == out_features && scales->shape()[1] > 0,
+                   "Linear: scales must be [out_features, groups]");
+    CHECK_ARGUMENT(in_features >= scales->shape()[1] && in_features % scales->shape()[1] == 0,
+                   "Linear: groups must divide input features");
+    ASSERT(weight->isContiguous() && scales->isContiguous(), "Linear: quantized weights must be contiguous");
+    size_t group_size = in_features / scales->shape()[1];
+    if (int4) {
+        CHECK_ARGUMENT(group_size % 32 == 0, "Linear: 4-bit group size must be a multiple of 32");
+    }
+    if (zeros) {
+        CHECK_ARGUMENT(int4, "Linear: zero points are only used with a 4-bit weight");
+        CHECK_SAME_DEVICE(weight, zeros);
+        CHECK_SAME_SHAPE(zeros->shape(), scales->shape());
+        CHECK_ARGUMENT(zeros->dtype() == LLAISYS_DTYPE_U8, "Linear: zero points must be U8");
+        ASSERT(zeros->isContiguous(), "Linear: zero points must be contiguous");
+    }
+    return group_size;
+}
+
+// Checks an activation [batch_size, in_features] against its weight and bias for
+// out_features outputs of dtype `dtype`, and describes the weight to the cpu kernels.
+cpu::LinearWeight check_linear(tensor_t in, tensor_t weight, tensor_t bias, tensor_t scales, tensor_t zeros,
+                               llaisysDataType_t dtype, size_t out_features) {
+    CHECK_SAME_DEVICE(in, weight);
+    CHECK_ARGUMENT(in->ndim() == 2, "Linear: input must be 2-D");
+    size_t in_features = in->shape()[1];
+    bool per_tensor;
+    size_t group_size = check_weight(weight, scales, zeros, out_features, in_features, per_tensor);
+
     if (bias) {
-        CHECK_SAME_DEVICE(out, bias);
+        CHECK_SAME_DEVICE(in, bias);
+        CHECK_ARGUMENT(bias->ndim() == 1 && bias->shape()[0] == out_features, "Bias size must match output features");
+        CHECK_SAME_DTYPE(dtype, bias->dtype());
+        ASSERT(bias->isContiguous(), "Linear: bias must be contiguous");
+    }
+
+    if (group_size) {
+        CHECK_SAME_DTYPE(dtype, in->dtype());
+    } else {
+        CHECK_SAME_DTYPE(dtype, in->dtype(), weight->dtype());
+    }
+    bool packed = weight->layout() == TensorLayout::LINEAR_PACKED;
+    ASSERT(in->isContiguous() && (weight->isContiguous() || packed), "Linear: all tensors must be contiguous.");
+
+    cpu::LinearWeight w{weight->data(), weight->dtype(), packed};
+    if (group_size) {
+        w.scales = scales->data();
+        w.scale_type = scales->dtype();
+        w.zeros = zeros ? zeros->data() : nullptr;
+        w.group_size = group_size;
+        w.per_tensor = per_tensor;
+    }
+    return w;
+}
+
+// Runs linear_cpu for an output on the device of `out`.
+template <typename F>
+void dispatch_(tensor_t out, const F &linear_cpu) {
+    if (out->deviceType() == LLAISYS_DEVICE_CPU) {
+        return linear_cpu();
     }
+
+    llaisys::core::context().setDevice(out->deviceType(), out->deviceId());
+
+    switch (out->deviceType()) {
+    case LLAISYS_DEVICE_CPU:
+        return linear_cpu();
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
+} // namespace
+
+void linear(tensor_t out, tensor_t in, tensor_t weight, tensor_t bias, tensor_t scales, tensor_t zeros) {
+    CHECK_SAME_DEVICE(out, in);
     
     // Check shapes: out = [batch_size, out_features]
     // in = [batch_size, in_features]
     // weight = [out_features, in_features]
     // bias = [out_features] (optional)
+    CHECK_ARGUMENT(out->ndim() == 2, "Linear: output must be 2-D");
     size_t batch_size = out->shape()[0];
     size_t out_features = out->shape()[1];
-    size_t in_features = in->shape()[1];
-    
     CHECK_ARGUMENT(in->shape()[0] == batch_size, "Input batch size must match output batch size");
-    CHECK_ARGUMENT(weight->shape()[0] == out_features, "Weight output features must match output features");
-    CHECK_ARGUMENT(weight->shape()[1] == in_features, "Weight input features must match input features");
-    
-    if (bias) {
-        CHECK_ARGUMENT(bias->shape()[0] == out_features, "Bias size must match output features");
-        CHECK_SAME_DTYPE(out->dtype(), bias->dtype());
+    auto w = check_linear(in, weight, bias, scales, zeros, out->dtype(), out_features);
+    ASSERT(out->isContiguous(), "Linear: all tensors must be contiguous.");
+
+    cpu::LinearOutput output{{out->data()}, {out_features}, 1};
+    dispatch_(out, [&]() {
+        cpu::linear(output, in->data(), w, cpu::LinearEpilogue{bias ? bias->data() : nullptr}, out->dtype(),
+                    batch_size, in->shape()[1], out_features);
+    });
+}
+
+void linear_fused(tensor_t out, tensor_t in, tensor_t weight, tensor_t bias, tensor_t residual,
+                  llaisysActivation_t activation, tensor_t scales, tensor_t zeros) {
+    CHECK_SAME_DEVICE(out, in);
+    CHECK_ARGUMENT(out->ndim() == 2, "Linear: output must be 2-D");
+    size_t batch_size = out->shape()[0];
+    size_t out_features = out->shape()[1];
+    CHECK_ARGUMENT(in->shape()[0] == batch_size, "Input batch size must match output batch size");
+    auto w = check_linear(in, weight, bias, scales, zeros, out->dtype(), out_features);
+    ASSERT(out->isContiguous(), "Linear: all tensors must be contiguous.");
+    CHECK_ARGUMENT(activation == LLAISYS_ACTIVATION_NONE || activation == LLAISYS_ACTIVATION_RELU ||
+                       activation == LLAISYS_ACTIVATION_SILU || activation == LLAISYS_ACTIVATION_GELU,
+                   "Linear: unknown activation");
+    if (residual) {
+        CHECK_SAME_DEVICE(out, residual);
+        CHECK_SAME_SHAPE(out->shape(), residual->shape());
+        CHECK_SAME_DTYPE(out->dtype(), residual->dtype());
+        ASSERT(residual->isContiguous(), "Linear: residual must be contiguous");
+        CHECK_ARGUMENT(residual->data() != in->data(), "Linear: residual must not alias the input");
     }
-    
-    CHECK_SAME_DTYPE(out->dtype(), in->dtype(), weight->dtype());
-    ASSERT(out->isContiguous() && in->isContiguous() && weight->isContiguous(), 
-           "Linear: all tensors must be contiguous.");
-    if (bias) {
-        ASSERT(bias->isContiguous(), "Linear: bias must be contiguous");
+
+    cpu::LinearOutput output{{out->data()}, {out_features}, 1};
+    cpu::LinearEpilogue epilogue{bias ? bias->data() : nullptr, residual ? residual->data() : nullptr, activation};
+    dispatch_(out, [&]() {
+        cpu::linear(output, in->data(), w, epilogue, out->dtype(), batch_size, in->shape()[1], out_features);
+    });
+}
+
+void linear_qkv(tensor_t q, tensor_t k, tensor_t v, tensor_t in, tensor_t weight, tensor_t bias,
+                tensor_t scales, tensor_t zeros) {
+    CHECK_SAME_DEVICE(q, k, v, in);
+    CHECK_SAME_DTYPE(q->dtype(), k->dtype(), v->dtype());
+    CHECK_ARGUMENT(in->ndim() == 2, "Linear: input must be 2-D");
+    size_t batch_size = in->shape()[0];
+    cpu::LinearOutput output{{}, {}, 3};
+    tensor_t parts[] = {q, k, v};
+    size_t out_features = 0;
+    for (size_t p = 0; p < 3; p++) {
+        CHECK_ARGUMENT(parts[p]->ndim() >= 1 && parts[p]->shape()[0] == batch_size,
+                       "LinearQKV: outputs must lead with the batch dimension of the input");
+        ASSERT(parts[p]->isContiguous(), "LinearQKV: outputs must be contiguous.");
+        output.data[p] = parts[p]->data();
+        output.width[p] = batch_size ? parts[p]->numel() / batch_size : 0;
+        out_features += output.width[p];
     }
+    auto w = check_linear(in, weight, bias, scales, zeros, q->dtype(), out_features);
 
-    if (out->deviceType() == LLAISYS_DEVICE_CPU) {
-        return cpu::linear(out->data(), in->data(), weight->data(), 
-                          bias ? bias->data() : nullptr,
-                          out->dtype(), batch_size, in_features, out_features);
+    dispatch_(q, [&]() {
+        cpu::linear(output, in->data(), w, cpu::LinearEpilogue{bias ? bias->data() : nullptr}, q->dtype(),
+                    batch_size, in->shape()[1], out_features);
+    });
+}
+
+void linear_swiglu(tensor_t out, tensor_t in, tensor_t weight, tensor_t bias, tensor_t scales, tensor_t zeros) {
+    CHECK_SAME_DEVICE(out, in);
+    CHECK_ARGUMENT(out->ndim() == 2 && in->ndim() == 2, "LinearSwiGLU: input and output must be 2-D");
+    size_t batch_size = out->shape()[0];
+    size_t intermediate_size = out->shape()[1];
+    CHECK_ARGUMENT(in->shape()[0] == batch_size, "Input batch size must match output batch size");
+    auto w = check_linear(in, weight, bias, scales, zeros, out->dtype(), 2 * intermediate_size);
+    ASSERT(out->isContiguous(), "LinearSwiGLU: all tensors must be contiguous.");
+
+    dispatch_(out, [&]() {
+        cpu::linear_swiglu(out->data(), in->data(), w, bias ? bias->data() : nullptr, out->dtype(),
+                           batch_size, in->shape()[1], intermediate_size);
+    });
+}
+
+tensor_t linear_swiglu_interleave(tensor_t gate, tensor_t up) {
+    CHECK_SAME_DEVICE(gate, up);
+    CHECK_SAME_SHAPE(gate->shape(), up->shape());
+    CHECK_SAME_DTYPE(gate->dtype(), up->dtype());
+    CHECK_ARGUMENT(gate->ndim() >= 1, "LinearSwiGLU: gate and up must have a row dimension");
+    ASSERT(gate->isContiguous() && up->isContiguous(), "LinearSwiGLU: gate and up must be contiguous.");
+
+    size_t intermediate_size = gate->shape()[0];
+    auto shape = gate->shape();
+    shape[0] = 2 * intermediate_size;
+    auto out = Tensor::create(shape, gate->dtype(), gate->deviceType(), gate->deviceId());
+    size_t row_bytes = intermediate_size ? gate->numel() / intermediate_size * gate->elementSize() : 0;
+
+    switch (gate->deviceType()) {
+    case LLAISYS_DEVICE_CPU:
+        cpu::linear_swiglu_interleave(out->data(), gate->data(), up->data(), intermediate_size, row_bytes);
+        return out;
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return nullptr;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
+
+tensor_t linear_concat(const std::vector<tensor_t> &parts) {
+    CHECK_ARGUMENT(!parts.empty(), "LinearConcat: nothing to concatenate");
+    const tensor_t &first = parts[0];
+    size_t rows = 0;
+    for (const auto &part : parts) {
+        CHECK_SAME_DEVICE(first, part);
+        CHECK_SAME_DTYPE(first->dtype(), part->dtype());
+        CHECK_ARGUMENT(part->ndim() == first->ndim() && part->ndim() >= 1,
+                       "LinearConcat: parts must have the same number of dimensions");
+        for (size_t i = 1; i < part->ndim(); i++) {
+            CHECK_ARGUMENT(part->shape()[i] == first->shape()[i], "LinearConcat: parts differ beyond the first dimension");
+        }
+        ASSERT(part->isContiguous(), "LinearConcat: parts must be contiguous.");
+        rows += part->shape()[0];
     }
 
+    auto shape = first->shape();
+    shape[0] = rows;
+    auto out = Tensor::create(shape, first->dtype(), first->deviceType(), first->deviceId());
     llaisys::core::context().setDevice(out->deviceType(), out->deviceId());
+    std::byte *dst = out->data();
+    for (const auto &part : parts) {
+        size_t bytes = part->numel() * part->elementSize();
+        llaisys::core::context().runtime().api()->memcpy_sync(dst, part->data(), bytes, LLAISYS_MEMCPY_D2D);
+        dst += bytes;
+    }
+    return out;
+}
 
-    switch (out->deviceType()) {
+tensor_t linear_pack_weight(tensor_t weight) {
+    CHECK_ARGUMENT(weight->ndim() == 2, "Linear: weight must be 2-D");
+    ASSERT(weight->isContiguous(), "Linear: weight must be contiguous.");
+
+    size_t out_features = weight->shape()[0];
+    size_t in_features = weight->shape()[1];
+
+    switch (weight->deviceType()) {
+    case LLAISYS_DEVICE_CPU: {
+        auto packed = Tensor::createWithLayout(weight->shape(), weight->dtype(), TensorLayout::LINEAR_PACKED,
+                                               cpu::linear_packed_numel(out_features, in_features),
+                                               weight->deviceType(), weight->deviceId());
+        cpu::linear_pack_weight(packed->data(), weight->data(), weight->dtype(), out_features, in_features);
+        return packed;
+    }
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return nullptr;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
+
+void linear_quantize(tensor_t qweight, tensor_t scales, tensor_t weight, tensor_t zeros) {
+    CHECK_SAME_DEVICE(qweight, weight);
+    CHECK_ARGUMENT(weight->ndim() == 2, "Linear: weight must be 2-D");
+    CHECK_ARGUMENT(is_quantized_dtype(qweight->dtype()), "Linear: quantized weight must be I8, U8, F8 or F8_E5M2");
+    CHECK_ARGUMENT(is_float_dtype(weight->dtype()), "Linear: weight must be F32, F16 or BF16");
+    ASSERT(weight->isContiguous(), "Linear: weight must be contiguous.");
+
+    size_t out_features = weight->shape()[0];
+    size_t in_features = weight->shape()[1];
+    bool per_tensor;
+    size_t group_size = check_weight(qweight, scales, zeros, out_features, in_features, per_tensor);
+
+    switch (weight->deviceType()) {
     case LLAISYS_DEVICE_CPU:
-        return cpu::linear(out->data(), in->data(), weight->data(), 
-                          bias ? bias->data() : nullptr,
-                          out->dtype(), batch_size, in_features, out_features);
+        if (qweight->dtype() == LLAISYS_DTYPE_U8) {
+            return cpu::linear_quantize_int4(qweight->data(), scales->data(), zeros ? zeros->data() : nullptr,
+                                             weight->data(), weight->dtype(), scales->dtype(),
+                                             out_features, in_features, group_size);
+        }
+        return cpu::linear_quantize_scaled(qweight->data(), scales->data(), weight->data(), qweight->dtype(),
+                                           weight->dtype(), scales->dtype(), out_features, in_features, group_size,
+                                           per_tensor);
 #ifdef ENABLE_NVIDIA_API
     case LLAISYS_DEVICE_NVIDIA:
         TO_BE_IMPLEMENTED();
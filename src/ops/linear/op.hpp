@@ -3,5 +3,49 @@
 #include "../../tensor/tensor.hpp"
 
 namespace llaisys::ops {
-void linear(tensor_t out, tensor_t in, tensor_t weight, tensor_t bias);
+// out = in * weight^T + bias, with an optional bias. A quantized weight (see
+// linear_quantize) is dequantized with `scales`, one row of scales per output feature
+// and one column per group of input features, and for 4-bit weights optional `zeros`.
+void linear(tensor_t out, tensor_t in, tensor_t weight, tensor_t bias,
+            tensor_t scales = nullptr, tensor_t zeros = nullptr);
+// Linear with a fused epilogue: out = activation(in * weight^T + bias) + residual, where
+// bias and residual are optional. The residual has the shape of out and may be out
+// itself, adding the product into it (e.g. the residual connection after attn_o_w and
+// mlp_down_w). Each output element is written once, straight from the kernel.
+void linear_fused(tensor_t out, tensor_t in, tensor_t weight, tensor_t bias, tensor_t residual,
+                  llaisysActivation_t activation = LLAISYS_ACTIVATION_NONE,
+                  tensor_t scales = nullptr, tensor_t zeros = nullptr);
+// Fused Q, K and V projection: one linear over a weight (and bias) made of the three
+// projections stacked along the output features, e.g. by linear_concat at load time.
+// The input is read once and the output columns go straight into q, k and v, which
+// must be contiguous with the batch as their first dimension (e.g. [seqlen, nhead, d]
+// as consumed by rope and self_attention) and together cover the weight's rows.
+void linear_qkv(tensor_t q, tensor_t k, tensor_t v, tensor_t in, tensor_t weight, tensor_t bias,
+                tensor_t scales = nullptr, tensor_t zeros = nullptr);
+// Concatenate weights or biases along their first dimension, building the stacked
+// operands of the fused projections. Pack or quantize the result afterwards.
+tensor_t linear_concat(const std::vector<tensor_t> &parts);
+// Fused gate/up projection of a SwiGLU MLP: out = silu(in * gate^T) * (in * up^T), with
+// out [batch_size, intermediate_size]. The weight (and optional bias) is the output of
+// linear_swiglu_interleave, and may be packed or quantized like any linear weight.
+// The activation is applied to each output tile as it leaves the kernel, so the gate
+// and up intermediates are never written to memory.
+void linear_swiglu(tensor_t out, tensor_t in, tensor_t weight, tensor_t bias,
+                   tensor_t scales = nullptr, tensor_t zeros = nullptr);
+// Interleave the rows of gate and up weights (or biases) into the weight of linear_swiglu.
+tensor_t linear_swiglu_interleave(tensor_t gate, tensor_t up);
+// Repack a [out_features, in_features] weight into the layout consumed by the linear
+// kernel. Meant to be done once at model load; the result can only be passed to linear.
+tensor_t linear_pack_weight(tensor_t weight);
+// Quantize a [out_features, in_features] weight for linear. The group size is
+// in_features / scales->shape()[1], so a single scale column gives per-channel scales.
+// Scales may be stored in F32, F16 or BF16.
+//  - I8 qweight[out_features, in_features]: symmetric int8.
+//  - F8 (E4M3) or F8_E5M2 qweight[out_features, in_features]: fp8, each group scaled so
+//    that its largest magnitude maps to the largest finite fp8 value.
+//  For I8 and fp8 weights, scales of shape [1] give a single per-tensor scale.
+//  - U8 qweight[out_features, in_features / 2]: 4-bit values packed two per byte, with
+//    group sizes that are multiples of 32. Symmetric, or asymmetric when U8
+//    zeros[out_features, groups] are given.
+void linear_quantize(tensor_t qweight, tensor_t scales, tensor_t weight, tensor_t zeros = nullptr);
 }
@@ -0,0 +1,40 @@
+#pragma once
+#include "../utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+namespace llaisys::ops {
+// Scaled quantization shared by the weights of linear and the quantized KV caches: a
+// row is divided by a scale that maps its largest magnitude to the largest value of Q,
+// int8 (127), fp8 e4m3 (448) or fp8 e5m2 (57344). x(k) gives the k-th value as float.
+
+template <typename Q>
+constexpr float quantized_max = std::is_same_v<Q, int8_t> ? 127.0f : std::is_same_v<Q, f8e4m3_t> ? 448.0f : 57344.0f;
+
+template <typename Q, typename X>
+float quantization_scale(size_t n, X &&x) {
+    float amax = 0.0f;
+    for (size_t k = 0; k < n; k++) {
+        amax = std::max(amax, std::fabs(x(k)));
+    }
+    return amax / quantized_max<Q>;
+}
+
+// q[k] = x(k) / scale: int8 rounded to nearest and clamped to +-127, fp8 by its cast.
+// A scale rounded to its storage type should be passed after rounding, as the values
+// are then exactly those the kernels multiply back.
+template <typename Q, typename X>
+void quantize_row(Q *q, size_t n, float scale, X &&x) {
+    const float inv = scale > 0.0f ? 1.0f / scale : 0.0f;
+    for (size_t k = 0; k < n; k++) {
+        if constexpr (std::is_same_v<Q, int8_t>) {
+            q[k] = static_cast<int8_t>(std::clamp(std::nearbyint(x(k) * inv), -127.0f, 127.0f));
+        } else {
+            q[k] = utils::cast<Q>(x(k) * inv);
+        }
+    }
+}
+} // namespace llaisys::ops
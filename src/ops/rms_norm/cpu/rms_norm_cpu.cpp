@@ -0,0 +1,53 @@
+#include "rms_norm_cpu.hpp"
+
+#include "../../../core/thread_pool/thread_pool.hpp"
+#include "../../../utils.hpp"
+
+#include <cmath>
+
+namespace {
+// Rows are independent; batch enough of them per task to amortize dispatch.
+constexpr size_t GRAIN_ELEMENTS = 16384;
+
+template <typename T>
+void rms_norm_(T *out, const T *in, const T *weight, size_t rows, size_t cols, float eps) {
+    size_t grain = (GRAIN_ELEMENTS + cols - 1) / cols;
+    llaisys::core::threadPool().parallelFor(rows, grain, [=](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const T *row_in = in + i * cols;
+            T *row_out = out + i * cols;
+
+            double sum_sq = 0.0;
+            for (size_t j = 0; j < cols; j++) {
+                float val = llaisys::utils::cast<float>(row_in[j]);
+                sum_sq += val * val;
+            }
+            float scale = 1.0f / std::sqrt(static_cast<float>(sum_sq / cols) + eps);
+
+            for (size_t j = 0; j < cols; j++) {
+                float val = llaisys::utils::cast<float>(row_in[j]) * scale * llaisys::utils::cast<float>(weight[j]);
+                row_out[j] = llaisys::utils::cast<T>(val);
+            }
+        }
+    });
+}
+} // namespace
+
+namespace llaisys::ops::cpu {
+void rms_norm(std::byte *out, const std::byte *in, const std::byte *weight, llaisysDataType_t type,
+              size_t rows, size_t cols, float eps) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return rms_norm_(reinterpret_cast<float *>(out), reinterpret_cast<const float *>(in),
+                         reinterpret_cast<const float *>(weight), rows, cols, eps);
+    case LLAISYS_DTYPE_BF16:
+        return rms_norm_(reinterpret_cast<llaisys::bf16_t *>(out), reinterpret_cast<const llaisys::bf16_t *>(in),
+                         reinterpret_cast<const llaisys::bf16_t *>(weight), rows, cols, eps);
+    case LLAISYS_DTYPE_F16:
+        return rms_norm_(reinterpret_cast<llaisys::fp16_t *>(out), reinterpret_cast<const llaisys::fp16_t *>(in),
+                         reinterpret_cast<const llaisys::fp16_t *>(weight), rows, cols, eps);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+} // namespace llaisys::ops::cpu
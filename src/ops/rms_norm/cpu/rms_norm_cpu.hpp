@@ -0,0 +1,10 @@
+#pragma once
+#include "llaisys.h"
+
+#include <cstddef>
+
+namespace llaisys::ops::cpu {
+// Normalizes each of the `rows` rows of `cols` elements and scales by weight[cols].
+void rms_norm(std::byte *out, const std::byte *in, const std::byte *weight, llaisysDataType_t type,
+              size_t rows, size_t cols, float eps);
+}
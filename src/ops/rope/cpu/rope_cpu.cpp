@@ -0,0 +1,203 @@
+#include "rope_cpu.hpp"
+
+#include "../../../core/thread_pool/thread_pool.hpp"
+#include "../../../utils.hpp"
+#include "../../quantize.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace {
+constexpr size_t GRAIN_ELEMENTS = 16384;
+
+// theta^(2j / head_dim) for j < head_dim / 2, the divisors of the positions. Kept per
+// thread for the last head_dim and theta, which a model passes on every layer.
+const std::vector<double> &divisors(size_t head_dim, float theta) {
+    thread_local std::vector<double> div;
+    thread_local size_t div_dim = 0;
+    thread_local float div_theta = 0.0f;
+    if (head_dim != div_dim || theta != div_theta) {
+        div.resize(head_dim / 2);
+        for (size_t j = 0; j < div.size(); j++) {
+            div[j] = std::pow(static_cast<double>(theta), 2.0 * j / head_dim);
+        }
+        div_dim = head_dim;
+        div_theta = theta;
+    }
+    return div;
+}
+
+// Cosines then sines of the angles of a position. Angles are computed in double, so that
+// positions far beyond the context length of a streaming cache still rotate by the
+// right amount.
+void angles(float *cos_sin, int64_t pos, const double *div, size_t half_dim) {
+    for (size_t j = 0; j < half_dim; j++) {
+        double angle = static_cast<double>(pos) / div[j];
+        cos_sin[j] = static_cast<float>(std::cos(angle));
+        cos_sin[half_dim + j] = static_cast<float>(std::sin(angle));
+    }
+}
+
+// Rotate one head by the angles in cos_sin, calling put(j, value) for each element.
+template <typename T, typename F>
+void rotate(const T *in, const float *cos_sin, size_t half_dim, F &&put) {
+    const float *c = cos_sin;
+    const float *s = cos_sin + half_dim;
+    for (size_t j = 0; j < half_dim; j++) {
+        float a = llaisys::utils::cast<float>(in[j]);
+        float b = llaisys::utils::cast<float>(in[j + half_dim]);
+        put(j, a * c[j] - b * s[j]);
+        put(j + half_dim, b * c[j] + a * s[j]);
+    }
+}
+
+template <typename T>
+void rope_(T *out, const T *in, const int64_t *pos_ids, size_t seq_len, size_t n_heads, size_t head_dim, float theta) {
+    const size_t half_dim = head_dim / 2;
+    const size_t row_elements = n_heads * head_dim;
+    size_t grain = (GRAIN_ELEMENTS + row_elements - 1) / row_elements;
+    const auto &div = divisors(head_dim, theta);
+    const double *d = div.data();
+    llaisys::core::threadPool().parallelFor(seq_len, grain, [=](size_t begin, size_t end) {
+        // The angles only depend on the position, so they are shared by all heads.
+        thread_local std::vector<float> cos_sin;
+        cos_sin.resize(head_dim);
+        for (size_t s = begin; s < end; s++) {
+            angles(cos_sin.data(), pos_ids[s], d, half_dim);
+            for (size_t h = 0; h < n_heads; h++) {
+                T *head_out = out + (s * n_heads + h) * head_dim;
+                rotate(in + (s * n_heads + h) * head_dim, cos_sin.data(), half_dim,
+                       [&](size_t j, float x) { head_out[j] = llaisys::utils::cast<T>(x); });
+            }
+        }
+    });
+}
+
+// Store x[n] as a quantized row with its scale.
+template <typename Q>
+void quantize(Q *q, float *scale, const float *x, size_t n) {
+    auto values = [x](size_t i) { return x[i]; };
+    *scale = llaisys::ops::quantization_scale<Q>(n, values);
+    llaisys::ops::quantize_row(q, n, *scale, values);
+}
+
+// T is the dtype of the projections, C that of the caches: T, or a quantized type.
+template <typename T, typename C>
+void rope_paged_(T *q_out, C *k_cache, C *v_cache, float *k_scales, float *v_scales, const T *q, const T *k,
+                 const T *v, const int64_t *pos_ids, const int64_t *slots, const float *table, size_t n,
+                 size_t nhead, size_t nkvhead, size_t head_dim, size_t dv, size_t npos, float theta) {
+    constexpr bool quantized = !std::is_same_v<T, C>;
+    const size_t half_dim = head_dim / 2;
+    const size_t row_elements = (nhead + nkvhead) * head_dim + nkvhead * dv;
+    size_t grain = (GRAIN_ELEMENTS + row_elements - 1) / row_elements;
+    const auto &div = divisors(head_dim, theta);
+    const double *d = div.data();
+    llaisys::core::threadPool().parallelFor(n, grain, [=](size_t begin, size_t end) {
+        thread_local std::vector<float> cos_sin, buf;
+        cos_sin.resize(head_dim);
+        buf.resize(std::max(head_dim, dv));
+        for (size_t s = begin; s < end; s++) {
+            const int64_t pos = pos_ids[s];
+            const float *cs = cos_sin.data();
+            if (pos >= 0 && static_cast<size_t>(pos) < npos) {
+                cs = table + static_cast<size_t>(pos) * head_dim;
+            } else {
+                angles(cos_sin.data(), pos, d, half_dim);
+            }
+            for (size_t h = 0; h < nhead; h++) {
+                T *head_out = q_out + (s * nhead + h) * head_dim;
+                rotate(q + (s * nhead + h) * head_dim, cs, half_dim,
+                       [&](size_t j, float x) { head_out[j] = llaisys::utils::cast<T>(x); });
+            }
+            // Row r of the caches holds head r % nkvhead of slot r / nkvhead.
+            const size_t row = static_cast<size_t>(slots[s]) * nkvhead;
+            for (size_t h = 0; h < nkvhead; h++) {
+                const T *k_head = k + (s * nkvhead + h) * head_dim;
+                const T *v_head = v + (s * nkvhead + h) * dv;
+                C *k_dst = k_cache + (row + h) * head_dim;
+                C *v_dst = v_cache + (row + h) * dv;
+                if constexpr (quantized) {
+                    float *x = buf.data();
+                    rotate(k_head, cs, half_dim, [&](size_t j, float y) {
+                        x[j] = llaisys::utils::cast<float>(llaisys::utils::cast<T>(y));
+                    });
+                    quantize(k_dst, k_scales + row + h, x, head_dim);
+                    for (size_t j = 0; j < dv; j++) {
+                        x[j] = llaisys::utils::cast<float>(v_head[j]);
+                    }
+                    quantize(v_dst, v_scales + row + h, x, dv);
+                } else {
+                    rotate(k_head, cs, half_dim, [&](size_t j, float y) { k_dst[j] = llaisys::utils::cast<T>(y); });
+                    std::memcpy(v_dst, v_head, dv * sizeof(T));
+                }
+            }
+        }
+    });
+}
+
+// Calls f with a value of the C++ type of a projection dtype.
+template <typename F>
+void dispatch_(llaisysDataType_t type, F &&f) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return f(float{});
+    case LLAISYS_DTYPE_BF16:
+        return f(llaisys::bf16_t{});
+    case LLAISYS_DTYPE_F16:
+        return f(llaisys::fp16_t{});
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+} // namespace
+
+namespace llaisys::ops::cpu {
+void rope(std::byte *out, const std::byte *in, const std::byte *pos_ids, llaisysDataType_t type,
+          size_t seq_len, size_t n_heads, size_t head_dim, float theta) {
+    const int64_t *pos = reinterpret_cast<const int64_t *>(pos_ids);
+    dispatch_(type, [&](auto t) {
+        using T = decltype(t);
+        rope_(reinterpret_cast<T *>(out), reinterpret_cast<const T *>(in), pos, seq_len, n_heads, head_dim, theta);
+    });
+}
+
+void rope_table(float *table, size_t npos, size_t head_dim, float theta) {
+    const auto &div = divisors(head_dim, theta);
+    size_t grain = (GRAIN_ELEMENTS + head_dim - 1) / head_dim;
+    llaisys::core::threadPool().parallelFor(npos, grain, [&](size_t begin, size_t end) {
+        for (size_t p = begin; p < end; p++) {
+            angles(table + p * head_dim, static_cast<int64_t>(p), div.data(), head_dim / 2);
+        }
+    });
+}
+
+void rope_paged(std::byte *q_out, std::byte *k_cache, std::byte *v_cache, float *k_scales, float *v_scales,
+                const std::byte *q, const std::byte *k, const std::byte *v, const int64_t *pos_ids,
+                const int64_t *slots, const float *table, llaisysDataType_t type, llaisysDataType_t cache_type,
+                size_t n, size_t nhead, size_t nkvhead, size_t head_dim, size_t dv, size_t npos, float theta) {
+    dispatch_(type, [&](auto t) {
+        using T = decltype(t);
+        auto run = [&](auto c) {
+            using C = decltype(c);
+            rope_paged_(reinterpret_cast<T *>(q_out), reinterpret_cast<C *>(k_cache), reinterpret_cast<C *>(v_cache),
+                        k_scales, v_scales, reinterpret_cast<const T *>(q), reinterpret_cast<const T *>(k),
+                        reinterpret_cast<const T *>(v), pos_ids, slots, table, n, nhead, nkvhead, head_dim, dv, npos,
+                        theta);
+        };
+        switch (cache_type) {
+        case LLAISYS_DTYPE_I8:
+            return run(int8_t{});
+        case LLAISYS_DTYPE_F8:
+            return run(llaisys::f8e4m3_t{});
+        case LLAISYS_DTYPE_F8_E5M2:
+            return run(llaisys::f8e5m2_t{});
+        default:
+            CHECK_SAME_DTYPE(cache_type, type);
+            return run(T{});
+        }
+    });
+}
+} // namespace llaisys::ops::cpu
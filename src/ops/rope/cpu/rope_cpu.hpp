@@ -0,0 +1,22 @@
+#pragma once
+#include "llaisys.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace llaisys::ops::cpu {
+// Rotates in[seq_len, n_heads, head_dim] by the angles of the int64 positions pos_ids[seq_len].
+void rope(std::byte *out, const std::byte *in, const std::byte *pos_ids, llaisysDataType_t type,
+          size_t seq_len, size_t n_heads, size_t head_dim, float theta);
+
+// Cosines then sines of the angles of positions [0, npos), table[npos, head_dim].
+void rope_table(float *table, size_t npos, size_t head_dim, float theta);
+
+// Rotates q into q_out and k into row slots[i] of k_cache, and copies v into row slots[i]
+// of v_cache, quantizing them with a scale per head if cache_type is I8, F8 or F8_E5M2.
+// Positions below npos take their angles from table.
+void rope_paged(std::byte *q_out, std::byte *k_cache, std::byte *v_cache, float *k_scales, float *v_scales,
+                const std::byte *q, const std::byte *k, const std::byte *v, const int64_t *pos_ids,
+                const int64_t *slots, const float *table, llaisysDataType_t type, llaisysDataType_t cache_type,
+                size_t n, size_t nhead, size_t nkvhead, size_t head_dim, size_t dv, size_t npos, float theta);
+}
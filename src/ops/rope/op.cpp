@@ -1,56 +1,158 @@
 #include "op.hpp"
+
 #include "../../core/llaisys_core.hpp"
 #include "../../utils.hpp"
-#include "rope_cpu.hpp"
+
+#include "cpu/rope_cpu.hpp"
 
 namespace llaisys::ops {
 void rope(tensor_t out, tensor_t in, tensor_t pos_ids, float theta) {
-    
     CHECK_SAME_DEVICE(out, in, pos_ids);
-    
-
-    
-    ASSERT(out->dim() == 3, "Output tensor must be 3D");
-    ASSERT(in->dim() == 3, "Input tensor must be 3D");
-    ASSERT(pos_ids->dim() == 1, "Position IDs must be 1D");
-    
-    const auto& out_shape = out->shape();
-    const auto& in_shape = in->shape();
-    
-    ASSERT(out_shape == in_shape, "Output and input shapes must match");
-    ASSERT(out_shape[0] == pos_ids->shape()[0], "Sequence length must match position IDs length");
-    ASSERT(out_shape[2] % 2 == 0, "Head dimension must be even for RoPE");
-    
-    ASSERT(out->dtype() == in->dtype(), "Output and input dtypes must match");
-    ASSERT(pos_ids->dtype() == LLAISYS_DTYPE_I64, "Position IDs must be int64");
-    
+    CHECK_SAME_SHAPE(out->shape(), in->shape());
+    CHECK_SAME_DTYPE(out->dtype(), in->dtype());
+    CHECK_ARGUMENT(in->ndim() == 3, "RoPE: input must be 3D [seqlen, nhead, d]");
+    CHECK_ARGUMENT(pos_ids->ndim() == 1 && pos_ids->shape()[0] == in->shape()[0],
+                   "RoPE: pos_ids must be 1D with one position per sequence entry");
+    CHECK_ARGUMENT(pos_ids->dtype() == LLAISYS_DTYPE_I64, "RoPE: pos_ids must be int64");
+    CHECK_ARGUMENT(in->shape()[2] % 2 == 0, "RoPE: head dimension must be even");
     ASSERT(out->isContiguous() && in->isContiguous() && pos_ids->isContiguous(),
-           "RoPE: all tensors must be contiguous");
+           "RoPE: all tensors must be contiguous.");
 
-    const int64_t seq_len = out_shape[0];
-    const int64_t n_heads = out_shape[1];
-    const int64_t head_dim = out_shape[2];
+    size_t seq_len = in->shape()[0];
+    size_t n_heads = in->shape()[1];
+    size_t head_dim = in->shape()[2];
 
     if (out->deviceType() == LLAISYS_DEVICE_CPU) {
-        return cpu::rope(out->data(), in->data(), 
-                        static_cast<const int64_t*>(pos_ids->data()),
-                        theta, out->dtype(), seq_len, n_heads, head_dim);
+        return cpu::rope(out->data(), in->data(), pos_ids->data(), out->dtype(), seq_len, n_heads, head_dim, theta);
     }
 
     llaisys::core::context().setDevice(out->deviceType(), out->deviceId());
 
     switch (out->deviceType()) {
-        case LLAISYS_DEVICE_CPU:
-            return cpu::rope(out->data(), in->data(), 
-                            static_cast<const int64_t*>(pos_ids->data()),
-                            theta, out->dtype(), seq_len, n_heads, head_dim);
+    case LLAISYS_DEVICE_CPU:
+        return cpu::rope(out->data(), in->data(), pos_ids->data(), out->dtype(), seq_len, n_heads, head_dim, theta);
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
+
+void rope_table(tensor_t table, float theta) {
+    CHECK_ARGUMENT(table->ndim() == 2 && table->shape()[1] % 2 == 0,
+                   "RoPETable: table must be 2D [npos, d] with an even d");
+    CHECK_ARGUMENT(table->dtype() == LLAISYS_DTYPE_F32, "RoPETable: table must be F32");
+    ASSERT(table->isContiguous(), "RoPETable: table must be contiguous.");
+
+    if (table->deviceType() == LLAISYS_DEVICE_CPU) {
+        return cpu::rope_table(reinterpret_cast<float *>(table->data()), table->shape()[0], table->shape()[1], theta);
+    }
+
+    llaisys::core::context().setDevice(table->deviceType(), table->deviceId());
+
+    switch (table->deviceType()) {
+    case LLAISYS_DEVICE_CPU:
+        return cpu::rope_table(reinterpret_cast<float *>(table->data()), table->shape()[0], table->shape()[1], theta);
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
+
+void rope_paged(tensor_t q_out, tensor_t k_cache, tensor_t v_cache, tensor_t q, tensor_t k, tensor_t v,
+                tensor_t pos_ids, tensor_t slots, tensor_t table, float theta, tensor_t k_scales,
+                tensor_t v_scales) {
+    CHECK_SAME_DEVICE(q_out, k_cache, v_cache, q, k, v, pos_ids, slots, table);
+    CHECK_SAME_DTYPE(q_out->dtype(), q->dtype(), k->dtype(), v->dtype());
+    CHECK_SAME_DTYPE(k_cache->dtype(), v_cache->dtype());
+    CHECK_SAME_SHAPE(q_out->shape(), q->shape());
+    const bool quantized = k_cache->dtype() == LLAISYS_DTYPE_I8 || k_cache->dtype() == LLAISYS_DTYPE_F8
+                        || k_cache->dtype() == LLAISYS_DTYPE_F8_E5M2;
+    if (!quantized) {
+        CHECK_SAME_DTYPE(k->dtype(), k_cache->dtype());
+    }
+    CHECK_ARGUMENT(quantized == (k_scales != nullptr) && quantized == (v_scales != nullptr),
+                   "RoPEPaged: scales are given exactly for an I8, F8 or F8_E5M2 cache");
+    CHECK_ARGUMENT(pos_ids->dtype() == LLAISYS_DTYPE_I64 && slots->dtype() == LLAISYS_DTYPE_I64,
+                   "RoPEPaged: pos_ids and slots must be int64");
+    CHECK_ARGUMENT(table->dtype() == LLAISYS_DTYPE_F32, "RoPEPaged: table must be F32");
+    CHECK_ARGUMENT(q->ndim() == 3 && k->ndim() == 3 && v->ndim() == 3 && k_cache->ndim() == 4 && v_cache->ndim() == 4
+                       && pos_ids->ndim() == 1 && slots->ndim() == 1 && table->ndim() == 2,
+                   "RoPEPaged: expected q [n, nhead, d], k [n, nkvhead, d], v [n, nkvhead, dv], "
+                   "k_cache [nblocks, block_size, nkvhead, d], v_cache [nblocks, block_size, nkvhead, dv], "
+                   "pos_ids [n], slots [n] and table [npos, d]");
+
+    size_t n = q->shape()[0];
+    size_t nhead = q->shape()[1];
+    size_t d = q->shape()[2];
+    size_t nkvhead = k->shape()[1];
+    size_t dv = v->shape()[2];
+    size_t nblocks = k_cache->shape()[0];
+    size_t block_size = k_cache->shape()[1];
+    size_t npos = table->shape()[0];
+
+    CHECK_ARGUMENT(d % 2 == 0, "RoPEPaged: head dimension must be even");
+    CHECK_ARGUMENT(k->shape()[0] == n && v->shape()[0] == n && pos_ids->shape()[0] == n && slots->shape()[0] == n,
+                   "RoPEPaged: expected a query, key, value, position and slot per row");
+    CHECK_ARGUMENT(k->shape()[2] == d && table->shape()[1] == d, "RoPEPaged: query, key and table dims must match");
+    CHECK_ARGUMENT(v->shape()[1] == nkvhead, "RoPEPaged: key and value shapes must match");
+    CHECK_ARGUMENT(k_cache->shape()[2] == nkvhead && k_cache->shape()[3] == d && v_cache->shape()[0] == nblocks
+                       && v_cache->shape()[1] == block_size && v_cache->shape()[2] == nkvhead
+                       && v_cache->shape()[3] == dv,
+                   "RoPEPaged: caches must be [nblocks, block_size, nkvhead, d] like the keys and values");
+    ASSERT(q_out->isContiguous() && k_cache->isContiguous() && v_cache->isContiguous() && q->isContiguous()
+               && k->isContiguous() && v->isContiguous() && pos_ids->isContiguous() && slots->isContiguous()
+               && table->isContiguous(),
+           "RoPEPaged: all tensors must be contiguous.");
+    if (quantized) {
+        CHECK_SAME_DEVICE(k_cache, k_scales, v_scales);
+        CHECK_ARGUMENT(k_scales->dtype() == LLAISYS_DTYPE_F32 && v_scales->dtype() == LLAISYS_DTYPE_F32,
+                       "RoPEPaged: scales must be F32");
+        CHECK_SAME_SHAPE(k_scales->shape(), v_scales->shape());
+        CHECK_ARGUMENT(k_scales->ndim() == 3 && k_scales->shape()[0] == nblocks
+                           && k_scales->shape()[1] == block_size && k_scales->shape()[2] == nkvhead,
+                       "RoPEPaged: scales must be [nblocks, block_size, nkvhead]");
+        ASSERT(k_scales->isContiguous() && v_scales->isContiguous(), "RoPEPaged: scales must be contiguous.");
+    }
+
+    auto rope_paged_cpu = [&]() {
+        // Slots are read on the host; one past the pool would write out of bounds.
+        const auto *slot = reinterpret_cast<const int64_t *>(slots->data());
+        for (size_t i = 0; i < n; i++) {
+            CHECK_ARGUMENT(slot[i] >= 0 && static_cast<size_t>(slot[i]) < nblocks * block_size,
+                           "RoPEPaged: slot out of range");
+        }
+        return cpu::rope_paged(q_out->data(), k_cache->data(), v_cache->data(),
+                               quantized ? reinterpret_cast<float *>(k_scales->data()) : nullptr,
+                               quantized ? reinterpret_cast<float *>(v_scales->data()) : nullptr, q->data(), k->data(),
+                               v->data(), reinterpret_cast<const int64_t *>(pos_ids->data()), slot,
+                               reinterpret_cast<const float *>(table->data()), q->dtype(), k_cache->dtype(), n, nhead,
+                               nkvhead, d, dv, npos, theta);
+    };
+
+    if (q_out->deviceType() == LLAISYS_DEVICE_CPU) {
+        return rope_paged_cpu();
+    }
+
+    llaisys::core::context().setDevice(q_out->deviceType(), q_out->deviceId());
+
+    switch (q_out->deviceType()) {
+    case LLAISYS_DEVICE_CPU:
+        return rope_paged_cpu();
 #ifdef ENABLE_NVIDIA_API
-        case LLAISYS_DEVICE_NVIDIA:
-            TO_BE_IMPLEMENTED();
-            return;
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return;
 #endif
-        default:
-            EXCEPTION_UNSUPPORTED_DEVICE;
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
     }
 }
 } // namespace llaisys::ops
@@ -4,4 +4,18 @@
 
 namespace llaisys::ops {
 void rope(tensor_t out, tensor_t in, tensor_t pos_ids, float theta);
+// Fill table[npos, d] (F32) with the rotation of every position p < npos: the cosines
+// of the angles p / theta^(2j / d), j < d / 2, followed by their sines.
+void rope_table(tensor_t table, float theta);
+// RoPE on the fresh projections of a step, stored where attention reads them: q[n, nhead,
+// d] is rotated into q_out (which may be q), k[n, nkvhead, d] rotated and v[n, nkvhead,
+// dv] copied into row slots[i] (I64) of the paged caches k_cache[nblocks, block_size,
+// nkvhead, d] and v_cache, i.e. block slots[i] / block_size. The angles of position
+// pos_ids[i] (I64) come from a rope_table of `table`'s theta, or are computed for
+// positions past its end. A cache quantized to I8, F8 or F8_E5M2 takes F32 k_scales and
+// v_scales[nblocks, block_size, nkvhead] and is quantized per head of each position, the
+// rotated keys rounded to the dtype of k first, as ops::linear_quantize would.
+void rope_paged(tensor_t q_out, tensor_t k_cache, tensor_t v_cache, tensor_t q, tensor_t k, tensor_t v,
+                tensor_t pos_ids, tensor_t slots, tensor_t table, float theta, tensor_t k_scales = nullptr,
+                tensor_t v_scales = nullptr);
 }
@@ -0,0 +1,177 @@
+#include "sample_cpu.hpp"
+
+#include "../../../core/thread_pool/thread_pool.hpp"
+#include "../../../utils.hpp"
+#include "../../cast/cpu/cast_cpu.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace {
+// Scaled logits s = (logit - max) / temperature <= 0 are binned by -s, NBINS bins of
+// RANGE / NBINS each; the last bin also holds every s below -RANGE, whose probability
+// relative to the most likely token is under e^-RANGE.
+constexpr size_t NBINS = 2048;
+constexpr float RANGE = 32.0f;
+// Logits per task of the probability mass.
+constexpr size_t CHUNK = 4096;
+
+// Uniform double in [0, 1) from the splitmix64 finalizer of seed.
+double uniform(uint64_t seed) {
+    uint64_t z = seed + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    return static_cast<double>(z >> 11) * 0x1.0p-53;
+}
+
+// The most likely token is found first, then, unless top_k bounds the tokens kept,
+// the mass of exp(s) over the vocabulary in parallel chunks, summed in order so that
+// the draw does not depend on the thread count. Without truncation, the token is
+// drawn by the cumulative mass in index order, scanning only the chunk it falls in.
+// Otherwise a histogram counting the scaled logits per bin bounds the tokens kept:
+// the first bins holding top_k tokens or, without top_k, at least top_p of the mass,
+// taking e^-(b+1)RANGE/NBINS as the least probability in bin b. Only the tokens of
+// those bins are gathered and ordered, and both cutoffs applied to them exactly, so
+// no sorted copy of the vocabulary is made.
+int64_t sample_(const float *logits, size_t voc, float temperature, size_t top_k, float top_p, uint64_t seed) {
+    float max = logits[0];
+    size_t arg = 0;
+    for (size_t i = 1; i < voc; i++) {
+        const float l = logits[i];
+        if (l > max) {
+            max = l;
+            arg = i;
+        }
+    }
+    if (temperature == 0.0f || top_k == 1 || !(max > -std::numeric_limits<float>::infinity())) {
+        return static_cast<int64_t>(arg);
+    }
+    const float inv_t = 1.0f / temperature;
+    const size_t k = top_k == 0 ? voc : std::min(top_k, voc);
+    const double u = uniform(seed);
+    auto prob = [=](size_t i) { return std::exp((logits[i] - max) * inv_t); };
+
+    double z = 0.0;
+    const size_t nchunks = (voc + CHUNK - 1) / CHUNK;
+    thread_local std::vector<double> chunk_mass;
+    if (k == voc) {
+        chunk_mass.assign(nchunks, 0.0);
+        double *mass = chunk_mass.data();
+        llaisys::core::threadPool().parallelFor(nchunks, 1, [=](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; c++) {
+                double m = 0.0;
+                for (size_t i = c * CHUNK; i < std::min(voc, (c + 1) * CHUNK); i++) {
+                    m += prob(i);
+                }
+                mass[c] = m;
+            }
+        });
+        for (size_t c = 0; c < nchunks; c++) {
+            z += chunk_mass[c];
+        }
+    }
+    if (k == voc && top_p >= 1.0f) {
+        double target = u * z;
+        size_t c = 0;
+        while (c + 1 < nchunks && target >= chunk_mass[c]) {
+            target -= chunk_mass[c++];
+        }
+        double acc = 0.0;
+        for (size_t i = c * CHUNK; i < std::min(voc, (c + 1) * CHUNK); i++) {
+            const float p = prob(i);
+            acc += p;
+            if (acc > target) {
+                return static_cast<int64_t>(i);
+            }
+            if (p > 0.0f) {
+                arg = i;
+            }
+        }
+        return static_cast<int64_t>(arg);
+    }
+
+    const float to_bin = NBINS / RANGE;
+    auto bin = [=](float s) {
+        // -inf and NaN land in the last bin.
+        const float b = -s * to_bin;
+        return b < static_cast<float>(NBINS) ? static_cast<size_t>(b) : NBINS - 1;
+    };
+    size_t count[NBINS] = {};
+    for (size_t i = 0; i < voc; i++) {
+        count[bin((logits[i] - max) * inv_t)]++;
+    }
+    size_t last = 0;
+    {
+        size_t n = 0;
+        double m = 0.0;
+        const double nucleus = top_p * z;
+        for (; last < NBINS - 1; last++) {
+            n += count[last];
+            m += count[last] * std::exp(-(last + 1.0) / to_bin);
+            if (k < voc ? n >= k : m >= nucleus) {
+                break;
+            }
+        }
+    }
+
+    struct Candidate {
+        float s;
+        int64_t id;
+    };
+    thread_local std::vector<Candidate> candidates;
+    candidates.clear();
+    for (size_t i = 0; i < voc; i++) {
+        const float s = (logits[i] - max) * inv_t;
+        if (bin(s) <= last) {
+            candidates.push_back({s, static_cast<int64_t>(i)});
+        }
+    }
+    const size_t kept = std::min(k, candidates.size());
+    auto more_likely = [](const Candidate &a, const Candidate &b) { return a.s > b.s || (a.s == b.s && a.id < b.id); };
+    std::partial_sort(candidates.begin(), candidates.begin() + kept, candidates.end(), more_likely);
+
+    // Mass of the top_k tokens, all gathered; without top_k, of the whole vocabulary.
+    double z_k = 0.0;
+    for (size_t i = 0; i < kept && k < voc; i++) {
+        z_k += std::exp(candidates[i].s);
+    }
+    size_t n = 0;
+    double acc = 0.0;
+    const double nucleus = top_p * (k < voc ? z_k : z);
+    while (n < kept && acc < nucleus) {
+        acc += std::exp(candidates[n++].s);
+    }
+    const double target = u * acc;
+    acc = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        acc += std::exp(candidates[i].s);
+        if (acc > target) {
+            return candidates[i].id;
+        }
+    }
+    return candidates[n - 1].id;
+}
+} // namespace
+
+namespace llaisys::ops::cpu {
+int64_t sample(const std::byte *logits, llaisysDataType_t type, size_t voc, float temperature, size_t top_k,
+               float top_p, uint64_t seed) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return sample_(reinterpret_cast<const float *>(logits), voc, temperature, top_k, top_p, seed);
+    case LLAISYS_DTYPE_BF16:
+    case LLAISYS_DTYPE_F16: {
+        // Widened once, so that every pass reads fp32.
+        thread_local std::vector<float> widened;
+        widened.resize(voc);
+        cast(reinterpret_cast<std::byte *>(widened.data()), logits, LLAISYS_DTYPE_F32, type, voc);
+        return sample_(widened.data(), voc, temperature, top_k, top_p, seed);
+    }
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+} // namespace llaisys::ops::cpu
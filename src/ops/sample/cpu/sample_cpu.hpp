@@ -0,0 +1,11 @@
+#pragma once
+#include "llaisys.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace llaisys::ops::cpu {
+// Token drawn from logits[voc], see ops::sample.
+int64_t sample(const std::byte *logits, llaisysDataType_t type, size_t voc, float temperature, size_t top_k,
+               float top_p, uint64_t seed);
+}
@@ -0,0 +1,42 @@
+#include "op.hpp"
+
+#include "../../core/llaisys_core.hpp"
+#include "../../utils.hpp"
+
+#include "cpu/sample_cpu.hpp"
+
+#include <cmath>
+
+namespace llaisys::ops {
+void sample(tensor_t out_idx, tensor_t logits, float temperature, size_t top_k, float top_p, uint64_t seed) {
+    CHECK_SAME_DEVICE(out_idx, logits);
+    CHECK_ARGUMENT(out_idx->dtype() == LLAISYS_DTYPE_I64 && out_idx->numel() == 1,
+                   "Sample: out_idx must be a single int64");
+    CHECK_ARGUMENT(logits->ndim() == 1 && logits->numel() > 0, "Sample: logits must be a non-empty 1D tensor");
+    CHECK_ARGUMENT(std::isfinite(temperature) && temperature >= 0.0f, "Sample: temperature must be non-negative");
+    CHECK_ARGUMENT(top_p > 0.0f && top_p <= 1.0f, "Sample: top_p must be in (0, 1]");
+    ASSERT(out_idx->isContiguous() && logits->isContiguous(), "Sample: all tensors must be contiguous.");
+
+    if (logits->deviceType() == LLAISYS_DEVICE_CPU) {
+        *reinterpret_cast<int64_t *>(out_idx->data()) = cpu::sample(
+            logits->data(), logits->dtype(), logits->numel(), temperature, top_k, top_p, seed);
+        return;
+    }
+
+    llaisys::core::context().setDevice(logits->deviceType(), logits->deviceId());
+
+    switch (logits->deviceType()) {
+    case LLAISYS_DEVICE_CPU:
+        *reinterpret_cast<int64_t *>(out_idx->data()) = cpu::sample(
+            logits->data(), logits->dtype(), logits->numel(), temperature, top_k, top_p, seed);
+        return;
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
+} // namespace llaisys::ops
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "../../tensor/tensor.hpp"
+
+#include <cstdint>
+
+namespace llaisys::ops {
+// Draw a token id into out_idx [1] from the softmax of logits [voc] / temperature,
+// restricted to the top_k most likely tokens (all if 0) and, among those, to the
+// fewest most likely ones whose probability reaches top_p. The draw only depends on
+// `seed`. A temperature of 0 or a top_k of 1 picks the most likely token, the first
+// one among ties, like argmax.
+void sample(tensor_t out_idx, tensor_t logits, float temperature, size_t top_k, float top_p, uint64_t seed);
+}
@@ -0,0 +1,379 @@
+// Intrinsics must come before llaisys.h (see linear_cpu.cpp).
+#if defined(__AVX2__) || defined(__AVX512F__)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#else
+#include <immintrin.h>
+#endif
+#endif
+
+#include "self_attention_cpu.hpp"
+
+#include "../../../core/thread_pool/thread_pool.hpp"
+#include "../../../utils.hpp"
+#include "../../cast/cpu/cast_cpu.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace {
+// Query positions sharing each pass over the keys, and keys per block. A block of
+// keys and values in fp32 (2 * KV_BLOCK * d floats) stays in L1/L2 while every query
+// row of the tile, i.e. every head of the group at each position, is scored against it.
+constexpr size_t Q_BLOCK = 32;
+constexpr size_t KV_BLOCK = 64;
+
+// scores[4, KV_BLOCK] = q_rows[4, d] * k_t[d, KV_BLOCK], the four rows sharing each
+// load of k_t while their sums stay in registers.
+inline void score_rows(float *scores, const float *q_rows, const float *k_t, size_t d) {
+#if defined(__AVX512F__)
+    static_assert(KV_BLOCK == 64, "four vectors of keys per row");
+    __m512 c[4][4];
+    for (size_t x = 0; x < 4; x++) {
+        for (size_t j = 0; j < 4; j++) {
+            c[x][j] = _mm512_setzero_ps();
+        }
+    }
+    for (size_t i = 0; i < d; i++) {
+        const float *k_row = k_t + i * KV_BLOCK;
+        __m512 k[4];
+        for (size_t j = 0; j < 4; j++) {
+            k[j] = _mm512_loadu_ps(k_row + 16 * j);
+        }
+        for (size_t x = 0; x < 4; x++) {
+            __m512 a = _mm512_set1_ps(q_rows[x * d + i]);
+            for (size_t j = 0; j < 4; j++) {
+                c[x][j] = _mm512_fmadd_ps(a, k[j], c[x][j]);
+            }
+        }
+    }
+    for (size_t x = 0; x < 4; x++) {
+        for (size_t j = 0; j < 4; j++) {
+            _mm512_storeu_ps(scores + x * KV_BLOCK + 16 * j, c[x][j]);
+        }
+    }
+#elif defined(__AVX2__) && defined(__FMA__)
+    // Sixteen keys per pass, as four rows of all keys would not fit in the registers.
+    for (size_t t = 0; t < KV_BLOCK; t += 16) {
+        __m256 c[4][2];
+        for (size_t x = 0; x < 4; x++) {
+            c[x][0] = _mm256_setzero_ps();
+            c[x][1] = _mm256_setzero_ps();
+        }
+        for (size_t i = 0; i < d; i++) {
+            const float *k_row = k_t + i * KV_BLOCK + t;
+            __m256 k0 = _mm256_loadu_ps(k_row), k1 = _mm256_loadu_ps(k_row + 8);
+            for (size_t x = 0; x < 4; x++) {
+                __m256 a = _mm256_set1_ps(q_rows[x * d + i]);
+                c[x][0] = _mm256_fmadd_ps(a, k0, c[x][0]);
+                c[x][1] = _mm256_fmadd_ps(a, k1, c[x][1]);
+            }
+        }
+        for (size_t x = 0; x < 4; x++) {
+            _mm256_storeu_ps(scores + x * KV_BLOCK + t, c[x][0]);
+            _mm256_storeu_ps(scores + x * KV_BLOCK + t + 8, c[x][1]);
+        }
+    }
+#else
+    std::fill(scores, scores + 4 * KV_BLOCK, 0.0f);
+    for (size_t i = 0; i < d; i++) {
+        const float *k_row = k_t + i * KV_BLOCK;
+        for (size_t x = 0; x < 4; x++) {
+            const float a = q_rows[x * d + i];
+            float *s = scores + x * KV_BLOCK;
+            for (size_t t = 0; t < KV_BLOCK; t++) {
+                s[t] += a * k_row[t];
+            }
+        }
+    }
+#endif
+}
+
+// a[dv] = a * correction + p[n] * v_tile[n, dv], holding a slice of the accumulator in
+// registers across all n value rows.
+inline void accumulate_row(float *a, float correction, const float *p, const float *v_tile, size_t n, size_t dv) {
+    size_t i0 = 0;
+#if defined(__AVX512F__) || (defined(__AVX2__) && defined(__FMA__))
+#if defined(__AVX512F__)
+    using reg = __m512;
+    constexpr size_t W = 16;
+    auto load = [](const float *x) { return _mm512_loadu_ps(x); };
+    auto store = [](float *x, reg v) { _mm512_storeu_ps(x, v); };
+    auto set1 = [](float x) { return _mm512_set1_ps(x); };
+    auto mul = [](reg x, reg y) { return _mm512_mul_ps(x, y); };
+    auto fmadd = [](reg x, reg y, reg z) { return _mm512_fmadd_ps(x, y, z); };
+#else
+    using reg = __m256;
+    constexpr size_t W = 8;
+    auto load = [](const float *x) { return _mm256_loadu_ps(x); };
+    auto store = [](float *x, reg v) { _mm256_storeu_ps(x, v); };
+    auto set1 = [](float x) { return _mm256_set1_ps(x); };
+    auto mul = [](reg x, reg y) { return _mm256_mul_ps(x, y); };
+    auto fmadd = [](reg x, reg y, reg z) { return _mm256_fmadd_ps(x, y, z); };
+#endif
+    constexpr size_t R = 8;
+    const reg c = set1(correction);
+    for (; i0 + R * W <= dv; i0 += R * W) {
+        reg acc[R];
+        for (size_t j = 0; j < R; j++) {
+            acc[j] = mul(load(a + i0 + j * W), c);
+        }
+        for (size_t t = 0; t < n; t++) {
+            const reg pt = set1(p[t]);
+            const float *v_row = v_tile + t * dv + i0;
+            for (size_t j = 0; j < R; j++) {
+                acc[j] = fmadd(pt, load(v_row + j * W), acc[j]);
+            }
+        }
+        for (size_t j = 0; j < R; j++) {
+            store(a + i0 + j * W, acc[j]);
+        }
+    }
+#endif
+    for (size_t i = i0; i < dv; i++) {
+        a[i] *= correction;
+    }
+    for (size_t t = 0; t < n; t++) {
+        const float *v_row = v_tile + t * dv;
+        for (size_t i = i0; i < dv; i++) {
+            a[i] += p[t] * v_row[i];
+        }
+    }
+}
+
+// One sequence of a batch: its seqlen queries start at row q_begin of q and attn_val
+// and are the last positions of its total_len keys and values, read through
+// block_table if not null.
+struct Sequence {
+    size_t q_begin;
+    size_t seqlen;
+    size_t total_len;
+    const int64_t *block_table;
+};
+
+// Flash-style attention: each task is a tile of query rows sharing one key/value head.
+// A row is a (position, head) pair, ordered position-major over `heads` query heads of
+// the group, so a decode step scores all heads of a group against each key block it
+// loads. Keys and values are visited block by block with an online softmax, which
+// keeps a running max m and sum l per row and rescales the output accumulator whenever
+// m grows, so the scores of a row never exist all at once. Blocks past the last query
+// of a tile are never visited, and the diagonal block masks each row at its own
+// position. Key/value position t is row t of k and v, or, given a block table, row
+// t % block_size of block block_table[t / block_size] of a paged cache. Keys and
+// values of kv_type are widened to fp32 as they are staged, times their row's scale
+// when k_scales/v_scales[row, nkvhead] are given.
+//
+// The tasks of all sequences of a batch run in one parallel region, those of the
+// sequences with the most keys first so that the longest tasks do not end up last.
+void self_attention_(std::byte *attn_val, const std::byte *q, const std::byte *k, const std::byte *v,
+                     llaisysDataType_t type, llaisysDataType_t kv_type, const float *k_scales, const float *v_scales,
+                     Sequence *seqs, size_t nseq, size_t block_size, size_t nhead, size_t nkvhead, size_t d, size_t dv,
+                     float scale) {
+    using llaisys::ops::cpu::cast;
+    const size_t size = llaisys::utils::dsize(type), kv_size = llaisys::utils::dsize(kv_type);
+    const size_t group = nhead / nkvhead;
+    // Ties keep the batch order; std::sort, unlike std::stable_sort, needs no buffer.
+    std::sort(seqs, seqs + nseq, [](const Sequence &a, const Sequence &b) {
+        return a.total_len != b.total_len ? a.total_len > b.total_len : a.q_begin < b.q_begin;
+    });
+    size_t q_blocks = 0, max_seqlen = 0;
+    for (size_t i = 0; i < nseq; i++) {
+        const Sequence &seq = seqs[i];
+        q_blocks += (seq.seqlen + Q_BLOCK - 1) / Q_BLOCK;
+        max_seqlen = std::max(max_seqlen, seq.seqlen);
+    }
+    if (q_blocks == 0) {
+        return;
+    }
+    // Query heads per task. A whole group shares each pass over the keys unless that
+    // leaves threads idle, e.g. when decoding over few key/value heads; the group is
+    // then split, each part streaming the keys again.
+    const size_t num_threads = llaisys::core::threadPool().numThreads();
+    size_t splits = 1;
+    while (splits < group && (group % splits != 0 || q_blocks * nkvhead * splits < num_threads)) {
+        splits++;
+    }
+    const size_t heads = group / splits;
+    // Scores are computed four rows at a time; rows past the end of a tile are zero.
+    const size_t tile_rows = (std::min(Q_BLOCK, max_seqlen) * heads + 3) / 4 * 4;
+    // First task of each sequence.
+    thread_local std::vector<size_t> task_begin;
+    task_begin.assign(nseq + 1, 0);
+    for (size_t i = 0; i < nseq; i++) {
+        task_begin[i + 1] = task_begin[i] + (seqs[i].seqlen + Q_BLOCK - 1) / Q_BLOCK * nkvhead * splits;
+    }
+    const Sequence *seq_data = seqs;
+    const size_t *task_data = task_begin.data();
+    llaisys::core::threadPool().parallelFor(task_begin.back(), 1, [=](size_t begin, size_t end) {
+        // q_tile[tile_rows, d] pre-scaled, k_t[d, KV_BLOCK] transposed so that scores
+        // are accumulated along contiguous keys, v_tile[KV_BLOCK, dv], scores[tile_rows,
+        // KV_BLOCK] and acc[tile_rows, dv].
+        thread_local std::vector<float> q_tile, k_tile, k_t, v_tile, scores, acc, row_max, row_sum;
+        q_tile.resize(tile_rows * d);
+        k_tile.resize(KV_BLOCK * d);
+        k_t.resize(d * KV_BLOCK);
+        v_tile.resize(KV_BLOCK * dv);
+        scores.resize(tile_rows * KV_BLOCK);
+        acc.resize(tile_rows * dv);
+        row_max.resize(tile_rows);
+        row_sum.resize(tile_rows);
+        float *m = row_max.data(), *l = row_sum.data();
+
+        for (size_t task = begin; task < end; task++) {
+            const size_t si = std::upper_bound(task_data, task_data + nseq + 1, task) - task_data - 1;
+            const Sequence &seq = seq_data[si];
+            const size_t seqlen = seq.seqlen, total_len = seq.total_len;
+            const int64_t *block_table = seq.block_table;
+            // Query pos sits at absolute position pos + offset and sees every key up to
+            // and including itself.
+            const size_t offset = total_len - seqlen;
+            auto kv_row = [=](size_t t) {
+                return block_table ? static_cast<size_t>(block_table[t / block_size]) * block_size + t % block_size
+                                   : t;
+            };
+            const std::byte *seq_q = q + seq.q_begin * nhead * d * size;
+            std::byte *seq_attn = attn_val + seq.q_begin * nhead * dv * size;
+
+            const size_t head_part = (task - task_data[si]) % (nkvhead * splits);
+            const size_t kv_h = head_part / splits;
+            const size_t h0 = kv_h * group + (head_part % splits) * heads;
+            const size_t q0 = ((task - task_data[si]) / (nkvhead * splits)) * Q_BLOCK;
+            const size_t tile_positions = std::min(Q_BLOCK, seqlen - q0);
+            const size_t rows = tile_positions * heads;
+            const size_t visible = std::min(total_len, q0 + tile_positions + offset);
+
+            // The heads of a position are adjacent in q, so each position is one run.
+            std::fill(q_tile.begin() + rows * d, q_tile.end(), 0.0f);
+            for (size_t p = 0; p < tile_positions; p++) {
+                cast(reinterpret_cast<std::byte *>(&q_tile[p * heads * d]), seq_q + ((q0 + p) * nhead + h0) * d * size,
+                     LLAISYS_DTYPE_F32, type, heads * d, scale);
+            }
+            std::fill(m, m + rows, -std::numeric_limits<float>::infinity());
+            std::fill(l, l + rows, 0.0f);
+            std::fill(acc.begin(), acc.begin() + rows * dv, 0.0f);
+
+            for (size_t t0 = 0; t0 < visible; t0 += KV_BLOCK) {
+                const size_t cols = std::min(KV_BLOCK, visible - t0);
+                for (size_t t = 0; t < cols; t++) {
+                    const size_t row = kv_row(t0 + t) * nkvhead + kv_h;
+                    cast(reinterpret_cast<std::byte *>(&k_tile[t * d]), k + row * d * kv_size, LLAISYS_DTYPE_F32,
+                         kv_type, d, k_scales ? k_scales[row] : 1.0f);
+                    cast(reinterpret_cast<std::byte *>(&v_tile[t * dv]), v + row * dv * kv_size, LLAISYS_DTYPE_F32,
+                         kv_type, dv, v_scales ? v_scales[row] : 1.0f);
+                }
+                for (size_t i = 0; i < d; i++) {
+                    for (size_t t = 0; t < KV_BLOCK; t++) {
+                        k_t[i * KV_BLOCK + t] = t < cols ? k_tile[t * d + i] : 0.0f;
+                    }
+                }
+
+                for (size_t r = 0; r < rows; r += 4) {
+                    score_rows(&scores[r * KV_BLOCK], &q_tile[r * d], k_t.data(), d);
+                }
+
+                for (size_t r = 0; r < rows; r++) {
+                    // Keys of this block visible to the row; rows before the block's
+                    // first key only occur in the diagonal block.
+                    const size_t row_end = q0 + r / heads + offset + 1;
+                    if (row_end <= t0) {
+                        continue;
+                    }
+                    const size_t n = std::min(cols, row_end - t0);
+                    float *s = &scores[r * KV_BLOCK];
+
+                    float block_max = m[r];
+                    for (size_t t = 0; t < n; t++) {
+                        block_max = std::max(block_max, s[t]);
+                    }
+                    const float correction = std::exp(m[r] - block_max);
+                    m[r] = block_max;
+                    float sum = 0.0f;
+                    for (size_t t = 0; t < n; t++) {
+                        s[t] = std::exp(s[t] - block_max);
+                        sum += s[t];
+                    }
+                    l[r] = l[r] * correction + sum;
+
+                    accumulate_row(&acc[r * dv], correction, s, v_tile.data(), n, dv);
+                }
+            }
+
+            for (size_t r = 0; r < rows; r++) {
+                const float inv_sum = l[r] > 0.0f ? 1.0f / l[r] : 0.0f;
+                const size_t pos = q0 + r / heads, h = h0 + r % heads;
+                cast(seq_attn + (pos * nhead + h) * dv * size, reinterpret_cast<const std::byte *>(&acc[r * dv]),
+                     type, LLAISYS_DTYPE_F32, dv, inv_sum);
+            }
+        }
+    });
+}
+} // namespace
+
+namespace llaisys::ops::cpu {
+void self_attention(std::byte *attn_val, const std::byte *q, const std::byte *k, const std::byte *v,
+                    llaisysDataType_t type, size_t seqlen, size_t total_len, size_t nhead, size_t nkvhead,
+                    size_t d, size_t dv, float scale) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+    case LLAISYS_DTYPE_BF16:
+    case LLAISYS_DTYPE_F16:
+    {
+        Sequence seq{0, seqlen, total_len, nullptr};
+        return self_attention_(attn_val, q, k, v, type, type, nullptr, nullptr, &seq, 1, 0, nhead, nkvhead, d, dv,
+                               scale);
+    }
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+
+void self_attention_paged(std::byte *attn_val, const std::byte *q, const std::byte *k_cache,
+                          const std::byte *v_cache, const int64_t *block_table, llaisysDataType_t type,
+                          llaisysDataType_t kv_type, const float *k_scales, const float *v_scales, size_t seqlen,
+                          size_t total_len, size_t block_size, size_t nhead, size_t nkvhead, size_t d, size_t dv,
+                          float scale) {
+    const int64_t q_offsets[2] = {0, static_cast<int64_t>(seqlen)};
+    const int64_t kv_lens[1] = {static_cast<int64_t>(total_len)};
+    self_attention_batched(attn_val, q, k_cache, v_cache, block_table, 0, q_offsets, kv_lens, 1, type, kv_type,
+                           k_scales, v_scales, block_size, nhead, nkvhead, d, dv, scale);
+}
+
+void self_attention_batched(std::byte *attn_val, const std::byte *q, const std::byte *k_cache,
+                            const std::byte *v_cache, const int64_t *block_tables, size_t table_stride,
+                            const int64_t *q_offsets, const int64_t *kv_lens, size_t nseq, llaisysDataType_t type,
+                            llaisysDataType_t kv_type, const float *k_scales, const float *v_scales,
+                            size_t block_size, size_t nhead, size_t nkvhead, size_t d, size_t dv, float scale) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+    case LLAISYS_DTYPE_BF16:
+    case LLAISYS_DTYPE_F16:
+        break;
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+    switch (kv_type) {
+    case LLAISYS_DTYPE_F32:
+    case LLAISYS_DTYPE_BF16:
+    case LLAISYS_DTYPE_F16:
+    case LLAISYS_DTYPE_I8:
+    case LLAISYS_DTYPE_F8:
+    case LLAISYS_DTYPE_F8_E5M2:
+        break;
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(kv_type);
+    }
+    thread_local std::vector<Sequence> seqs;
+    seqs.resize(nseq);
+    for (size_t i = 0; i < nseq; i++) {
+        seqs[i] = {static_cast<size_t>(q_offsets[i]), static_cast<size_t>(q_offsets[i + 1] - q_offsets[i]),
+                   static_cast<size_t>(kv_lens[i]), block_tables + i * table_stride};
+    }
+    self_attention_(attn_val, q, k_cache, v_cache, type, kv_type, k_scales, v_scales, seqs.data(), nseq, block_size,
+                    nhead, nkvhead, d, dv, scale);
+}
+} // namespace llaisys::ops::cpu
@@ -0,0 +1,35 @@
+#pragma once
+#include "llaisys.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace llaisys::ops::cpu {
+// Causal attention of q[seqlen, nhead, d] over k[total_len, nkvhead, d] and v[total_len, nkvhead, dv].
+// The queries are the last seqlen positions of the sequence; query heads are grouped
+// onto key/value heads (nhead must be a multiple of nkvhead).
+void self_attention(std::byte *attn_val, const std::byte *q, const std::byte *k, const std::byte *v,
+                    llaisysDataType_t type, size_t seqlen, size_t total_len, size_t nhead, size_t nkvhead,
+                    size_t d, size_t dv, float scale);
+
+// Same attention over a paged cache: k_cache[nblocks, block_size, nkvhead, d] and
+// v_cache[nblocks, block_size, nkvhead, dv] hold key/value position t at row
+// t % block_size of block block_table[t / block_size]. The cache may be stored in
+// kv_type F32, BF16, F16, I8, F8 or F8_E5M2; each head of each row is then multiplied
+// by its k_scales/v_scales[nblocks, block_size, nkvhead] entry if those are given.
+void self_attention_paged(std::byte *attn_val, const std::byte *q, const std::byte *k_cache,
+                          const std::byte *v_cache, const int64_t *block_table, llaisysDataType_t type,
+                          llaisysDataType_t kv_type, const float *k_scales, const float *v_scales, size_t seqlen,
+                          size_t total_len, size_t block_size, size_t nhead, size_t nkvhead, size_t d, size_t dv,
+                          float scale);
+
+// The same attention for a ragged batch of nseq sequences over one paged cache, e.g. a
+// decode step of several requests. The queries of sequence i are rows
+// [q_offsets[i], q_offsets[i + 1]) of q and attn_val, the last of its kv_lens[i]
+// positions, which go through the block table at block_tables + i * table_stride.
+void self_attention_batched(std::byte *attn_val, const std::byte *q, const std::byte *k_cache,
+                            const std::byte *v_cache, const int64_t *block_tables, size_t table_stride,
+                            const int64_t *q_offsets, const int64_t *kv_lens, size_t nseq, llaisysDataType_t type,
+                            llaisysDataType_t kv_type, const float *k_scales, const float *v_scales,
+                            size_t block_size, size_t nhead, size_t nkvhead, size_t d, size_t dv, float scale);
+}
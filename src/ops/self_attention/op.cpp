@@ -3,45 +3,234 @@
 #include "../../core/llaisys_core.hpp"
 #include "../../utils.hpp"
 
-#include "self_attention_cpu.hpp"
+#include "cpu/self_attention_cpu.hpp"
 
 namespace llaisys::ops {
 void self_attention(tensor_t attn_val, tensor_t q, tensor_t k, tensor_t v, float scale) {
     CHECK_SAME_DEVICE(attn_val, q, k, v);
-    
-    ASSERT(q->ndim() == 3, "Query tensor must be 3D [seqlen, nhead, d]");
-    ASSERT(k->ndim() == 3, "Key tensor must be 3D [total_len, nkvhead, d]");
-    ASSERT(v->ndim() == 3, "Value tensor must be 3D [total_len, nkvhead, dv]");
-    ASSERT(attn_val->ndim() == 3, "Output tensor must be 3D [seqlen, nhead, dv]");
-    
-    int q_seqlen = q->shape()[0];
-    int q_nhead = q->shape()[1];
-    int q_d = q->shape()[2];
-    
-    int k_seqlen = k->shape()[0];
-    int k_nhead = k->shape()[1];
-    int k_d = k->shape()[2];
-    
-    int v_seqlen = v->shape()[0];
-    int v_nhead = v->shape()[1];
-    int v_dv = v->shape()[2];
-    
-    ASSERT(k_seqlen == v_seqlen, "Key and value sequence lengths must match");
-    ASSERT(k_d == q_d, "Query and key feature dimensions must match");
-    ASSERT(q_nhead % k_nhead == 0, "Number of query heads must be divisible by number of key/value heads");
-    
+    CHECK_SAME_DTYPE(attn_val->dtype(), q->dtype(), k->dtype(), v->dtype());
+    CHECK_ARGUMENT(q->ndim() == 3 && k->ndim() == 3 && v->ndim() == 3 && attn_val->ndim() == 3,
+                   "SelfAttention: expected q [seqlen, nhead, d], k [total_len, nkvhead, d], "
+                   "v [total_len, nkvhead, dv] and attn_val [seqlen, nhead, dv]");
+
+    size_t seqlen = q->shape()[0];
+    size_t nhead = q->shape()[1];
+    size_t d = q->shape()[2];
+    size_t total_len = k->shape()[0];
+    size_t nkvhead = k->shape()[1];
+    size_t dv = v->shape()[2];
+
+    CHECK_ARGUMENT(k->shape()[2] == d, "SelfAttention: query and key head dims must match");
+    CHECK_ARGUMENT(v->shape()[0] == total_len && v->shape()[1] == nkvhead,
+                   "SelfAttention: key and value shapes must match");
+    CHECK_ARGUMENT(nkvhead > 0 && nhead % nkvhead == 0,
+                   "SelfAttention: query heads must be a multiple of key/value heads");
+    CHECK_ARGUMENT(total_len >= seqlen, "SelfAttention: key length must cover the queries");
+    CHECK_ARGUMENT(attn_val->shape()[0] == seqlen && attn_val->shape()[1] == nhead && attn_val->shape()[2] == dv,
+                   "SelfAttention: output shape must be [seqlen, nhead, dv]");
     ASSERT(attn_val->isContiguous() && q->isContiguous() && k->isContiguous() && v->isContiguous(),
-           "SelfAttention: all tensors must be contiguous");
+           "SelfAttention: all tensors must be contiguous.");
+
+    if (attn_val->deviceType() == LLAISYS_DEVICE_CPU) {
+        return cpu::self_attention(attn_val->data(), q->data(), k->data(), v->data(), attn_val->dtype(),
+                                   seqlen, total_len, nhead, nkvhead, d, dv, scale);
+    }
+
+    llaisys::core::context().setDevice(attn_val->deviceType(), attn_val->deviceId());
+
+    switch (attn_val->deviceType()) {
+    case LLAISYS_DEVICE_CPU:
+        return cpu::self_attention(attn_val->data(), q->data(), k->data(), v->data(), attn_val->dtype(),
+                                   seqlen, total_len, nhead, nkvhead, d, dv, scale);
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
+
+void self_attention_paged(tensor_t attn_val, tensor_t q, tensor_t k_cache, tensor_t v_cache, tensor_t block_table,
+                          size_t total_len, float scale, tensor_t k_scales, tensor_t v_scales) {
+    CHECK_SAME_DEVICE(attn_val, q, k_cache, v_cache, block_table);
+    CHECK_SAME_DTYPE(attn_val->dtype(), q->dtype());
+    CHECK_SAME_DTYPE(k_cache->dtype(), v_cache->dtype());
+    const bool quantized = k_cache->dtype() == LLAISYS_DTYPE_I8 || k_cache->dtype() == LLAISYS_DTYPE_F8
+                        || k_cache->dtype() == LLAISYS_DTYPE_F8_E5M2;
+    if (!quantized) {
+        CHECK_SAME_DTYPE(q->dtype(), k_cache->dtype());
+    }
+    CHECK_ARGUMENT(quantized == (k_scales != nullptr) && quantized == (v_scales != nullptr),
+                   "SelfAttentionPaged: scales are given exactly for an I8, F8 or F8_E5M2 cache");
+    CHECK_ARGUMENT(block_table->dtype() == LLAISYS_DTYPE_I64, "SelfAttentionPaged: block table must be int64");
+    CHECK_ARGUMENT(q->ndim() == 3 && attn_val->ndim() == 3 && k_cache->ndim() == 4 && v_cache->ndim() == 4
+                       && block_table->ndim() == 1,
+                   "SelfAttentionPaged: expected q [seqlen, nhead, d], k_cache [nblocks, block_size, nkvhead, d], "
+                   "v_cache [nblocks, block_size, nkvhead, dv], block_table [nblocks_used] and "
+                   "attn_val [seqlen, nhead, dv]");
+
+    size_t seqlen = q->shape()[0];
+    size_t nhead = q->shape()[1];
+    size_t d = q->shape()[2];
+    size_t nblocks = k_cache->shape()[0];
+    size_t block_size = k_cache->shape()[1];
+    size_t nkvhead = k_cache->shape()[2];
+    size_t dv = v_cache->shape()[3];
+
+    CHECK_ARGUMENT(k_cache->shape()[3] == d, "SelfAttentionPaged: query and key head dims must match");
+    CHECK_ARGUMENT(v_cache->shape()[0] == nblocks && v_cache->shape()[1] == block_size
+                       && v_cache->shape()[2] == nkvhead,
+                   "SelfAttentionPaged: key and value caches must match");
+    CHECK_ARGUMENT(block_size > 0, "SelfAttentionPaged: block size must be positive");
+    CHECK_ARGUMENT(nkvhead > 0 && nhead % nkvhead == 0,
+                   "SelfAttentionPaged: query heads must be a multiple of key/value heads");
+    CHECK_ARGUMENT(total_len >= seqlen, "SelfAttentionPaged: key length must cover the queries");
+    CHECK_ARGUMENT(block_table->shape()[0] * block_size >= total_len,
+                   "SelfAttentionPaged: block table must cover total_len positions");
+    CHECK_ARGUMENT(attn_val->shape()[0] == seqlen && attn_val->shape()[1] == nhead && attn_val->shape()[2] == dv,
+                   "SelfAttentionPaged: output shape must be [seqlen, nhead, dv]");
+    ASSERT(attn_val->isContiguous() && q->isContiguous() && k_cache->isContiguous() && v_cache->isContiguous()
+               && block_table->isContiguous(),
+           "SelfAttentionPaged: all tensors must be contiguous.");
+    if (quantized) {
+        CHECK_SAME_DEVICE(k_cache, k_scales, v_scales);
+        CHECK_ARGUMENT(k_scales->dtype() == LLAISYS_DTYPE_F32 && v_scales->dtype() == LLAISYS_DTYPE_F32,
+                       "SelfAttentionPaged: scales must be F32");
+        CHECK_SAME_SHAPE(k_scales->shape(), v_scales->shape());
+        CHECK_ARGUMENT(k_scales->ndim() == 3 && k_scales->shape()[0] == nblocks
+                           && k_scales->shape()[1] == block_size && k_scales->shape()[2] == nkvhead,
+                       "SelfAttentionPaged: scales must be [nblocks, block_size, nkvhead]");
+        ASSERT(k_scales->isContiguous() && v_scales->isContiguous(), "SelfAttentionPaged: scales must be contiguous.");
+    }
+
+    auto self_attention_paged_cpu = [&]() {
+        // The table is read on the host; an index past the pool would read out of bounds.
+        const auto *table = reinterpret_cast<const int64_t *>(block_table->data());
+        const size_t used = (total_len + block_size - 1) / block_size;
+        for (size_t i = 0; i < used; i++) {
+            CHECK_ARGUMENT(table[i] >= 0 && static_cast<size_t>(table[i]) < nblocks,
+                           "SelfAttentionPaged: block index out of range");
+        }
+        return cpu::self_attention_paged(
+            attn_val->data(), q->data(), k_cache->data(), v_cache->data(), table, attn_val->dtype(), k_cache->dtype(),
+            quantized ? reinterpret_cast<const float *>(k_scales->data()) : nullptr,
+            quantized ? reinterpret_cast<const float *>(v_scales->data()) : nullptr, seqlen, total_len, block_size,
+            nhead, nkvhead, d, dv, scale);
+    };
+
+    if (attn_val->deviceType() == LLAISYS_DEVICE_CPU) {
+        return self_attention_paged_cpu();
+    }
+
+    llaisys::core::context().setDevice(attn_val->deviceType(), attn_val->deviceId());
+
+    switch (attn_val->deviceType()) {
+    case LLAISYS_DEVICE_CPU:
+        return self_attention_paged_cpu();
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
+
+void self_attention_batched(tensor_t attn_val, tensor_t q, tensor_t k_cache, tensor_t v_cache, tensor_t block_tables,
+                            tensor_t q_offsets, tensor_t kv_lens, float scale, tensor_t k_scales, tensor_t v_scales) {
+    CHECK_SAME_DEVICE(attn_val, q, k_cache, v_cache, block_tables, q_offsets, kv_lens);
+    CHECK_SAME_DTYPE(attn_val->dtype(), q->dtype());
+    CHECK_SAME_DTYPE(k_cache->dtype(), v_cache->dtype());
+    const bool quantized = k_cache->dtype() == LLAISYS_DTYPE_I8 || k_cache->dtype() == LLAISYS_DTYPE_F8
+                        || k_cache->dtype() == LLAISYS_DTYPE_F8_E5M2;
+    if (!quantized) {
+        CHECK_SAME_DTYPE(q->dtype(), k_cache->dtype());
+    }
+    CHECK_ARGUMENT(quantized == (k_scales != nullptr) && quantized == (v_scales != nullptr),
+                   "SelfAttentionBatched: scales are given exactly for an I8, F8 or F8_E5M2 cache");
+    CHECK_ARGUMENT(block_tables->dtype() == LLAISYS_DTYPE_I64 && q_offsets->dtype() == LLAISYS_DTYPE_I64
+                       && kv_lens->dtype() == LLAISYS_DTYPE_I64,
+                   "SelfAttentionBatched: block tables, query offsets and key lengths must be int64");
+    CHECK_ARGUMENT(q->ndim() == 3 && attn_val->ndim() == 3 && k_cache->ndim() == 4 && v_cache->ndim() == 4
+                       && block_tables->ndim() == 2 && q_offsets->ndim() == 1 && kv_lens->ndim() == 1,
+                   "SelfAttentionBatched: expected q [total_q, nhead, d], k_cache [nblocks, block_size, nkvhead, d], "
+                   "v_cache [nblocks, block_size, nkvhead, dv], block_tables [nseq, max_blocks], "
+                   "q_offsets [nseq + 1], kv_lens [nseq] and attn_val [total_q, nhead, dv]");
+
+    size_t total_q = q->shape()[0];
+    size_t nhead = q->shape()[1];
+    size_t d = q->shape()[2];
+    size_t nblocks = k_cache->shape()[0];
+    size_t block_size = k_cache->shape()[1];
+    size_t nkvhead = k_cache->shape()[2];
+    size_t dv = v_cache->shape()[3];
+    size_t nseq = kv_lens->shape()[0];
+    size_t max_blocks = block_tables->shape()[1];
+
+    CHECK_ARGUMENT(k_cache->shape()[3] == d, "SelfAttentionBatched: query and key head dims must match");
+    CHECK_ARGUMENT(v_cache->shape()[0] == nblocks && v_cache->shape()[1] == block_size
+                       && v_cache->shape()[2] == nkvhead,
+                   "SelfAttentionBatched: key and value caches must match");
+    CHECK_ARGUMENT(block_size > 0, "SelfAttentionBatched: block size must be positive");
+    CHECK_ARGUMENT(nkvhead > 0 && nhead % nkvhead == 0,
+                   "SelfAttentionBatched: query heads must be a multiple of key/value heads");
+    CHECK_ARGUMENT(block_tables->shape()[0] == nseq && q_offsets->shape()[0] == nseq + 1,
+                   "SelfAttentionBatched: expected a block table, a key length and a query range per sequence");
+    CHECK_ARGUMENT(attn_val->shape()[0] == total_q && attn_val->shape()[1] == nhead && attn_val->shape()[2] == dv,
+                   "SelfAttentionBatched: output shape must be [total_q, nhead, dv]");
+    ASSERT(attn_val->isContiguous() && q->isContiguous() && k_cache->isContiguous() && v_cache->isContiguous()
+               && block_tables->isContiguous() && q_offsets->isContiguous() && kv_lens->isContiguous(),
+           "SelfAttentionBatched: all tensors must be contiguous.");
+    if (quantized) {
+        CHECK_SAME_DEVICE(k_cache, k_scales, v_scales);
+        CHECK_ARGUMENT(k_scales->dtype() == LLAISYS_DTYPE_F32 && v_scales->dtype() == LLAISYS_DTYPE_F32,
+                       "SelfAttentionBatched: scales must be F32");
+        CHECK_SAME_SHAPE(k_scales->shape(), v_scales->shape());
+        CHECK_ARGUMENT(k_scales->ndim() == 3 && k_scales->shape()[0] == nblocks
+                           && k_scales->shape()[1] == block_size && k_scales->shape()[2] == nkvhead,
+                       "SelfAttentionBatched: scales must be [nblocks, block_size, nkvhead]");
+        ASSERT(k_scales->isContiguous() && v_scales->isContiguous(),
+               "SelfAttentionBatched: scales must be contiguous.");
+    }
+
+    auto self_attention_batched_cpu = [&]() {
+        // The batch layout is read on the host; inconsistent offsets or indices would
+        // read out of bounds.
+        const auto *tables = reinterpret_cast<const int64_t *>(block_tables->data());
+        const auto *offsets = reinterpret_cast<const int64_t *>(q_offsets->data());
+        const auto *lens = reinterpret_cast<const int64_t *>(kv_lens->data());
+        CHECK_ARGUMENT(offsets[0] == 0 && offsets[nseq] == static_cast<int64_t>(total_q),
+                       "SelfAttentionBatched: query offsets must span q");
+        for (size_t i = 0; i < nseq; i++) {
+            CHECK_ARGUMENT(offsets[i + 1] >= offsets[i] && lens[i] >= offsets[i + 1] - offsets[i],
+                           "SelfAttentionBatched: each key length must cover the sequence's queries");
+            const size_t used = (static_cast<size_t>(lens[i]) + block_size - 1) / block_size;
+            CHECK_ARGUMENT(used <= max_blocks, "SelfAttentionBatched: block table must cover each key length");
+            for (size_t j = 0; j < used; j++) {
+                const int64_t block = tables[i * max_blocks + j];
+                CHECK_ARGUMENT(block >= 0 && static_cast<size_t>(block) < nblocks,
+                               "SelfAttentionBatched: block index out of range");
+            }
+        }
+        return cpu::self_attention_batched(
+            attn_val->data(), q->data(), k_cache->data(), v_cache->data(), tables, max_blocks, offsets, lens, nseq,
+            attn_val->dtype(), k_cache->dtype(), quantized ? reinterpret_cast<const float *>(k_scales->data()) : nullptr,
+            quantized ? reinterpret_cast<const float *>(v_scales->data()) : nullptr, block_size, nhead, nkvhead, d, dv,
+            scale);
+    };
 
     if (attn_val->deviceType() == LLAISYS_DEVICE_CPU) {
-        return cpu::self_attention(attn_val, q, k, v, scale);
+        return self_attention_batched_cpu();
     }
 
     llaisys::core::context().setDevice(attn_val->deviceType(), attn_val->deviceId());
 
     switch (attn_val->deviceType()) {
     case LLAISYS_DEVICE_CPU:
-        return cpu::self_attention(attn_val, q, k, v, scale);
+        return self_attention_batched_cpu();
 #ifdef ENABLE_NVIDIA_API
     case LLAISYS_DEVICE_NVIDIA:
         TO_BE_IMPLEMENTED();
@@ -4,4 +4,19 @@
 
 namespace llaisys::ops {
 void self_attention(tensor_t attn_val, tensor_t q, tensor_t k, tensor_t v, float scale);
+// Attention of q[seqlen, nhead, d] over the first total_len positions of a paged cache
+// k_cache[nblocks, block_size, nkvhead, d], v_cache[nblocks, block_size, nkvhead, dv],
+// position t living in block block_table[t / block_size] (I64). A cache quantized to
+// I8, F8 or F8_E5M2 comes with F32 k_scales and v_scales[nblocks, block_size, nkvhead],
+// one per head of each position, and is dequantized as the kernel reads it.
+void self_attention_paged(tensor_t attn_val, tensor_t q, tensor_t k_cache, tensor_t v_cache, tensor_t block_table,
+                          size_t total_len, float scale, tensor_t k_scales = nullptr, tensor_t v_scales = nullptr);
+// The same attention for a ragged batch of sequences sharing a paged cache, e.g. one
+// decode step of several requests. q[total_q, nhead, d] packs the queries of every
+// sequence, those of sequence i being rows [q_offsets[i], q_offsets[i + 1]) (I64
+// [nseq + 1]), causal over the last of its kv_lens[i] (I64 [nseq]) positions, which go
+// through block_tables[i] (I64 [nseq, max_blocks]).
+void self_attention_batched(tensor_t attn_val, tensor_t q, tensor_t k_cache, tensor_t v_cache, tensor_t block_tables,
+                            tensor_t q_offsets, tensor_t kv_lens, float scale, tensor_t k_scales = nullptr,
+                            tensor_t v_scales = nullptr);
 }
@@ -1,7 +0,0 @@
-#pragma once
-
-#include "../../../tensor/tensor.hpp"
-
-namespace llaisys::ops::cpu {
-void self_attention(tensor_t attn_val, tensor_t q, tensor_t k, tensor_t v, float scale);
-} // namespace llaisys::ops::cpu
\ No newline at end of file
@@ -0,0 +1,39 @@
+#include "swiglu_cpu.hpp"
+
+#include "../../../core/thread_pool/thread_pool.hpp"
+#include "../../../utils.hpp"
+
+#include <cmath>
+
+namespace {
+constexpr size_t GRAIN_ELEMENTS = 16384;
+
+template <typename T>
+void swiglu_(T *out, const T *gate, const T *up, size_t numel) {
+    llaisys::core::threadPool().parallelFor(numel, GRAIN_ELEMENTS, [=](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            float gate_val = llaisys::utils::cast<float>(gate[i]);
+            float up_val = llaisys::utils::cast<float>(up[i]);
+            out[i] = llaisys::utils::cast<T>(up_val * gate_val / (1.0f + std::exp(-gate_val)));
+        }
+    });
+}
+} // namespace
+
+namespace llaisys::ops::cpu {
+void swiglu(std::byte *out, const std::byte *gate, const std::byte *up, llaisysDataType_t type, size_t numel) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return swiglu_(reinterpret_cast<float *>(out), reinterpret_cast<const float *>(gate),
+                       reinterpret_cast<const float *>(up), numel);
+    case LLAISYS_DTYPE_BF16:
+        return swiglu_(reinterpret_cast<llaisys::bf16_t *>(out), reinterpret_cast<const llaisys::bf16_t *>(gate),
+                       reinterpret_cast<const llaisys::bf16_t *>(up), numel);
+    case LLAISYS_DTYPE_F16:
+        return swiglu_(reinterpret_cast<llaisys::fp16_t *>(out), reinterpret_cast<const llaisys::fp16_t *>(gate),
+                       reinterpret_cast<const llaisys::fp16_t *>(up), numel);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+} // namespace llaisys::ops::cpu
@@ -11,6 +11,15 @@ namespace llaisys {
 Tensor::Tensor(TensorMeta meta, core::storage_t storage, size_t offset)
     : _meta(std::move(meta)), _storage(std::move(storage)), _offset(offset) {}
 
+core::storage_t Tensor::allocate(size_t bytes, llaisysDeviceType_t device_type, int device) {
+    if (device_type == LLAISYS_DEVICE_CPU && core::context().runtime().deviceType() != LLAISYS_DEVICE_CPU) {
+        return core::context().runtime().allocateHostStorage(bytes);
+    } else {
+        core::context().setDevice(device_type, device);
+        return core::context().runtime().allocateDeviceStorage(bytes);
+    }
+}
+
 tensor_t Tensor::create(const std::vector<size_t> &shape,
                         llaisysDataType_t dtype,
                         llaisysDeviceType_t device_type,
@@ -26,14 +35,36 @@ tensor_t Tensor::create(const std::vector<size_t> &shape,
     size_t total_elems = stride;
     size_t dtype_size = utils::dsize(dtype);
 
-    if (device_type == LLAISYS_DEVICE_CPU && core::context().runtime().deviceType() != LLAISYS_DEVICE_CPU) {
-        auto storage = core::context().runtime().allocateHostStorage(total_elems * dtype_size);
-        return std::shared_ptr<Tensor>(new Tensor(meta, storage));
-    } else {
-        core::context().setDevice(device_type, device);
-        auto storage = core::context().runtime().allocateDeviceStorage(total_elems * dtype_size);
-        return std::shared_ptr<Tensor>(new Tensor(meta, storage));
+    auto storage = allocate(total_elems * dtype_size, device_type, device);
+    return std::shared_ptr<Tensor>(new Tensor(meta, storage));
+}
+
+tensor_t Tensor::createWithLayout(const std::vector<size_t> &shape,
+                                  llaisysDataType_t dtype,
+                                  TensorLayout layout,
+                                  size_t storage_numel,
+                                  llaisysDeviceType_t device_type,
+                                  int device) {
+    TensorMeta meta{dtype, shape, std::vector<ptrdiff_t>(shape.size(), 0), layout};
+    auto storage = allocate(storage_numel * utils::dsize(dtype), device_type, device);
+    return std::shared_ptr<Tensor>(new Tensor(meta, storage));
+}
+
+tensor_t Tensor::createFromStorage(const std::vector<size_t> &shape,
+                                   llaisysDataType_t dtype,
+                                   core::storage_t storage,
+                                   size_t offset) {
+    size_t ndim_ = shape.size();
+    std::vector<ptrdiff_t> strides(ndim_);
+    size_t stride = 1;
+    for (size_t i = 1; i <= ndim_; i++) {
+        strides[ndim_ - i] = stride;
+        stride *= shape[ndim_ - i];
     }
+    CHECK_ARGUMENT(offset <= storage->size() && stride * utils::dsize(dtype) <= storage->size() - offset,
+                   "Tensor: shape exceeds the storage");
+    TensorMeta meta{dtype, shape, strides};
+    return std::shared_ptr<Tensor>(new Tensor(meta, storage, offset));
 }
 
 std::byte *Tensor::data() {
@@ -60,6 +91,10 @@ llaisysDataType_t Tensor::dtype() const {
     return _meta.dtype;
 }
 
+TensorLayout Tensor::layout() const {
+    return _meta.layout;
+}
+
 llaisysDeviceType_t Tensor::deviceType() const {
     return _storage->deviceType();
 }
@@ -89,6 +124,9 @@ std::string Tensor::info() const {
         ss << s << " ";
     }
     ss << "] dtype=" << this->dtype();
+    if (this->layout() == TensorLayout::LINEAR_PACKED) {
+        ss << " layout=linear_packed";
+    }
 
     return ss.str();
 }
@@ -147,6 +185,10 @@ void debug_print(const std::byte *data, const std::vector<size_t> &shape, const
 }
 
 void Tensor::debug() const {
+    if (this->layout() != TensorLayout::STRIDED) {
+        std::cout << this->info() << std::endl;
+        return;
+    }
     core::context().setDevice(this->deviceType(), this->deviceId());
     core::context().runtime().api()->device_synchronize();
     std::cout << this->info() << std::endl;
@@ -164,7 +206,9 @@ void Tensor::debug() const {
 }
 
 bool Tensor::isContiguous() const {
-  
+    if (_meta.layout != TensorLayout::STRIDED) {
+        return false;
+    }
     size_t expected_stride = 1;
     for (int i = _meta.shape.size() - 1; i >= 0; i--) {
         if (_meta.strides[i] != static_cast<ptrdiff_t>(expected_stride)) {
@@ -176,6 +220,9 @@ bool Tensor::isContiguous() const {
 }
 
 tensor_t Tensor::permute(const std::vector<size_t> &order) const {
+    if (_meta.layout != TensorLayout::STRIDED) {
+        throw std::runtime_error("Permute is not supported on packed tensors");
+    }
     if (order.size() != _meta.shape.size()) {
         throw std::runtime_error("Permute order must have same number of dimensions as tensor");
     }
@@ -228,6 +275,9 @@ tensor_t Tensor::view(const std::vector<size_t> &shape) const {
 }
 
 tensor_t Tensor::slice(size_t dim, size_t start, size_t end) const {
+    if (_meta.layout != TensorLayout::STRIDED) {
+        throw std::runtime_error("Slice is not supported on packed tensors");
+    }
     if (dim >= _meta.shape.size()) {
         throw std::runtime_error("Invalid dimension for slice");
     }
@@ -244,7 +294,9 @@ tensor_t Tensor::slice(size_t dim, size_t start, size_t end) const {
 }
 
 void Tensor::load(const void *src_) {
-   
+    if (_meta.layout != TensorLayout::STRIDED) {
+        throw std::runtime_error("Load is not supported on packed tensors");
+    }
     auto &runtime = core::context().runtime();
     auto *api = runtime.api();
     
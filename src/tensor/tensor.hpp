@@ -6,10 +6,20 @@ namespace llaisys {
 class Tensor;
 using tensor_t = std::shared_ptr<Tensor>;
 
+// Physical arrangement of a tensor's elements in its storage.
+enum class TensorLayout {
+    // Elements addressed through shape and strides.
+    STRIDED,
+    // A [out_features, in_features] linear weight rearranged into the panel
+    // layout of the CPU GEMM kernel. Only readable by ops::linear.
+    LINEAR_PACKED,
+};
+
 struct TensorMeta {
     llaisysDataType_t dtype;
     std::vector<size_t> shape;
     std::vector<ptrdiff_t> strides;
+    TensorLayout layout = TensorLayout::STRIDED;
 };
 
 class Tensor {
@@ -18,6 +28,7 @@ private:
     core::storage_t _storage;
     size_t _offset;
     Tensor(TensorMeta meta, core::storage_t storage, size_t offset = 0);
+    static core::storage_t allocate(size_t bytes, llaisysDeviceType_t device_type, int device);
 
 public:
     static tensor_t create(
@@ -25,6 +36,20 @@ public:
         llaisysDataType_t dtype,
         llaisysDeviceType_t device_type = LLAISYS_DEVICE_CPU,
         int device = 0);
+    // Tensor with logical `shape` whose storage holds `storage_numel` elements in `layout`.
+    static tensor_t createWithLayout(
+        const std::vector<size_t> &shape,
+        llaisysDataType_t dtype,
+        TensorLayout layout,
+        size_t storage_numel,
+        llaisysDeviceType_t device_type = LLAISYS_DEVICE_CPU,
+        int device = 0);
+    // Contiguous tensor over `storage` from byte `offset` on, sharing it.
+    static tensor_t createFromStorage(
+        const std::vector<size_t> &shape,
+        llaisysDataType_t dtype,
+        core::storage_t storage,
+        size_t offset = 0);
     ~Tensor() = default;
     // Info
     std::byte *data();
@@ -33,6 +58,7 @@ public:
     const std::vector<size_t> &shape() const;
     const std::vector<ptrdiff_t> &strides() const;
     llaisysDataType_t dtype() const;
+    TensorLayout layout() const;
     llaisysDeviceType_t deviceType() const;
     int deviceId() const;
     size_t numel() const;
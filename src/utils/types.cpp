@@ -1,5 +1,6 @@
 #include "types.hpp"
 
+#include <cmath>
 #include <cstring>
 
 namespace llaisys::utils {
@@ -82,4 +83,74 @@ bf16_t _f32_to_bf16(float val) {
 
     return bf16_t{bf16_bits};
 }
+
+float _f8e4m3_to_f32(f8e4m3_t val) {
+    uint8_t v = val._v;
+    float sign = (v & 0x80) ? -1.0f : 1.0f;
+    int exponent = (v >> 3) & 0xF;
+    int mantissa = v & 0x7;
+    if (exponent == 0xF && mantissa == 0x7) {
+        return sign * NAN;
+    }
+    if (exponent == 0) {
+        return sign * std::ldexp(static_cast<float>(mantissa), -9);
+    }
+    return sign * std::ldexp(static_cast<float>(8 + mantissa), exponent - 10);
+}
+
+f8e4m3_t _f32_to_f8e4m3(float val) {
+    uint32_t f32;
+    memcpy(&f32, &val, sizeof(f32));
+    uint8_t sign = (f32 >> 24) & 0x80;
+    uint32_t abs = f32 & 0x7FFFFFFF;
+
+    if (abs > 0x7F800000) { // NaN
+        return f8e4m3_t{static_cast<uint8_t>(sign | 0x7F)};
+    }
+    if (abs >= 0x43E00000) { // 448 and above, including infinity
+        return f8e4m3_t{static_cast<uint8_t>(sign | 0x7E)};
+    }
+    if (abs < 0x3C800000) { // Below 2^-6: subnormal steps of 2^-9
+        float mag;
+        memcpy(&mag, &abs, sizeof(mag));
+        // Rounding up to 8 steps gives the encoding of the smallest normal.
+        return f8e4m3_t{static_cast<uint8_t>(sign | static_cast<uint8_t>(std::nearbyint(mag * 512.0f)))};
+    }
+    // Round the mantissa to 3 bits, to nearest even.
+    abs += 0x7FFFF + ((abs >> 20) & 1);
+    int32_t exponent = static_cast<int32_t>(abs >> 23) - 127 + 7;
+    uint8_t mantissa = (abs >> 20) & 0x7;
+    return f8e4m3_t{static_cast<uint8_t>(sign | (exponent << 3) | mantissa)};
+}
+
+float _f8e5m2_to_f32(f8e5m2_t val) {
+    return _f16_to_f32(fp16_t{static_cast<uint16_t>(val._v << 8)});
+}
+
+f8e5m2_t _f32_to_f8e5m2(float val) {
+    uint32_t f32;
+    memcpy(&f32, &val, sizeof(f32));
+    uint8_t sign = (f32 >> 24) & 0x80;
+    uint32_t abs = f32 & 0x7FFFFFFF;
+
+    if (abs > 0x7F800000) { // NaN
+        return f8e5m2_t{static_cast<uint8_t>(sign | 0x7E)};
+    }
+    if (abs == 0x7F800000) { // Infinity
+        return f8e5m2_t{static_cast<uint8_t>(sign | 0x7C)};
+    }
+    if (abs >= 0x47600000) { // 57344 and above
+        return f8e5m2_t{static_cast<uint8_t>(sign | 0x7B)};
+    }
+    if (abs < 0x38800000) { // Below 2^-14: subnormal steps of 2^-16
+        float mag;
+        memcpy(&mag, &abs, sizeof(mag));
+        return f8e5m2_t{static_cast<uint8_t>(sign | static_cast<uint8_t>(std::nearbyint(mag * 65536.0f)))};
+    }
+    // Round the mantissa to 2 bits, to nearest even.
+    abs += 0xFFFFF + ((abs >> 21) & 1);
+    int32_t exponent = static_cast<int32_t>(abs >> 23) - 127 + 15;
+    uint8_t mantissa = (abs >> 21) & 0x3;
+    return f8e5m2_t{static_cast<uint8_t>(sign | (exponent << 2) | mantissa)};
+}
 } // namespace llaisys::utils
@@ -1,7 +1,9 @@
+#pragma once
 #include "llaisys.h"
 
 #include <iostream>
 #include <stdexcept>
+#include <type_traits>
 
 namespace llaisys {
 struct CustomFloat16 {
@@ -14,6 +16,18 @@ struct CustomBFloat16 {
 };
 typedef struct CustomBFloat16 bf16_t;
 
+// 8-bit floats. E4M3 (LLAISYS_DTYPE_F8) has a bias of 7, a largest value of 448 and
+// no infinities; E5M2 (LLAISYS_DTYPE_F8_E5M2) is the upper byte of an fp16.
+struct CustomFloat8E4M3 {
+    uint8_t _v;
+};
+typedef struct CustomFloat8E4M3 f8e4m3_t;
+
+struct CustomFloat8E5M2 {
+    uint8_t _v;
+};
+typedef struct CustomFloat8E5M2 f8e5m2_t;
+
 namespace utils {
 inline size_t dsize(llaisysDataType_t dtype) {
     switch (dtype) {
@@ -38,7 +52,9 @@ inline size_t dsize(llaisysDataType_t dtype) {
     case LLAISYS_DTYPE_U64:
         return sizeof(uint64_t);
     case LLAISYS_DTYPE_F8:
-        return 1; // usually 8-bit float (custom)
+        return 1; // 8-bit float, E4M3
+    case LLAISYS_DTYPE_F8_E5M2:
+        return 1; // 8-bit float, E5M2
     case LLAISYS_DTYPE_F16:
         return 2; // 16-bit float
     case LLAISYS_DTYPE_BF16:
@@ -84,7 +100,9 @@ inline const char *dtype_to_str(llaisysDataType_t dtype) {
     case LLAISYS_DTYPE_U64:
         return "uint64";
     case LLAISYS_DTYPE_F8:
-        return "float8";
+        return "float8_e4m3";
+    case LLAISYS_DTYPE_F8_E5M2:
+        return "float8_e5m2";
     case LLAISYS_DTYPE_F16:
         return "float16";
     case LLAISYS_DTYPE_BF16:
@@ -113,10 +131,43 @@ fp16_t _f32_to_f16(float val);
 float _bf16_to_f32(bf16_t val);
 bf16_t _f32_to_bf16(float val);
 
+// Conversions to 8-bit floats round to nearest even and saturate finite values to
+// the largest finite value.
+float _f8e4m3_to_f32(f8e4m3_t val);
+f8e4m3_t _f32_to_f8e4m3(float val);
+
+float _f8e5m2_to_f32(f8e5m2_t val);
+f8e5m2_t _f32_to_f8e5m2(float val);
+
+template <typename T>
+inline constexpr bool is_f8_v = std::is_same_v<T, f8e4m3_t> || std::is_same_v<T, f8e5m2_t>;
+
+template <typename T>
+float _f8_to_f32(T val) {
+    if constexpr (std::is_same_v<T, f8e4m3_t>) {
+        return _f8e4m3_to_f32(val);
+    } else {
+        return _f8e5m2_to_f32(val);
+    }
+}
+
+template <typename T>
+T _f32_to_f8(float val) {
+    if constexpr (std::is_same_v<T, f8e4m3_t>) {
+        return _f32_to_f8e4m3(val);
+    } else {
+        return _f32_to_f8e5m2(val);
+    }
+}
+
 template <typename TypeTo, typename TypeFrom>
 TypeTo cast(TypeFrom val) {
     if constexpr (std::is_same<TypeTo, TypeFrom>::value) {
         return val;
+    } else if constexpr (is_f8_v<TypeTo>) {
+        return _f32_to_f8<TypeTo>(cast<float>(val));
+    } else if constexpr (is_f8_v<TypeFrom>) {
+        return cast<TypeTo>(_f8_to_f32(val));
     } else if constexpr (std::is_same<TypeTo, fp16_t>::value && std::is_same<TypeFrom, float>::value) {
         return _f32_to_f16(val);
     } else if constexpr (std::is_same<TypeTo, fp16_t>::value && !std::is_same<TypeFrom, float>::value) {
@@ -0,0 +1,68 @@
+import sys
+import os
+
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.insert(0, parent_dir)
+import llaisys
+import torch
+from test_utils import zero_tensor, torch_dtype, benchmark
+
+
+def copy_tensor(dst, src, to_llaisys):
+    api = llaisys.RuntimeAPI(dst.device_type() if to_llaisys else src.device_type())
+    torch_tensor = src if to_llaisys else dst
+    api.memcpy_sync(
+        dst.data_ptr(),
+        src.data_ptr(),
+        torch_tensor.numel() * torch_tensor.element_size(),
+        llaisys.MemcpyKind.D2D,
+    )
+    return dst
+
+
+def test_op_cast(
+    shape,
+    in_dtype_name,
+    out_dtype_name,
+    device_name="cpu",
+    profile=False,
+):
+    print(f"   shape {shape} <{in_dtype_name}> -> <{out_dtype_name}>")
+    # Values within the range of every type, including fp8 subnormals.
+    x = (torch.randn(shape) * 8).to(torch_dtype(in_dtype_name))
+    x[..., :4] = torch.tensor([0.0, -0.0, 1e-3, -2.5]).to(x.dtype)
+    _, x_ = zero_tensor(shape, in_dtype_name, device_name)
+    copy_tensor(x_, x, True)
+
+    out, out_ = zero_tensor(shape, out_dtype_name, device_name)
+    answer = x.to(out.dtype)
+    llaisys.Ops.cast(out_, x_)
+    copy_tensor(out, out_, False)
+
+    # Conversions round to nearest even, exactly as torch does.
+    assert torch.equal(out.float(), answer.float())
+
+    if profile:
+        benchmark(
+            lambda: x.to(out.dtype),
+            lambda: llaisys.Ops.cast(out_, x_),
+            device_name,
+        )
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
+    parser.add_argument("--profile", action="store_true")
+    args = parser.parse_args()
+    testShapes = [(2, 3), (13, 70), (512, 4096)]
+    testDtypes = ["f32", "f16", "bf16", "f8e4m3", "f8e5m2"]
+    print(f"Testing Ops.cast on {args.device}")
+    for shape in testShapes:
+        for in_dtype_name in testDtypes:
+            for out_dtype_name in testDtypes:
+                test_op_cast(shape, in_dtype_name, out_dtype_name, args.device, args.profile)
+
+    print("\033[92mTest passed!\033[0m\n")
@@ -4,7 +4,8 @@ import os
 parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
 sys.path.insert(0, parent_dir)
 import llaisys
-from test_utils import random_int_tensor, random_tensor, check_equal, benchmark
+import torch
+from test_utils import random_int_tensor, random_tensor, zero_tensor, check_equal, benchmark
 
 
 def torch_embedding(out, idx, embd):
@@ -35,6 +36,47 @@ def test_op_embedding(
         )
 
 
+def test_op_embedding_fp8(
+    idx_shape,
+    embd_shape,
+    weight_dtype_name,
+    per_tensor,
+    dtype_name="f32",
+    device_name="cpu",
+):
+    print(
+        f"   idx_shape {idx_shape} embd_shape {embd_shape} weight <{weight_dtype_name}> "
+        f"{'per-tensor' if per_tensor else 'per-row'} scales dtype <{dtype_name}>"
+    )
+    embd, _ = random_tensor(embd_shape, dtype_name, device_name, scale=0.2, bias=-0.1)
+    qweight, qweight_ = zero_tensor(embd_shape, weight_dtype_name, device_name)
+    scales, scales_ = zero_tensor((1,) if per_tensor else (embd_shape[0],), dtype_name, device_name)
+    llaisys.Ops.linear_quantize(qweight_, scales_, llaisys_tensor(embd, dtype_name, device_name))
+    api = llaisys.RuntimeAPI(qweight_.device_type())
+    for t, t_ in ((qweight, qweight_), (scales, scales_)):
+        api.memcpy_sync(t.data_ptr(), t_.data_ptr(), t.numel() * t.element_size(), llaisys.MemcpyKind.D2D)
+
+    idx, idx_ = random_int_tensor(idx_shape, device_name, high=embd_shape[0])
+    out, out_ = zero_tensor((idx_shape[0], embd_shape[1]), dtype_name, device_name)
+    dequant = qweight.float() * (scales.float() if per_tensor else scales.float()[:, None])
+    torch_embedding(out, idx, dequant.to(out.dtype))
+    llaisys.Ops.embedding(out_, idx_, qweight_, scales_)
+
+    assert check_equal(out_, out, atol=1e-6, rtol=1e-2)
+
+
+def llaisys_tensor(torch_tensor, dtype_name, device_name):
+    _, t_ = zero_tensor(torch_tensor.shape, dtype_name, device_name)
+    api = llaisys.RuntimeAPI(t_.device_type())
+    api.memcpy_sync(
+        t_.data_ptr(),
+        torch_tensor.data_ptr(),
+        torch_tensor.numel() * torch_tensor.element_size(),
+        llaisys.MemcpyKind.D2D,
+    )
+    return t_
+
+
 if __name__ == "__main__":
     import argparse
 
@@ -58,5 +100,12 @@ if __name__ == "__main__":
             test_op_embedding(
                 idx_shape, embd_shape, dtype_name, args.device, args.profile
             )
+    for idx_shape, embd_shape in testShapes:
+        for weight_dtype_name in ("f8e4m3", "f8e5m2"):
+            for per_tensor in (False, True):
+                for dtype_name in testDtype:
+                    test_op_embedding_fp8(
+                        idx_shape, embd_shape, weight_dtype_name, per_tensor, dtype_name, args.device
+                    )
 
     print("\033[92mTest passed!\033[0m\n")
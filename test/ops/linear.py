@@ -22,8 +22,9 @@ def test_op_linear(
     rtol=1e-5,
     device_name="cpu",
     profile=False,
+    packed=False,
 ):
-    print(f"   out {out_shape}, x {x_shape}, w {w_shape}, bias {use_bias}, dtype <{dtype_name}>")
+    print(f"   out {out_shape}, x {x_shape}, w {w_shape}, bias {use_bias}, packed {packed}, dtype <{dtype_name}>")
     x, x_ = random_tensor(x_shape, dtype_name, device_name, scale=0.1)
     w, w_ = random_tensor(w_shape, dtype_name, device_name, scale=0.01)
 
@@ -31,6 +32,9 @@ def test_op_linear(
     if use_bias:
         bias, bias_ = random_tensor((w_shape[0],), dtype_name, device_name)
 
+    if packed:
+        w_ = llaisys.Ops.linear_pack_weight(w_)
+
     out, out_ = random_tensor(out_shape, dtype_name, device_name)
     torch_linear(out, x, w, bias)
     llaisys.Ops.linear(out_, x_, w_, bias_)
@@ -55,6 +59,10 @@ if __name__ == "__main__":
     testShapes = [
         ((2, 3), (2, 4), (3, 4), True),
         ((512, 4096), (512, 4096), (4096, 4096), True),
+        ((13, 37), (13, 70), (37, 70), False),
+        ((128, 8960), (128, 1536), (8960, 1536), False),
+        ((1, 8960), (1, 1536), (8960, 1536), True),
+        ((6, 37), (6, 70), (37, 70), True),
     ]
     testDtypePrec = [
         # type, atol, rtol
@@ -66,5 +74,7 @@ if __name__ == "__main__":
     for shapes in testShapes:
         for dtype_name, atol, rtol in testDtypePrec:
             test_op_linear(*shapes, dtype_name, atol, rtol, args.device, args.profile)
+            if args.device == "cpu":
+                test_op_linear(*shapes, dtype_name, atol, rtol, args.device, args.profile, packed=True)
 
     print("\033[92mTest passed!\033[0m\n")
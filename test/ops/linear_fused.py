@@ -0,0 +1,108 @@
+import sys
+import os
+
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.insert(0, parent_dir)
+import llaisys
+import torch
+from test_utils import random_tensor, check_equal, benchmark
+
+
+def torch_activation(x, activation):
+    if activation == llaisys.Activation.RELU:
+        return torch.relu(x)
+    if activation == llaisys.Activation.SILU:
+        return torch.nn.functional.silu(x)
+    if activation == llaisys.Activation.GELU:
+        return torch.nn.functional.gelu(x)
+    return x
+
+
+def torch_linear_fused(x, w, bias, residual, activation):
+    out = torch.nn.functional.linear(x.float(), w.float(), bias.float() if bias is not None else None)
+    out = torch_activation(out, activation)
+    if residual is not None:
+        out = out + residual.float()
+    return out.to(x.dtype)
+
+
+def test_op_linear_fused(
+    out_shape,
+    x_shape,
+    w_shape,
+    use_bias=True,
+    residual_mode="none",
+    activation=llaisys.Activation.NONE,
+    dtype_name="f32",
+    atol=1e-5,
+    rtol=1e-5,
+    device_name="cpu",
+    profile=False,
+):
+    print(
+        f"   out {out_shape}, x {x_shape}, w {w_shape}, bias {use_bias}, residual {residual_mode}, "
+        f"activation {activation.name}, dtype <{dtype_name}>"
+    )
+    x, x_ = random_tensor(x_shape, dtype_name, device_name, scale=0.1)
+    w, w_ = random_tensor(w_shape, dtype_name, device_name, scale=0.1)
+
+    bias, bias_ = None, None
+    if use_bias:
+        bias, bias_ = random_tensor((w_shape[0],), dtype_name, device_name)
+
+    out, out_ = random_tensor(out_shape, dtype_name, device_name)
+    residual, residual_ = None, None
+    if residual_mode == "inplace":
+        # Accumulate into the destination, as the residual connection of a layer does.
+        residual, residual_ = out.clone(), out_
+    elif residual_mode == "separate":
+        residual, residual_ = random_tensor(out_shape, dtype_name, device_name)
+
+    expected = torch_linear_fused(x, w, bias, residual, activation)
+    llaisys.Ops.linear_fused(out_, x_, w_, bias_, residual_, activation)
+
+    assert check_equal(out_, expected, atol=atol, rtol=rtol)
+
+    if profile:
+        benchmark(
+            lambda: torch_linear_fused(x, w, bias, residual, activation),
+            lambda: llaisys.Ops.linear_fused(out_, x_, w_, bias_, residual_, activation),
+            device_name,
+        )
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
+    parser.add_argument("--profile", action="store_true")
+    args = parser.parse_args()
+    testShapes = [
+        ((2, 3), (2, 4), (3, 4), True),
+        ((13, 37), (13, 70), (37, 70), False),
+        ((1, 1536), (1, 1536), (1536, 1536), False),
+        ((1, 1536), (1, 8960), (1536, 8960), False),
+        ((128, 1536), (128, 8960), (1536, 8960), False),
+    ]
+    testDtypePrec = [
+        # type, atol, rtol
+        ("f32", 1e-5, 1e-5),
+        ("f16", 1e-3, 1e-3),
+        ("bf16", 1e-2, 1e-2),
+    ]
+    print(f"Testing Ops.linear_fused on {args.device}")
+    for out_shape, x_shape, w_shape, use_bias in testShapes:
+        for dtype_name, atol, rtol in testDtypePrec:
+            for residual_mode in ("none", "separate", "inplace"):
+                test_op_linear_fused(
+                    out_shape, x_shape, w_shape, use_bias, residual_mode, llaisys.Activation.NONE,
+                    dtype_name, atol, rtol, args.device, args.profile,
+                )
+            for activation in (llaisys.Activation.RELU, llaisys.Activation.SILU, llaisys.Activation.GELU):
+                test_op_linear_fused(
+                    out_shape, x_shape, w_shape, use_bias, "none", activation,
+                    dtype_name, atol, rtol, args.device, args.profile,
+                )
+
+    print("\033[92mTest passed!\033[0m\n")
@@ -0,0 +1,100 @@
+import sys
+import os
+
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.insert(0, parent_dir)
+import llaisys
+import torch
+from test_utils import random_tensor, zero_tensor, check_equal, benchmark
+
+
+def torch_qkv(x, wq, wk, wv, bq, bk, bv):
+    return (
+        torch.nn.functional.linear(x, wq, bq),
+        torch.nn.functional.linear(x, wk, bk),
+        torch.nn.functional.linear(x, wv, bv),
+    )
+
+
+def test_op_linear_qkv(
+    seqlen,
+    hidden_size,
+    nhead,
+    nkvhead,
+    head_dim,
+    use_bias=True,
+    dtype_name="f32",
+    atol=1e-5,
+    rtol=1e-5,
+    device_name="cpu",
+    profile=False,
+    packed=False,
+):
+    print(
+        f"   seqlen {seqlen}, hidden {hidden_size}, heads {nhead}/{nkvhead}x{head_dim}, "
+        f"bias {use_bias}, packed {packed}, dtype <{dtype_name}>"
+    )
+    x, x_ = random_tensor((seqlen, hidden_size), dtype_name, device_name, scale=0.1)
+    wq, wq_ = random_tensor((nhead * head_dim, hidden_size), dtype_name, device_name, scale=0.01)
+    wk, wk_ = random_tensor((nkvhead * head_dim, hidden_size), dtype_name, device_name, scale=0.01)
+    wv, wv_ = random_tensor((nkvhead * head_dim, hidden_size), dtype_name, device_name, scale=0.01)
+
+    bq, bk, bv, bias_ = None, None, None, None
+    if use_bias:
+        bq, bq_ = random_tensor((nhead * head_dim,), dtype_name, device_name)
+        bk, bk_ = random_tensor((nkvhead * head_dim,), dtype_name, device_name)
+        bv, bv_ = random_tensor((nkvhead * head_dim,), dtype_name, device_name)
+        bias_ = llaisys.Ops.linear_concat([bq_, bk_, bv_])
+
+    w_ = llaisys.Ops.linear_concat([wq_, wk_, wv_])
+    if packed:
+        w_ = llaisys.Ops.linear_pack_weight(w_)
+
+    # The outputs are written with the head layout consumed by rope and self_attention.
+    _, q_ = zero_tensor((seqlen, nhead, head_dim), dtype_name, device_name)
+    _, k_ = zero_tensor((seqlen, nkvhead, head_dim), dtype_name, device_name)
+    _, v_ = zero_tensor((seqlen, nkvhead, head_dim), dtype_name, device_name)
+    q, k, v = torch_qkv(x, wq, wk, wv, bq, bk, bv)
+    llaisys.Ops.linear_qkv(q_, k_, v_, x_, w_, bias_)
+
+    assert check_equal(q_, q.view(seqlen, nhead, head_dim), atol=atol, rtol=rtol)
+    assert check_equal(k_, k.view(seqlen, nkvhead, head_dim), atol=atol, rtol=rtol)
+    assert check_equal(v_, v.view(seqlen, nkvhead, head_dim), atol=atol, rtol=rtol)
+
+    if profile:
+        benchmark(
+            lambda: torch_qkv(x, wq, wk, wv, bq, bk, bv),
+            lambda: llaisys.Ops.linear_qkv(q_, k_, v_, x_, w_, bias_),
+            device_name,
+        )
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
+    parser.add_argument("--profile", action="store_true")
+    args = parser.parse_args()
+    testShapes = [
+        # seqlen, hidden size, heads, kv heads, head dim, bias
+        (2, 16, 4, 2, 4, True),
+        (13, 70, 5, 1, 6, False),
+        (1, 1536, 12, 2, 128, True),
+        (4, 1536, 12, 2, 128, True),
+        (128, 1536, 12, 2, 128, True),
+    ]
+    testDtypePrec = [
+        # type, atol, rtol
+        ("f32", 1e-5, 1e-5),
+        ("f16", 1e-3, 1e-3),
+        ("bf16", 1e-2, 1e-2),
+    ]
+    print(f"Testing Ops.linear_qkv on {args.device}")
+    for shapes in testShapes:
+        for dtype_name, atol, rtol in testDtypePrec:
+            test_op_linear_qkv(*shapes, dtype_name, atol, rtol, args.device, args.profile)
+            if args.device == "cpu":
+                test_op_linear_qkv(*shapes, dtype_name, atol, rtol, args.device, args.profile, packed=True)
+
+    print("\033[92mTest passed!\033[0m\n")
@@ -0,0 +1,182 @@
+import sys
+import os
+
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.insert(0, parent_dir)
+import llaisys
+import torch
+from test_utils import random_tensor, zero_tensor, check_equal, benchmark
+
+
+def read_tensor(llaisys_tensor: llaisys.Tensor, torch_tensor: torch.Tensor):
+    api = llaisys.RuntimeAPI(llaisys_tensor.device_type())
+    api.memcpy_sync(
+        torch_tensor.data_ptr(),
+        llaisys_tensor.data_ptr(),
+        torch_tensor.numel() * torch_tensor.element_size(),
+        llaisys.MemcpyKind.D2D,
+    )
+    return torch_tensor
+
+
+def unpack_int4(qweight):
+    # Blocks of 32 values in 16 bytes: byte j holds value j (low nibble) and j + 16.
+    out_features = qweight.shape[0]
+    blocks = qweight.view(out_features, -1, 16)
+    return torch.cat([blocks & 0xF, blocks >> 4], dim=-1).reshape(out_features, -1)
+
+
+def test_op_linear_quantized(
+    out_shape,
+    x_shape,
+    w_shape,
+    qtype,
+    group_size,
+    zero_points=False,
+    use_bias=True,
+    dtype_name="f32",
+    scale_dtype_name="f32",
+    atol=1e-5,
+    rtol=1e-5,
+    device_name="cpu",
+    profile=False,
+):
+    # qtype is "i8", "int4" or an fp8 dtype name; a group size of None gives a single
+    # per-tensor scale.
+    out_features, in_features = w_shape
+    per_tensor = group_size is None
+    if per_tensor:
+        group_size = in_features
+    groups = in_features // group_size
+    print(
+        f"   out {out_shape}, x {x_shape}, w {w_shape}, {qtype}, group {'tensor' if per_tensor else group_size}, "
+        f"zero points {zero_points}, bias {use_bias}, dtype <{dtype_name}>, scales <{scale_dtype_name}>"
+    )
+    x, x_ = random_tensor(x_shape, dtype_name, device_name, scale=0.1)
+    w, w_ = random_tensor(w_shape, dtype_name, device_name, scale=0.02, bias=-0.01)
+
+    bias, bias_ = None, None
+    if use_bias:
+        bias, bias_ = random_tensor((out_features,), dtype_name, device_name)
+
+    if qtype == "int4":
+        qweight, qweight_ = zero_tensor((out_features, in_features // 2), "u8", device_name)
+    else:
+        qweight, qweight_ = zero_tensor(w_shape, qtype, device_name)
+    if per_tensor:
+        scales, scales_ = zero_tensor((1,), scale_dtype_name, device_name)
+    else:
+        scales, scales_ = zero_tensor((out_features, groups), scale_dtype_name, device_name)
+    zeros, zeros_ = None, None
+    if zero_points:
+        zeros, zeros_ = zero_tensor((out_features, groups), "u8", device_name)
+    llaisys.Ops.linear_quantize(qweight_, scales_, w_, zeros_)
+    read_tensor(qweight_, qweight)
+    read_tensor(scales_, scales)
+
+    if qtype == "int4":
+        levels = unpack_int4(qweight).float()
+        if zero_points:
+            levels -= read_tensor(zeros_, zeros).float().repeat_interleave(group_size, dim=1)
+        else:
+            levels -= 8
+    else:
+        levels = qweight.float()
+
+    scale = scales.float().reshape(-1, groups).repeat_interleave(group_size, dim=1)
+    dequant = levels * scale
+    if qtype.startswith("f8"):
+        # Each weight is rounded to the nearest fp8 value: within half a mantissa step
+        # of its magnitude, or of the smallest subnormal times the scale.
+        mantissa_bits, min_subnormal = (3, 2.0**-9) if qtype == "f8e4m3" else (2, 2.0**-16)
+        bound = (w.float().abs() * 2.0 ** -(mantissa_bits + 1) + scale * min_subnormal) * 1.01
+    elif qtype == "i8":
+        # Rounding to nearest keeps every weight within half a step of its scale.
+        bound = scale * 0.5
+    else:
+        # As int8, but the rounded zero point of a group shifts its levels a little.
+        bound = scale * 0.6 * 1.01
+    assert torch.all((dequant - w.float()).abs() <= bound + 1e-6)
+
+    # The kernel computes exactly the product with the dequantized weight.
+    _, out_ = zero_tensor(out_shape, dtype_name, device_name)
+    out = torch.nn.functional.linear(
+        x.float(), dequant, bias.float() if use_bias else None
+    ).to(x.dtype)
+    llaisys.Ops.linear_quantized(out_, x_, qweight_, scales_, bias_, zeros_)
+    assert check_equal(out_, out, atol=atol, rtol=rtol)
+
+    dense_out = torch.nn.functional.linear(x, w, bias)
+    error = (out.float() - dense_out.float()).norm() / dense_out.float().norm()
+    print(f"        relative error against the {dtype_name} weight: {error:.2e}")
+
+    if profile:
+        _, dense_out_ = zero_tensor(out_shape, dtype_name, device_name)
+        print(f"        {dtype_name} weight:")
+        benchmark(
+            lambda: torch.nn.functional.linear(x, w, bias),
+            lambda: llaisys.Ops.linear(dense_out_, x_, w_, bias_),
+            device_name,
+        )
+        print(f"        {qtype} weight:")
+        benchmark(
+            lambda: torch.nn.functional.linear(x, w, bias),
+            lambda: llaisys.Ops.linear_quantized(out_, x_, qweight_, scales_, bias_, zeros_),
+            device_name,
+        )
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
+    parser.add_argument("--profile", action="store_true")
+    args = parser.parse_args()
+    testInt8Shapes = [
+        # out, x, w, group size, bias
+        ((2, 3), (2, 4), (3, 4), 4, True),
+        ((13, 37), (13, 70), (37, 70), 70, False),
+        ((6, 37), (6, 128), (37, 128), 32, True),
+        ((1, 8960), (1, 1536), (8960, 1536), 1536, False),
+        ((1, 8960), (1, 1536), (8960, 1536), 128, True),
+        ((4, 1536), (4, 8960), (1536, 8960), 64, False),
+        ((128, 8960), (128, 1536), (8960, 1536), 128, False),
+        ((13, 37), (13, 70), (37, 70), None, True),
+        ((1, 8960), (1, 1536), (8960, 1536), None, False),
+    ]
+    testInt4Shapes = [
+        # out, x, w, group size, bias
+        ((2, 3), (2, 64), (3, 64), 32, True),
+        ((13, 37), (13, 96), (37, 96), 32, False),
+        ((6, 37), (6, 256), (37, 256), 128, True),
+        ((1, 8960), (1, 1536), (8960, 1536), 32, False),
+        ((1, 8960), (1, 1536), (8960, 1536), 64, True),
+        ((1, 8960), (1, 1536), (8960, 1536), 128, False),
+        ((4, 1536), (4, 8960), (1536, 8960), 128, False),
+        ((128, 8960), (128, 1536), (8960, 1536), 64, False),
+    ]
+    testDtypePrec = [
+        # type, scale type, atol, rtol
+        ("f32", "f32", 1e-4, 1e-4),
+        ("f16", "f16", 1e-3, 1e-3),
+        ("bf16", "bf16", 1e-2, 1e-2),
+        ("bf16", "f16", 1e-2, 1e-2),
+    ]
+    print(f"Testing Ops.linear_quantized on {args.device}")
+    for qtype in ("i8", "f8e4m3", "f8e5m2"):
+        for out_shape, x_shape, w_shape, group_size, use_bias in testInt8Shapes:
+            for dtype_name, scale_dtype_name, atol, rtol in testDtypePrec:
+                test_op_linear_quantized(
+                    out_shape, x_shape, w_shape, qtype, group_size, False, use_bias,
+                    dtype_name, scale_dtype_name, atol, rtol, args.device, args.profile,
+                )
+    for out_shape, x_shape, w_shape, group_size, use_bias in testInt4Shapes:
+        for zero_points in (False, True):
+            for dtype_name, scale_dtype_name, atol, rtol in testDtypePrec:
+                test_op_linear_quantized(
+                    out_shape, x_shape, w_shape, "int4", group_size, zero_points, use_bias,
+                    dtype_name, scale_dtype_name, atol, rtol, args.device, args.profile,
+                )
+
+    print("\033[92mTest passed!\033[0m\n")
@@ -0,0 +1,90 @@
+import sys
+import os
+
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.insert(0, parent_dir)
+import llaisys
+import torch
+from test_utils import random_tensor, zero_tensor, check_equal, benchmark
+
+
+def torch_mlp_up(x, w_gate, w_up, b_gate, b_up):
+    gate = torch.nn.functional.linear(x.float(), w_gate.float(), b_gate.float() if b_gate is not None else None)
+    up = torch.nn.functional.linear(x.float(), w_up.float(), b_up.float() if b_up is not None else None)
+    return (up * torch.nn.functional.silu(gate)).to(x.dtype)
+
+
+def test_op_linear_swiglu(
+    seqlen,
+    hidden_size,
+    intermediate_size,
+    use_bias=False,
+    dtype_name="f32",
+    atol=1e-5,
+    rtol=1e-5,
+    device_name="cpu",
+    profile=False,
+    packed=False,
+):
+    print(
+        f"   seqlen {seqlen}, hidden {hidden_size}, intermediate {intermediate_size}, "
+        f"bias {use_bias}, packed {packed}, dtype <{dtype_name}>"
+    )
+    x, x_ = random_tensor((seqlen, hidden_size), dtype_name, device_name, scale=0.1)
+    w_gate, w_gate_ = random_tensor((intermediate_size, hidden_size), dtype_name, device_name, scale=0.1)
+    w_up, w_up_ = random_tensor((intermediate_size, hidden_size), dtype_name, device_name, scale=0.1)
+
+    b_gate, b_up, bias_ = None, None, None
+    if use_bias:
+        b_gate, b_gate_ = random_tensor((intermediate_size,), dtype_name, device_name)
+        b_up, b_up_ = random_tensor((intermediate_size,), dtype_name, device_name)
+        bias_ = llaisys.Ops.linear_swiglu_interleave(b_gate_, b_up_)
+
+    w_ = llaisys.Ops.linear_swiglu_interleave(w_gate_, w_up_)
+    if packed:
+        w_ = llaisys.Ops.linear_pack_weight(w_)
+
+    _, out_ = zero_tensor((seqlen, intermediate_size), dtype_name, device_name)
+    out = torch_mlp_up(x, w_gate, w_up, b_gate, b_up)
+    llaisys.Ops.linear_swiglu(out_, x_, w_, bias_)
+
+    assert check_equal(out_, out, atol=atol, rtol=rtol)
+
+    if profile:
+        benchmark(
+            lambda: torch_mlp_up(x, w_gate, w_up, b_gate, b_up),
+            lambda: llaisys.Ops.linear_swiglu(out_, x_, w_, bias_),
+            device_name,
+        )
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
+    parser.add_argument("--profile", action="store_true")
+    args = parser.parse_args()
+    testShapes = [
+        # seqlen, hidden size, intermediate size, bias
+        (2, 4, 3, True),
+        (13, 70, 37, False),
+        (6, 64, 130, True),
+        (1, 1536, 8960, False),
+        (4, 1536, 8960, False),
+        (128, 1536, 8960, False),
+    ]
+    testDtypePrec = [
+        # type, atol, rtol
+        ("f32", 1e-5, 1e-5),
+        ("f16", 1e-3, 1e-3),
+        ("bf16", 1e-2, 1e-2),
+    ]
+    print(f"Testing Ops.linear_swiglu on {args.device}")
+    for shapes in testShapes:
+        for dtype_name, atol, rtol in testDtypePrec:
+            test_op_linear_swiglu(*shapes, dtype_name, atol, rtol, args.device, args.profile)
+            if args.device == "cpu":
+                test_op_linear_swiglu(*shapes, dtype_name, atol, rtol, args.device, args.profile, packed=True)
+
+    print("\033[92mTest passed!\033[0m\n")
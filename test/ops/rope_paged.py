@@ -0,0 +1,145 @@
+import sys
+import os
+
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.insert(0, parent_dir)
+import llaisys
+import torch
+from rope import torch_rope
+from self_attention_paged import write_tensor
+from test_utils import random_tensor, zero_tensor, check_equal, benchmark
+
+
+def read_tensor(llaisys_tensor: llaisys.Tensor, torch_tensor: torch.Tensor):
+    api = llaisys.RuntimeAPI(llaisys_tensor.device_type())
+    api.memcpy_sync(
+        torch_tensor.data_ptr(),
+        llaisys_tensor.data_ptr(),
+        torch_tensor.numel() * torch_tensor.element_size(),
+        llaisys.MemcpyKind.D2D,
+    )
+    return torch_tensor
+
+
+def test_op_rope_paged(
+    n,
+    nh,
+    nkvh,
+    hd,
+    block_size,
+    nblocks,
+    npos,
+    dtype_name="f32",
+    kv_dtype_name=None,
+    atol=1e-5,
+    rtol=1e-5,
+    device_name="cpu",
+    profile=False,
+):
+    print(
+        f"   n={n} nh={nh} nkvh={nkvh} hd={hd} block_size={block_size} nblocks={nblocks} "
+        f"table={npos} dtype <{dtype_name}> cache <{kv_dtype_name or dtype_name}>"
+    )
+    theta = 10000.0
+    q, q_ = random_tensor((n, nh, hd), dtype_name, device_name)
+    k, k_ = random_tensor((n, nkvh, hd), dtype_name, device_name)
+    v, v_ = random_tensor((n, nkvh, hd), dtype_name, device_name)
+    cache_shape = (nblocks, block_size, nkvh, hd)
+    k_cache, k_cache_ = zero_tensor(cache_shape, kv_dtype_name or dtype_name, device_name)
+    v_cache, v_cache_ = zero_tensor(cache_shape, kv_dtype_name or dtype_name, device_name)
+    k_scales = v_scales = k_scales_ = v_scales_ = None
+    if kv_dtype_name is not None:
+        k_scales, k_scales_ = zero_tensor(cache_shape[:-1], "f32", device_name)
+        v_scales, v_scales_ = zero_tensor(cache_shape[:-1], "f32", device_name)
+
+    # Positions of a few sequences, partly past the end of the table, stored in
+    # scattered rows of the pool.
+    pos_ids, pos_ids_ = zero_tensor((n,), "i64", device_name)
+    slots, slots_ = zero_tensor((n,), "i64", device_name)
+    pos_ids.copy_(torch.randint(0, 2 * npos, (n,)))
+    slots.copy_(torch.randperm(nblocks * block_size)[:n])
+    write_tensor(pos_ids_, pos_ids)
+    write_tensor(slots_, slots)
+    _, table_ = zero_tensor((npos, hd), "f32", device_name)
+    llaisys.Ops.rope_table(table_, theta)
+
+    q_out = torch.zeros_like(q)
+    k_rot = torch.zeros_like(k)
+    torch_rope(q_out, q, pos_ids, theta)
+    torch_rope(k_rot, k, pos_ids, theta)
+    _, q_out_ = zero_tensor((n, nh, hd), dtype_name, device_name)
+    llaisys.Ops.rope_paged(
+        q_out_, k_cache_, v_cache_, q_, k_, v_, pos_ids_, slots_, table_, theta, k_scales_, v_scales_
+    )
+    assert check_equal(q_out_, q_out, atol=atol, rtol=rtol)
+
+    # Only the given rows of the caches are written.
+    if kv_dtype_name is None:
+        k_cache.view(-1, nkvh, hd)[slots] = k_rot
+        v_cache.view(-1, nkvh, hd)[slots] = v
+        assert check_equal(k_cache_, k_cache, atol=atol, rtol=rtol)
+        assert check_equal(v_cache_, v_cache, strict=True)
+    else:
+        for cache_, scales_, cache, scales, expected in (
+            (k_cache_, k_scales_, k_cache, k_scales, k_rot),
+            (v_cache_, v_scales_, v_cache, v_scales, v),
+        ):
+            read_tensor(cache_, cache)
+            read_tensor(scales_, scales)
+            stored = cache.float() * scales.unsqueeze(-1)
+            assert torch.allclose(stored.view(-1, nkvh, hd)[slots], expected.float(), atol=atol, rtol=rtol)
+            assert not stored.view(-1, nkvh, hd)[slots].eq(0).all()
+
+    if profile:
+
+        def torch_rope_paged():
+            torch_rope(q_out, q, pos_ids, theta)
+            torch_rope(k_rot, k, pos_ids, theta)
+            k_cache.view(-1, nkvh, hd)[slots] = k_rot.to(k_cache.dtype)
+            v_cache.view(-1, nkvh, hd)[slots] = v.to(v_cache.dtype)
+
+        benchmark(
+            torch_rope_paged,
+            lambda: llaisys.Ops.rope_paged(
+                q_out_, k_cache_, v_cache_, q_, k_, v_, pos_ids_, slots_, table_, theta, k_scales_, v_scales_
+            ),
+            device_name,
+        )
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
+    parser.add_argument("--profile", action="store_true")
+    args = parser.parse_args()
+    testShapes = [
+        # n, nh, nkvh, hd, block size, blocks in the pool, table positions
+        (2, 1, 1, 4, 4, 1, 2),
+        (9, 4, 2, 8, 4, 6, 16),
+        (512, 12, 2, 128, 16, 40, 512),
+    ]
+    testDtypePrec = [
+        # type, atol, rtol
+        ("f32", 1e-4, 1e-4),
+        ("f16", 1e-3, 1e-3),
+        ("bf16", 1e-2, 1e-2),
+    ]
+    # Quantization error on values of magnitude ~1, with the dtype's own rounding.
+    kvDtypePrec = [
+        # cache type, atol, rtol
+        ("i8", 3e-2, 1e-2),
+        ("f8e4m3", 2e-2, 7e-2),
+        ("f8e5m2", 5e-2, 1.3e-1),
+    ]
+    print(f"Testing Ops.rope_paged on {args.device}")
+    for shape in testShapes:
+        for dtype_name, atol, rtol in testDtypePrec:
+            test_op_rope_paged(*shape, dtype_name, None, atol, rtol, args.device, args.profile)
+            for kv_dtype_name, kv_atol, kv_rtol in kvDtypePrec:
+                test_op_rope_paged(
+                    *shape, dtype_name, kv_dtype_name, kv_atol + atol, kv_rtol, args.device, args.profile
+                )
+
+    print("\033[92mTest passed!\033[0m\n")
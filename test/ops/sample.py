@@ -0,0 +1,111 @@
+import sys
+import os
+
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.insert(0, parent_dir)
+import llaisys
+import torch
+from test_utils import random_tensor, zero_tensor, benchmark
+
+
+def torch_sample_probs(logits, temperature, top_k, top_p):
+    # Probability of each token once truncated: the top_k most likely (ties broken by
+    # index), then the fewest of those whose probability reaches top_p.
+    order = torch.sort(logits.float(), descending=True, stable=True).indices
+    if top_k > 0:
+        order = order[:top_k]
+    probs = torch.softmax(logits.float()[order].double() / temperature, dim=0)
+    before = probs.cumsum(0) - probs
+    probs[before >= top_p] = 0
+    out = torch.zeros(logits.numel(), dtype=torch.float64)
+    out[order] = probs / probs.sum()
+    return out
+
+
+def torch_sample(logits, temperature, top_k, top_p):
+    scores = logits.float() / temperature
+    if top_k > 0:
+        kth = torch.topk(scores, top_k).values[-1]
+        scores = scores.masked_fill(scores < kth, float("-inf"))
+    sorted_scores, order = torch.sort(scores, descending=True)
+    probs = torch.softmax(sorted_scores, dim=0)
+    sorted_scores[probs.cumsum(0) - probs > top_p] = float("-inf")
+    return order[torch.multinomial(torch.softmax(sorted_scores, dim=0), 1)]
+
+
+def sample(out_idx_, logits_, temperature, top_k, top_p, seed):
+    llaisys.Ops.sample(out_idx_, logits_, temperature, top_k, top_p, seed)
+    out_idx = torch.zeros((1,), dtype=torch.int64)
+    api = llaisys.RuntimeAPI(out_idx_.device_type())
+    api.memcpy_sync(out_idx.data_ptr(), out_idx_.data_ptr(), 8, llaisys.MemcpyKind.D2D)
+    return out_idx.item()
+
+
+def test_op_sample(
+    voc,
+    temperature,
+    top_k,
+    top_p,
+    draws,
+    dtype_name="f32",
+    device_name="cpu",
+    profile=False,
+):
+    print(f"   voc={voc} temperature={temperature} top_k={top_k} top_p={top_p} dtype <{dtype_name}>")
+    logits, logits_ = random_tensor((voc,), dtype_name, device_name, scale=8.0, bias=-4.0)
+    _, out_idx_ = zero_tensor((1,), "i64", device_name)
+
+    if temperature == 0 or top_k == 1:
+        assert sample(out_idx_, logits_, temperature, top_k, top_p, 0) == torch.argmax(logits.float()).item()
+        return
+
+    probs = torch_sample_probs(logits.cpu(), temperature, top_k, top_p)
+    # Slack for tokens at the edge of the nucleus, computed in single precision.
+    allowed = torch_sample_probs(logits.cpu(), temperature, top_k, min(top_p + 1e-4, 1.0)) > 0
+    counts = torch.zeros(voc, dtype=torch.float64)
+    for seed in range(draws):
+        token = sample(out_idx_, logits_, temperature, top_k, top_p, seed)
+        assert allowed[token], f"token {token} outside of the top_k / top_p set"
+        counts[token] += 1
+    # The draw is a function of the seed.
+    assert sample(out_idx_, logits_, temperature, top_k, top_p, 7) == sample(
+        out_idx_, logits_, temperature, top_k, top_p, 7
+    )
+    if voc <= 64:
+        assert (counts / draws - probs).abs().max() < 0.03, (counts / draws, probs)
+
+    if profile:
+        benchmark(
+            lambda: torch_sample(logits, temperature, top_k, top_p),
+            lambda: llaisys.Ops.sample(out_idx_, logits_, temperature, top_k, top_p, 0),
+            device_name,
+        )
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
+    parser.add_argument("--profile", action="store_true")
+    args = parser.parse_args()
+    testCases = [
+        # voc, temperature, top_k, top_p, draws
+        (8, 0.0, 0, 1.0, 1),
+        (4096, 1.0, 1, 1.0, 1),
+        (8, 1.0, 0, 1.0, 4000),
+        (8, 0.7, 3, 1.0, 4000),
+        (8, 1.3, 0, 0.8, 4000),
+        (8, 1.0, 5, 0.6, 4000),
+        (4096, 0.8, 50, 0.9, 200),
+        (4096, 1.0, 0, 0.95, 200),
+        (151936, 0.8, 50, 0.8, 50),
+        (151936, 1.0, 0, 1.0, 50),
+    ]
+    testDtype = ["f32", "f16", "bf16"]
+    print(f"Testing Ops.sample on {args.device}")
+    for case in testCases:
+        for dtype_name in testDtype:
+            test_op_sample(*case, dtype_name, args.device, args.profile)
+
+    print("\033[92mTest passed!\033[0m\n")
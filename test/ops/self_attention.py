@@ -72,6 +72,9 @@ if __name__ == "__main__":
         # qlen, kvlen, nh, nkvh, hd
         (2, 2, 1, 1, 4),
         (5, 11, 4, 2, 8),
+        # Several query tiles and key blocks, with partial ones at the ends.
+        (70, 200, 6, 2, 64),
+        (1, 150, 4, 2, 32),
     ]
     testDtypePrec = [
         # type, atol, rtol
@@ -0,0 +1,130 @@
+import sys
+import os
+
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.insert(0, parent_dir)
+import llaisys
+import torch
+from self_attention import torch_self_attention
+from self_attention_paged import write_tensor, random_cache
+from test_utils import random_tensor, zero_tensor, check_equal, benchmark
+
+
+def test_op_self_attention_batched(
+    qlens,
+    kvlens,
+    nh,
+    nkvh,
+    hd,
+    block_size,
+    dtype_name="f32",
+    kv_dtype_name=None,
+    atol=1e-5,
+    rtol=1e-5,
+    device_name="cpu",
+    profile=False,
+):
+    print(
+        f"   qlens={qlens} kvlens={kvlens} nh={nh} nkvh={nkvh} hd={hd} block_size={block_size} "
+        f"dtype <{dtype_name}> cache <{kv_dtype_name or dtype_name}>"
+    )
+    nseq = len(qlens)
+    used = [(kvlen + block_size - 1) // block_size for kvlen in kvlens]
+    nblocks = sum(used) + 2
+    max_blocks = max(used)
+    total_q = sum(qlens)
+    q, q_ = random_tensor((total_q, nh, hd), dtype_name, device_name)
+    k_cache, k_cache_, k_scales_ = random_cache((nblocks, block_size, nkvh, hd), dtype_name, kv_dtype_name, device_name)
+    v_cache, v_cache_, v_scales_ = random_cache((nblocks, block_size, nkvh, hd), dtype_name, kv_dtype_name, device_name)
+    scale = 1.0 / (hd**0.5)
+
+    # Each sequence owns scattered blocks of the pool; unused table entries are padding.
+    perm = torch.randperm(nblocks)
+    block_tables, block_tables_ = zero_tensor((nseq, max_blocks), "i64", device_name)
+    q_offsets, q_offsets_ = zero_tensor((nseq + 1,), "i64", device_name)
+    kv_lens, kv_lens_ = zero_tensor((nseq,), "i64", device_name)
+    block_tables.fill_(-1)
+    start = 0
+    for i in range(nseq):
+        block_tables[i, : used[i]] = perm[start : start + used[i]]
+        start += used[i]
+    q_offsets[1:] = torch.tensor(qlens).cumsum(0)
+    kv_lens.copy_(torch.tensor(kvlens))
+    for tensor_, tensor in ((block_tables_, block_tables), (q_offsets_, q_offsets), (kv_lens_, kv_lens)):
+        write_tensor(tensor_, tensor)
+
+    # Each sequence attends causally over its own keys and values, as read by the kernel in fp32.
+    attn_val = torch.zeros((total_q, nh, hd), dtype=torch.float32, device=q.device)
+    for i in range(nseq):
+        if qlens[i] == 0:
+            continue
+        table = block_tables[i, : used[i]]
+        k = k_cache[table].reshape(-1, nkvh, hd)[: kvlens[i]]
+        v = v_cache[table].reshape(-1, nkvh, hd)[: kvlens[i]]
+        rows = slice(q_offsets[i].item(), q_offsets[i + 1].item())
+        torch_self_attention(attn_val[rows], q[rows].float(), k, v, scale)
+    attn_val = attn_val.to(q.dtype)
+    _, attn_val_ = zero_tensor((total_q, nh, hd), dtype_name, device_name)
+    llaisys.Ops.self_attention_batched(
+        attn_val_, q_, k_cache_, v_cache_, block_tables_, q_offsets_, kv_lens_, scale, k_scales_, v_scales_
+    )
+    assert check_equal(attn_val_, attn_val, atol=atol, rtol=rtol)
+
+    if profile:
+        # One call for the batch against one paged call per sequence.
+        sequences = []
+        for i in range(nseq):
+            if qlens[i] == 0:
+                continue
+            table, table_ = zero_tensor((used[i],), "i64", device_name)
+            table.copy_(block_tables[i, : used[i]])
+            write_tensor(table_, table)
+            _, out_ = zero_tensor((qlens[i], nh, hd), dtype_name, device_name)
+            _, q_i_ = random_tensor((qlens[i], nh, hd), dtype_name, device_name)
+            sequences.append((out_, q_i_, table_, kvlens[i]))
+
+        def per_sequence():
+            for out_, q_i_, table_, kvlen in sequences:
+                llaisys.Ops.self_attention_paged(
+                    out_, q_i_, k_cache_, v_cache_, table_, kvlen, scale, k_scales_, v_scales_
+                )
+
+        benchmark(
+            per_sequence,
+            lambda: llaisys.Ops.self_attention_batched(
+                attn_val_, q_, k_cache_, v_cache_, block_tables_, q_offsets_, kv_lens_, scale, k_scales_, v_scales_
+            ),
+            device_name,
+        )
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
+    parser.add_argument("--profile", action="store_true")
+    args = parser.parse_args()
+    testShapes = [
+        # query lengths, key lengths, nh, nkvh, hd, block size
+        ([1], [1], 1, 1, 4, 4),
+        ([2, 3], [2, 9], 4, 2, 8, 4),
+        # A decode step, a chunk of prefill and an empty sequence in one batch.
+        ([1, 1, 7, 0, 40, 1], [1, 300, 7, 5, 100, 33], 6, 2, 64, 16),
+        ([1] * 16, [256 + 97 * i for i in range(16)], 12, 2, 128, 16),
+    ]
+    testDtypePrec = [
+        # type, atol, rtol
+        ("f32", 1e-5, 1e-5),
+        ("f16", 1e-3, 1e-3),
+        ("bf16", 1e-2, 1e-2),
+    ]
+    print(f"Testing Ops.self_attention_batched on {args.device}")
+    for shape in testShapes:
+        for kv_dtype_name in (None, "i8", "f8e4m3"):
+            for dtype_name, atol, rtol in testDtypePrec:
+                test_op_self_attention_batched(
+                    *shape, dtype_name, kv_dtype_name, atol, rtol, args.device, args.profile
+                )
+
+    print("\033[92mTest passed!\033[0m\n")
@@ -0,0 +1,119 @@
+import sys
+import os
+
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.insert(0, parent_dir)
+import llaisys
+import torch
+from self_attention import torch_self_attention
+from test_utils import random_tensor, zero_tensor, check_equal, benchmark
+
+
+def write_tensor(llaisys_tensor: llaisys.Tensor, torch_tensor: torch.Tensor):
+    api = llaisys.RuntimeAPI(llaisys_tensor.device_type())
+    api.memcpy_sync(
+        llaisys_tensor.data_ptr(),
+        torch_tensor.data_ptr(),
+        torch_tensor.numel() * torch_tensor.element_size(),
+        llaisys.MemcpyKind.D2D,
+    )
+
+
+def random_cache(shape, dtype_name, kv_dtype_name, device_name):
+    # Returns the cache as read by the kernel in fp32, the llaisys cache and its scales.
+    if kv_dtype_name is None:
+        cache, cache_ = random_tensor(shape, dtype_name, device_name)
+        return cache.float(), cache_, None
+    cache, cache_ = zero_tensor(shape, kv_dtype_name, device_name)
+    if kv_dtype_name == "i8":
+        cache.copy_(torch.randint(-127, 128, shape, dtype=torch.int8))
+    else:
+        cache.copy_(torch.randn(shape).to(cache.dtype))
+    write_tensor(cache_, cache)
+    scales, scales_ = random_tensor(shape[:-1], "f32", device_name, scale=0.02)
+    return cache.float() * scales.unsqueeze(-1), cache_, scales_
+
+
+def test_op_self_attention_paged(
+    qlen,
+    kvlen,
+    nh,
+    nkvh,
+    hd,
+    block_size,
+    nblocks,
+    dtype_name="f32",
+    kv_dtype_name=None,
+    atol=1e-5,
+    rtol=1e-5,
+    device_name="cpu",
+    profile=False,
+):
+    print(
+        f"   qlen={qlen} kvlen={kvlen} nh={nh} nkvh={nkvh} hd={hd} block_size={block_size} "
+        f"nblocks={nblocks} dtype <{dtype_name}> cache <{kv_dtype_name or dtype_name}>"
+    )
+    q, q_ = random_tensor((qlen, nh, hd), dtype_name, device_name)
+    k_cache, k_cache_, k_scales_ = random_cache((nblocks, block_size, nkvh, hd), dtype_name, kv_dtype_name, device_name)
+    v_cache, v_cache_, v_scales_ = random_cache((nblocks, block_size, nkvh, hd), dtype_name, kv_dtype_name, device_name)
+    scale = 1.0 / (hd**0.5)
+
+    # The sequence owns scattered blocks of the pool, in any order.
+    used = (kvlen + block_size - 1) // block_size
+    block_table, block_table_ = zero_tensor((used,), "i64", device_name)
+    block_table.copy_(torch.randperm(nblocks)[:used])
+    write_tensor(block_table_, block_table)
+    k = k_cache[block_table].reshape(-1, nkvh, hd)[:kvlen]
+    v = v_cache[block_table].reshape(-1, nkvh, hd)[:kvlen]
+
+    # Keys and values reach the kernel in fp32, dequantized if need be.
+    attn_val = torch.zeros((qlen, nh, hd), dtype=torch.float32, device=q.device)
+    torch_self_attention(attn_val, q.float(), k, v, scale)
+    attn_val = attn_val.to(q.dtype)
+    _, attn_val_ = zero_tensor((qlen, nh, hd), dtype_name, device_name)
+    llaisys.Ops.self_attention_paged(
+        attn_val_, q_, k_cache_, v_cache_, block_table_, kvlen, scale, k_scales_, v_scales_
+    )
+    assert check_equal(attn_val_, attn_val, atol=atol, rtol=rtol)
+
+    if profile:
+        benchmark(
+            lambda: torch_self_attention(attn_val, q, k.to(q.dtype), v.to(q.dtype), scale),
+            lambda: llaisys.Ops.self_attention_paged(
+                attn_val_, q_, k_cache_, v_cache_, block_table_, kvlen, scale, k_scales_, v_scales_
+            ),
+            device_name,
+        )
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
+    parser.add_argument("--profile", action="store_true")
+    args = parser.parse_args()
+    testShapes = [
+        # qlen, kvlen, nh, nkvh, hd, block size, blocks in the pool
+        (2, 2, 1, 1, 4, 4, 3),
+        (5, 11, 4, 2, 8, 4, 6),
+        # Blocks smaller and larger than the kernel's key blocks, the last one partial.
+        (70, 200, 6, 2, 64, 16, 20),
+        (1, 150, 4, 2, 32, 128, 4),
+        (1, 1000, 12, 2, 128, 16, 80),
+    ]
+    testDtypePrec = [
+        # type, atol, rtol
+        ("f32", 1e-5, 1e-5),
+        ("f16", 1e-3, 1e-3),
+        ("bf16", 1e-2, 1e-2),
+    ]
+    print(f"Testing Ops.self_attention_paged on {args.device}")
+    for shape in testShapes:
+        for kv_dtype_name in (None, "i8", "f8e4m3", "f8e5m2"):
+            for dtype_name, atol, rtol in testDtypePrec:
+                test_op_self_attention_paged(
+                    *shape, dtype_name, kv_dtype_name, atol, rtol, args.device, args.profile
+                )
+
+    print("\033[92mTest passed!\033[0m\n")
@@ -0,0 +1,203 @@
+import json
+import os
+from ctypes import byref, c_int64
+
+import llaisys
+import torch
+from llaisys.libllaisys import LIB_LLAISYS, LlaisysQwen2CacheStats
+from safetensors.torch import load_file, save_file
+
+# A Qwen2 small enough to check against a float64 reference in a test.
+CONFIG = {
+    "torch_dtype": "float32",
+    "num_hidden_layers": 2,
+    "hidden_size": 64,
+    "num_attention_heads": 4,
+    "num_key_value_heads": 2,
+    "intermediate_size": 128,
+    "max_position_embeddings": 128,
+    "vocab_size": 151,
+    "rms_norm_eps": 1e-6,
+    "rope_theta": 10000.0,
+    "eos_token_id": 150,
+    "tie_word_embeddings": False,
+}
+
+
+def write_checkpoint(path, seed=0):
+    # Random weights of CONFIG, scaled so that the logits are spread out.
+    c = CONFIG
+    hs, di, voc = c["hidden_size"], c["intermediate_size"], c["vocab_size"]
+    dh = hs // c["num_attention_heads"]
+    kv = c["num_key_value_heads"] * dh
+    generator = torch.Generator().manual_seed(seed)
+
+    def randn(*shape, scale=1.0):
+        return torch.randn(shape, generator=generator) * scale
+
+    weights = {
+        "model.embed_tokens.weight": randn(voc, hs),
+        "model.norm.weight": 1 + randn(hs, scale=0.1),
+        "lm_head.weight": randn(voc, hs, scale=0.2),
+    }
+    for i in range(c["num_hidden_layers"]):
+        p = f"model.layers.{i}."
+        weights[p + "input_layernorm.weight"] = 1 + randn(hs, scale=0.1)
+        weights[p + "post_attention_layernorm.weight"] = 1 + randn(hs, scale=0.1)
+        for name, n in [("q", hs), ("k", kv), ("v", kv)]:
+            weights[p + f"self_attn.{name}_proj.weight"] = randn(n, hs, scale=0.15)
+            weights[p + f"self_attn.{name}_proj.bias"] = randn(n, scale=0.3)
+        weights[p + "self_attn.o_proj.weight"] = randn(hs, hs, scale=0.15)
+        weights[p + "mlp.gate_proj.weight"] = randn(di, hs, scale=0.15)
+        weights[p + "mlp.up_proj.weight"] = randn(di, hs, scale=0.15)
+        weights[p + "mlp.down_proj.weight"] = randn(hs, di, scale=0.1)
+
+    os.makedirs(path, exist_ok=True)
+    save_file(weights, os.path.join(path, "model.safetensors"))
+    with open(os.path.join(path, "config.json"), "w") as f:
+        json.dump(c, f)
+
+
+class Reference:
+    # The checkpoint of write_checkpoint in float64, computed incrementally over a cache
+    # of unrotated keys and values. With a window, the cache mirrors a streaming one:
+    # whole blocks after the sinks are dropped to make room, the kept keys are rotated
+    # at their positions and the sinks just before the oldest kept one.
+
+    def __init__(self, path, sinks=0, window=0, block_size=16):
+        c = CONFIG
+        self.w = {
+            k: v.to(torch.float64)
+            for k, v in load_file(os.path.join(path, "model.safetensors")).items()
+        }
+        self.nlayer = c["num_hidden_layers"]
+        self.nh = c["num_attention_heads"]
+        self.nkvh = c["num_key_value_heads"]
+        self.dh = c["hidden_size"] // self.nh
+        self.eps = c["rms_norm_eps"]
+        self.theta = c["rope_theta"]
+        self.block_size = block_size
+        self.sinks = (sinks + block_size - 1) // block_size * block_size
+        self.capacity = self.sinks + window if window > 0 else None
+        self.keys = [torch.zeros(0, self.nkvh, self.dh, dtype=torch.float64)] * self.nlayer
+        self.values = list(self.keys)
+        self.evicted = 0
+
+    def _norm(self, x, w):
+        return x * torch.rsqrt(x.pow(2).mean(-1, keepdim=True) + self.eps) * w
+
+    def _rope(self, x, pos):
+        half = self.dh // 2
+        freqs = self.theta ** (-torch.arange(half, dtype=torch.float64) * 2 / self.dh)
+        angles = pos.to(torch.float64)[:, None] * freqs[None]
+        cos, sin = angles.cos()[:, None], angles.sin()[:, None]
+        a, b = x[..., :half], x[..., half:]
+        return torch.cat([a * cos - b * sin, b * cos + a * sin], -1)
+
+    def forward(self, tokens):
+        # Append tokens in one pass and return the logits [voc] of the last one.
+        n = len(tokens)
+        if self.capacity is not None:
+            while self.keys[0].shape[0] + n > self.capacity:
+                drop = slice(self.sinks, self.sinks + self.block_size)
+                for cache in (self.keys, self.values):
+                    for i in range(self.nlayer):
+                        cache[i] = torch.cat([cache[i][: drop.start], cache[i][drop.stop :]])
+                self.evicted += self.block_size
+        # Slot s holds position s + evicted, the sinks included.
+        length = self.keys[0].shape[0]
+        key_pos = torch.arange(length + n) + self.evicted
+        query_pos = key_pos[length:]
+        mask = torch.ones(n, length + n, dtype=torch.bool).tril(length)
+
+        w = self.w
+        x = w["model.embed_tokens.weight"][torch.tensor(tokens)]
+        for i in range(self.nlayer):
+            p = f"model.layers.{i}."
+            h = self._norm(x, w[p + "input_layernorm.weight"])
+
+            def proj(name):
+                return h @ w[p + f"self_attn.{name}_proj.weight"].T + w[p + f"self_attn.{name}_proj.bias"]
+
+            q = proj("q").view(n, self.nh, self.dh)
+            self.keys[i] = torch.cat([self.keys[i], proj("k").view(n, self.nkvh, self.dh)])
+            self.values[i] = torch.cat([self.values[i], proj("v").view(n, self.nkvh, self.dh)])
+            q = self._rope(q, query_pos)
+            k = self._rope(self.keys[i], key_pos).repeat_interleave(self.nh // self.nkvh, 1)
+            v = self.values[i].repeat_interleave(self.nh // self.nkvh, 1)
+            scores = torch.einsum("qhd,khd->hqk", q, k) / self.dh**0.5
+            scores = scores.masked_fill(~mask, float("-inf")).softmax(-1)
+            attn = torch.einsum("hqk,khd->qhd", scores, v).reshape(n, -1)
+            x = x + attn @ w[p + "self_attn.o_proj.weight"].T
+
+            h = self._norm(x, w[p + "post_attention_layernorm.weight"])
+            gate = h @ w[p + "mlp.gate_proj.weight"].T
+            up = h @ w[p + "mlp.up_proj.weight"].T
+            x = x + (torch.nn.functional.silu(gate) * up) @ w[p + "mlp.down_proj.weight"].T
+        return self._norm(x[-1], w["model.norm.weight"]) @ w["lm_head.weight"].T
+
+
+def load_model(path, max_seq_len=128):
+    return llaisys.models.Qwen2(path, llaisys.DeviceType.CPU, max_seq_len)
+
+
+def logits(model):
+    # A copy of the logits [m, voc] of the model's last pass.
+    tensor = model.logits()
+    result = torch.zeros(tensor.shape(), dtype=torch.float32)
+    llaisys.RuntimeAPI(tensor.device_type()).memcpy_sync(
+        result.data_ptr(),
+        tensor.data_ptr(),
+        result.numel() * result.element_size(),
+        llaisys.MemcpyKind.D2D,
+    )
+    return result
+
+
+def infer(model, tokens):
+    token_ids = (c_int64 * len(tokens))(*tokens)
+    return LIB_LLAISYS.llaisysQwen2ModelInfer(model._model, token_ids, len(tokens))
+
+
+def cold_logits(path, tokens):
+    # Logits [voc] of the last of tokens, computed by a new model.
+    model = load_model(path)
+    infer(model, tokens)
+    return logits(model)[0]
+
+
+def create_sequence(model):
+    return LIB_LLAISYS.llaisysQwen2ModelCreateSequence(model._model)
+
+
+def destroy_sequence(model, seq):
+    LIB_LLAISYS.llaisysQwen2ModelDestroySequence(model._model, seq)
+
+
+def append_tokens(model, seq, tokens):
+    token_ids = (c_int64 * len(tokens))(*tokens)
+    LIB_LLAISYS.llaisysQwen2ModelAppendTokens(model._model, seq, token_ids, len(tokens))
+
+
+def step(model, capacity=8):
+    # [(sequence, next token)] of the sequences done by one step.
+    seq_ids = (c_int64 * capacity)()
+    next_tokens = (c_int64 * capacity)()
+    n = LIB_LLAISYS.llaisysQwen2ModelStep(model._model, seq_ids, next_tokens, capacity)
+    return [(seq_ids[i], next_tokens[i]) for i in range(n)]
+
+
+def cache_stats(model):
+    stats = LlaisysQwen2CacheStats()
+    LIB_LLAISYS.llaisysQwen2ModelCacheStats(model._model, byref(stats))
+    return stats
+
+
+def check_logits(result, answer, atol=1e-4, rtol=1e-4):
+    answer = answer.to(result.dtype)
+    if torch.allclose(result, answer, atol=atol, rtol=rtol):
+        return True
+    print(f"LLAISYS logits: \n{result}")
+    print(f"Expected: \n{answer}")
+    print(f"Max difference: {(result - answer).abs().max().item()}")
+    return False
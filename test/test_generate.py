@@ -0,0 +1,96 @@
+import tempfile
+
+import torch
+from qwen2_utils import *
+
+
+def greedy(path, tokens, max_new_tokens):
+    # Argmax decoding through Infer, up to the end token or maxseq computed positions.
+    model = load_model(path)
+    tokens = list(tokens)
+    for _ in range(max_new_tokens):
+        if len(tokens) > CONFIG["max_position_embeddings"]:
+            break
+        tokens.append(infer(model, tokens))
+        if tokens[-1] == CONFIG["eos_token_id"]:
+            break
+    return tokens
+
+
+def test_greedy(path, prompt, max_new_tokens):
+    model = load_model(path)
+    result = model.generate(prompt, max_new_tokens, top_k=1)
+    assert result == greedy(path, prompt, max_new_tokens), result
+
+
+def test_streamer(path, prompt, max_new_tokens):
+    # Sampled, so that the tokens depend on the seed; each run on a new model.
+    def generate(streamer):
+        model = load_model(path)
+        seen = []
+
+        def on_token(token, elapsed):
+            seen.append((token, elapsed))
+            return streamer(model, len(seen))
+
+        result = model.generate(
+            prompt,
+            max_new_tokens,
+            top_k=50,
+            top_p=0.9,
+            temperature=1.0,
+            seed=7,
+            streamer=on_token,
+        )
+        assert result[: len(prompt)] == prompt
+        # The streamer sees exactly the generated tokens, in order, as they come.
+        assert [token for token, _ in seen] == result[len(prompt) :]
+        times = [elapsed for _, elapsed in seen]
+        assert times == sorted(times) and times[0] >= 0
+        return result[len(prompt) :]
+
+    tokens = generate(lambda model, n: False)
+    assert 3 < len(tokens) <= max_new_tokens
+
+    # Returning True stops after that token.
+    assert generate(lambda model, n: n == 3) == tokens[:3]
+
+    # So does cancel, here called from the streamer.
+    def cancel(model, n):
+        if n == 2:
+            model.cancel()
+        return False
+
+    assert generate(cancel) == tokens[:2]
+
+    # A cancel before the call stops it after its first token, and only it.
+    model = load_model(path)
+    model.cancel()
+    sampling = dict(top_k=50, top_p=0.9, temperature=1.0, seed=7)
+    assert model.generate(prompt, max_new_tokens, **sampling) == prompt + tokens[:1]
+    assert model.generate(prompt, max_new_tokens, **sampling) == prompt + tokens
+
+
+def test_repeat(path, prompt, max_new_tokens):
+    # What a call leaves in the cache and workspace must not change the next one.
+    model = load_model(path)
+    for sampling in [dict(top_k=1), dict(top_k=50, top_p=0.9, temperature=1.0, seed=7)]:
+        first = model.generate(prompt, max_new_tokens, **sampling)
+        assert model.generate(prompt, max_new_tokens, **sampling) == first
+        # Also after a call on another prompt.
+        model.generate(prompt[::-1], max_new_tokens, **sampling)
+        assert model.generate(prompt, max_new_tokens, **sampling) == first
+
+
+if __name__ == "__main__":
+    with tempfile.TemporaryDirectory() as path:
+        write_checkpoint(path)
+        generator = torch.Generator().manual_seed(4)
+        prompt = torch.randint(0, CONFIG["eos_token_id"], (8,), generator=generator).tolist()
+        test_greedy(path, prompt, 20)
+        # Past the cache: the last token drawn is never computed.
+        test_greedy(path, prompt, 200)
+        test_streamer(path, prompt, 16)
+        test_repeat(path, prompt, 16)
+
+    print("\033[92mTest passed!\033[0m\n")
@@ -54,8 +54,12 @@ def hf_infer(
     return outputs[0].tolist(), result
 
 
-def load_llaisys_model(model_path, device_name):
-    model = llaisys.models.Qwen2(model_path, llaisys_device(device_name))
+def load_llaisys_model(model_path, device_name, weight_format="packed"):
+    model = llaisys.models.Qwen2(
+        model_path,
+        llaisys_device(device_name),
+        weight_format=llaisys.Qwen2WeightFormat[weight_format.upper()],
+    )
     return model
 
 
@@ -88,6 +92,7 @@ if __name__ == "__main__":
     parser.add_argument("--top_p", default=0.8, type=float)
     parser.add_argument("--top_k", default=50, type=int)
     parser.add_argument("--temperature", default=1.0, type=float)
+    parser.add_argument("--weights", default="packed", choices=["dense", "packed", "int8", "int4"], type=str)
     parser.add_argument("--test", action="store_true")
 
     args = parser.parse_args()
@@ -122,7 +127,7 @@ if __name__ == "__main__":
     print("\n")
     print(f"Time elapsed: {(end_time - start_time):.2f}s\n")
 
-    model = load_llaisys_model(model_path, args.device)
+    model = load_llaisys_model(model_path, args.device, args.weights)
     start_time = time.time()
     llaisys_tokens, llaisys_output = llaisys_infer(
         args.prompt,
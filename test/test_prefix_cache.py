@@ -0,0 +1,71 @@
+import tempfile
+
+import torch
+from llaisys.libllaisys import LIB_LLAISYS
+from qwen2_utils import *
+
+
+def prompt(generator, n):
+    return torch.randint(0, CONFIG["eos_token_id"], (n,), generator=generator).tolist()
+
+
+def prefill(model, seq, tokens):
+    append_tokens(model, seq, tokens)
+    done = step(model)
+    assert [s for s, _ in done] == [seq], done
+    return logits(model)[0]
+
+
+def test_prefix_cache(path):
+    model = load_model(path)
+    # 8 blocks of 16 positions.
+    LIB_LLAISYS.llaisysQwen2ModelSetKVCacheCapacity(model._model, 128)
+    generator = torch.Generator().manual_seed(1)
+    shared, other, long = prompt(generator, 32), prompt(generator, 32), prompt(generator, 64)
+    a_tokens = shared + prompt(generator, 8)
+    b_tokens = shared + prompt(generator, 8)
+
+    # A holds 3 blocks, 2 of them full and registered.
+    a = create_sequence(model)
+    a_logits = prefill(model, a, a_tokens)
+    assert check_logits(a_logits, cold_logits(path, a_tokens))
+    stats = cache_stats(model)
+    assert stats.query_tokens == 40 and stats.hit_tokens == 0
+    assert stats.free_blocks == 5 and stats.cached_blocks == 0
+
+    # A destroyed sequence leaves its full blocks cached, its partial one free.
+    c = create_sequence(model)
+    prefill(model, c, other + prompt(generator, 8))
+    destroy_sequence(model, c)
+    stats = cache_stats(model)
+    assert stats.free_blocks == 3 and stats.cached_blocks == 2
+
+    # 4 blocks: the free ones, then the least recently used cached one.
+    d = create_sequence(model)
+    prefill(model, d, long)
+    stats = cache_stats(model)
+    assert stats.free_blocks == 0 and stats.cached_blocks == 1 and stats.evicted_blocks == 1
+
+    # B takes over the blocks A still uses and evicts the last cached block, never
+    # those of a live sequence.
+    b = create_sequence(model)
+    b_logits = prefill(model, b, b_tokens)
+    stats = cache_stats(model)
+    assert stats.query_tokens == 40 + 40 + 64 + 40
+    assert stats.hit_tokens == 32
+    assert stats.free_blocks == 0 and stats.cached_blocks == 0 and stats.evicted_blocks == 2
+    assert check_logits(b_logits, cold_logits(path, b_tokens))
+
+    # The shared blocks are unchanged for A, which goes on from them.
+    next_token = int(a_logits.argmax())
+    append_tokens(model, a, [next_token])
+    assert [s for s, _ in step(model)] == [a]
+    assert check_logits(logits(model)[0], cold_logits(path, a_tokens + [next_token]))
+
+
+if __name__ == "__main__":
+    with tempfile.TemporaryDirectory() as path:
+        write_checkpoint(path)
+        test_prefix_cache(path)
+
+    print("\033[92mTest passed!\033[0m\n")
@@ -53,10 +53,29 @@ def test_memcpy(api, size_bytes: int):
     torch.testing.assert_close(a, b)
 
 
+def test_num_threads():
+    default = llaisys.get_num_threads()
+    print(f"CPU thread pool has {default} threads")
+    assert default >= 1
+
+    llaisys.set_num_threads(2)
+    assert llaisys.get_num_threads() == 2
+    llaisys.set_num_threads(default)
+    assert llaisys.get_num_threads() == default
+
+    # A count that is not positive restores the default.
+    for num_threads in (0, -1):
+        llaisys.set_num_threads(2)
+        llaisys.set_num_threads(num_threads)
+        assert llaisys.get_num_threads() == default
+
+
 if __name__ == "__main__":
     parser = argparse.ArgumentParser()
     parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
     args = parser.parse_args()
     test_basic_runtime_api(args.device)
+    if args.device == "cpu":
+        test_num_threads()
     
     print("\033[92mTest passed!\033[0m\n")
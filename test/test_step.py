@@ -0,0 +1,77 @@
+import math
+import tempfile
+
+import torch
+from llaisys.libllaisys import LIB_LLAISYS
+from qwen2_utils import *
+
+
+def test_step(path, chunk, nlong):
+    model = load_model(path)
+    LIB_LLAISYS.llaisysQwen2ModelSetPrefillChunk(model._model, chunk)
+    # Room for both sequences in the pool.
+    LIB_LLAISYS.llaisysQwen2ModelSetKVCacheCapacity(model._model, 256)
+    # Each sequence run alone, through Infer.
+    short_alone, long_alone = load_model(path), load_model(path)
+    generator = torch.Generator().manual_seed(3)
+
+    def prompt(n):
+        return torch.randint(0, CONFIG["eos_token_id"], (n,), generator=generator).tolist()
+
+    short = create_sequence(model)
+    short_tokens = prompt(8)
+    append_tokens(model, short, short_tokens)
+    [(seq, token)] = step(model)
+    assert seq == short
+    infer(short_alone, short_tokens)
+    assert check_logits(logits(model)[0], logits(short_alone)[0])
+
+    # The long prompt is spread over steps of at most a chunk, while the short
+    # sequence decodes a token at every one of them.
+    long = create_sequence(model)
+    long_tokens = prompt(nlong)
+    append_tokens(model, long, long_tokens)
+    nstep = 0
+    while True:
+        short_tokens.append(token)
+        append_tokens(model, short, [token])
+        done = step(model)
+        nstep += 1
+        assert done[0][0] == short
+        infer(short_alone, short_tokens)
+        assert check_logits(logits(model)[0], logits(short_alone)[0])
+        token = done[0][1]
+        if len(done) == 2:
+            break
+        assert done == [(short, token)]
+        assert LIB_LLAISYS.llaisysQwen2ModelQueuedTokens(model._model) == nlong - nstep * chunk
+    assert nstep == math.ceil(nlong / chunk)
+    assert done[1][0] == long
+    infer(long_alone, long_tokens)
+    assert check_logits(logits(model)[1], logits(long_alone)[0])
+
+    # Then both decode in the same steps.
+    long_token = done[1][1]
+    for _ in range(4):
+        short_tokens.append(token)
+        long_tokens.append(long_token)
+        append_tokens(model, long, [long_token])
+        append_tokens(model, short, [token])
+        done = step(model)
+        # Decodes are reported in order of their ids.
+        assert [seq for seq, _ in done] == [short, long]
+        rows = logits(model)
+        infer(short_alone, short_tokens)
+        assert check_logits(rows[0], logits(short_alone)[0])
+        infer(long_alone, long_tokens)
+        assert check_logits(rows[1], logits(long_alone)[0])
+        (_, token), (_, long_token) = done
+
+
+if __name__ == "__main__":
+    with tempfile.TemporaryDirectory() as path:
+        write_checkpoint(path)
+        test_step(path, 16, 100)
+        test_step(path, 24, 96)
+
+    print("\033[92mTest passed!\033[0m\n")
@@ -0,0 +1,42 @@
+import tempfile
+
+import torch
+from llaisys.libllaisys import LIB_LLAISYS
+from qwen2_utils import *
+
+
+def test_streaming(path, sinks, window, ntoken):
+    model = load_model(path)
+    LIB_LLAISYS.llaisysQwen2ModelSetStreaming(model._model, sinks, window)
+    reference = Reference(path, sinks, window)
+
+    # Decode greedily well past the window and maxseq, each token through Infer on the
+    # whole sequence, which only computes the new one.
+    generator = torch.Generator().manual_seed(2)
+    tokens = torch.randint(0, CONFIG["eos_token_id"], (8,), generator=generator).tolist()
+    new_tokens = tokens
+    while True:
+        infer(model, tokens)
+        result = logits(model)[0]
+        assert check_logits(result, reference.forward(new_tokens))
+        if len(tokens) == ntoken:
+            break
+        # Follow the model's choice, so that both see the same tokens.
+        new_tokens = [int(result.argmax())]
+        tokens = tokens + new_tokens
+    assert reference.evicted > 0
+
+    stats = cache_stats(model)
+    assert stats.query_tokens == ntoken and stats.hit_tokens == 0
+
+
+if __name__ == "__main__":
+    with tempfile.TemporaryDirectory() as path:
+        write_checkpoint(path)
+        # Sinks rounded up to a block.
+        test_streaming(path, 4, 32, 160)
+        test_streaming(path, 16, 40, 160)
+        # No sinks: only the window is kept.
+        test_streaming(path, 0, 32, 100)
+
+    print("\033[92mTest passed!\033[0m\n")
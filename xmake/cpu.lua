@@ -20,6 +20,14 @@ target("llaisys-ops-cpu")
         add_cxflags("-fPIC", "-Wno-unknown-pragmas")
     end
 
+    if has_config("cpu-native") then
+        if is_plat("windows") then
+            add_cxflags("/arch:AVX2")
+        else
+            add_cxflags("-march=native")
+        end
+    end
+
     add_files("../src/ops/*/cpu/*.cpp")
 
     on_install(function (target) end)